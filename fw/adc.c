@@ -40,6 +40,8 @@
 #define PLD_VCC_DIVIDER_SCALE 2 / 10000 // (1k / 1k)
 #define PLD_GND_DIVIDER_SCALE 1 / 10000 // (no divider)
 
+#define ADC_SYNC_TIMEOUT      100000    // Spins waiting for a sweep
+
 #include <libopencm3/stm32/adc.h>
 #include <libopencm3/stm32/dac.h>
 #include <libopencm3/stm32/dma.h>
@@ -266,6 +268,45 @@ adc_get_pld_readings(uint *pld_gnd)
     return (calc_pld_vcc);
 }
 
+/*
+ * adc_get_pld_raw_sync
+ * --------------------
+ * Waits for an ADC conversion sweep which started after this function
+ * was called, then returns the raw (unscaled) PLD_VCC and PLD_GND
+ * readings from that sweep. This allows a reading to be synchronized
+ * with a change in PLD inputs. Returns RC_TIMEOUT if no new sweep
+ * completed, in which case the readings are from an earlier sweep.
+ */
+rc_t
+adc_get_pld_raw_sync(uint16_t *pld_vcc, uint16_t *pld_gnd)
+{
+#ifdef STM32F4
+    uint32_t dma     = DMA2;
+    uint8_t  channel = 4;
+#else
+    uint32_t dma     = DMA1;
+    uint8_t  channel = DMA_CHANNEL1;
+#endif
+    uint pass;
+    uint timeout;
+
+    /*
+     * The first transfer complete may be from a sweep which was already
+     * in progress, so wait for a second one.
+     */
+    for (pass = 0; pass < 2; pass++) {
+        dma_clear_interrupt_flags(dma, channel, DMA_TCIF);
+        for (timeout = ADC_SYNC_TIMEOUT; timeout > 0; timeout--)
+            if (dma_get_interrupt_flag(dma, channel, DMA_TCIF))
+                break;
+        if (timeout == 0)
+            break;
+    }
+    *pld_vcc = adc_buffer[2];
+    *pld_gnd = adc_buffer[3];
+    return ((timeout == 0) ? RC_TIMEOUT : RC_SUCCESS);
+}
+
 void
 adc_show_sensors(void)
 {
@@ -18,6 +18,7 @@ void adc_show_sensors(void);
 void adc_poll(int verbose, int force);
 void dac_setvalue(uint32_t value);
 uint adc_get_pld_readings(uint *pld_gnd);
+rc_t adc_get_pld_raw_sync(uint16_t *pld_vcc, uint16_t *pld_gnd);
 void adc_enable(void);
 void adc_pulldown(void);
 
@@ -31,6 +31,9 @@
 #include "readline.h"
 #ifdef EMBEDDED_CMD
 #include "pcmds.h"
+#ifdef HOST_SIM
+#include "sim.h"
+#endif
 #else
 #include "sfile.h"
 #endif
@@ -45,6 +48,23 @@ typedef struct {
 } cmd_t;
 
 static rc_t cmd_help(int argc, char * const *argv);
+#ifdef EMBEDDED_CMD
+static rc_t cmd_machine(int argc, char * const *argv);
+
+#define MACHINE_LINE_MAX 512   // Max machine mode command length
+#define MACHINE_SOF      0x02  // STX begins each machine mode response
+#define MACHINE_EOF      0x03  // ETX begins the response status line
+
+static const char cmd_machine_help[] =
+"machine on  - enter machine client mode\n"
+"machine off - return to interactive mode\n"
+"In machine mode, input is not echoed, edited, or recorded in history,\n"
+"and commands may be sent without waiting for a prompt. The output of\n"
+"each command is preceded by a line of <STX><seq> and followed by a\n"
+"line of <ETX><seq> <rc>, where seq counts commands from 1 and rc is 0\n"
+"for success. USB input is held off while the input buffer is full, so\n"
+"no queued command is lost.\n";
+#endif
 
 static const cmd_t cmd_list[] = {
     { cmd_help,    "?",       0, NULL, " [<cmd>]", "display help" },
@@ -72,6 +92,8 @@ static const cmd_t cmd_list[] = {
     { cmd_loop,    "loop",    0, NULL,
                         " <count> <cmd>", "execute command multiple times" },
 #ifdef EMBEDDED_CMD
+    { cmd_machine, "machine", 4, cmd_machine_help, " on|off",
+                        "machine client mode" },
     { cmd_map,     "map",     1, NULL, "", "show memory map" },
 #endif
     { cmd_echo,    "print",   0, NULL, NULL, NULL },
@@ -90,12 +112,16 @@ static const cmd_t cmd_list[] = {
                         "perform EEPROM operation" },
 #endif
     { cmd_reset,   "reset",   0, cmd_reset_help, " [dfu]", "reset CPU" },
+#ifdef HOST_SIM
+    { cmd_sim,     "sim",     0, cmd_sim_help, " bench|delay|eq|load|...",
+                        "control simulated PLD" },
+#endif
 #ifdef HAVE_SPACE_PROM
     { cmd_snoop,   "snoop",   0, cmd_snoop_help, "", "snoop ROM" },
 #endif
     { cmd_time,    "time",    0, cmd_time_help, " cmd|now|watch>",
                         "measure or show time" },
-    { cmd_usb,     "usb",    0, cmd_usb_help, " disable|regs|reset",
+    { cmd_usb,     "usb",    0, cmd_usb_help, " bench|disable|regs|reset",
                         "show or change USB status" },
 #else
     { cmd_time,    "time",    0, cmd_time_help, " cmd <cmd>",
@@ -946,11 +972,101 @@ no_whitespace(char *line)
 }
 
 #ifdef EMBEDDED_CMD
+static bool_t machine_mode;                   // Machine client mode active
+static uint   machine_seq;                    // Last command sequence number
+static uint   machine_pos;                    // Machine command length
+static bool_t machine_overflow;               // Machine command too long
+static char   machine_buf[MACHINE_LINE_MAX];  // Machine command being read
+
+/*
+ * cmd_machine
+ * -----------
+ * Enter or leave machine client mode.
+ */
+static rc_t
+cmd_machine(int argc, char * const *argv)
+{
+    if (argc != 2)
+        return (RC_USER_HELP);
+    if (strcmp(argv[1], "on") == 0) {
+        machine_mode = TRUE;
+        machine_seq = 0;
+        machine_pos = 0;
+        machine_overflow = FALSE;
+    } else if (strcmp(argv[1], "off") == 0) {
+        machine_mode = FALSE;
+    } else {
+        printf("Unknown argument %s\n", argv[1]);
+        return (RC_USER_HELP);
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * cmdline_machine
+ * ---------------
+ * Collect input in machine client mode, and execute at most one complete
+ * command. Characters which have already arrived are taken without
+ * flushing output, so responses to commands which the host sent
+ * back-to-back are packed together.
+ */
+static int
+cmdline_machine(void)
+{
+    char *sline;
+    uint  seq;
+    rc_t  rc;
+    int   ch;
+
+    while (1) {
+        ch = getchar_queued();
+        if (ch < 0)
+            ch = getchar();
+        if (ch <= 0)
+            return (0);
+        if (ch == 0x03) {
+            /* ^C discards the partial command */
+            machine_pos = 0;
+            machine_overflow = FALSE;
+            continue;
+        }
+        if ((ch != '\n') && (ch != '\r')) {
+            if (machine_pos < sizeof (machine_buf) - 1)
+                machine_buf[machine_pos++] = ch;
+            else
+                machine_overflow = TRUE;
+            continue;
+        }
+        machine_buf[machine_pos] = '\0';
+        machine_pos = 0;
+        sline = no_whitespace(machine_buf);
+        if ((sline[0] != '\0') || machine_overflow)
+            break;
+    }
+
+    led_busy(1);
+    seq = ++machine_seq;
+    printf("%c%u\n", MACHINE_SOF, seq);
+    if (machine_overflow) {
+        printf("Command exceeds %u characters\n", MACHINE_LINE_MAX - 1);
+        machine_overflow = FALSE;
+        rc = RC_FAILURE;
+    } else {
+        rc = cmd_exec_string(sline);
+    }
+    printf("%c%u %d\n", MACHINE_EOF, seq, rc);
+    led_busy(0);
+    return (0);
+}
+
 int
 cmdline(void)
 {
     char *line;
 
+    if (machine_mode)
+        return (cmdline_machine());
+
     (void) get_new_input_line("CMD> ", &line);
     if (line != NULL) {
         HIST_ENTRY *hist_cur;
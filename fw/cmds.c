@@ -42,6 +42,9 @@
 #include "cmds.h"
 #include "readline.h"
 #include "mem_access.h"
+#ifdef HAVE_MEM_DMA
+#include "mem_dma.h"
+#endif
 #include "version.h"
 
 #ifdef AMIGA
@@ -91,7 +94,12 @@ const char cmd_comp_help[] =
 "   l = long (4 bytes)\n"
 "   q = quad (8 bytes)\n"
 "   o = oct (16 bytes)\n"
-"   h = hex (32 bytes)\n";
+"   h = hex (32 bytes)\n"
+#ifdef HAVE_MEM_DMA
+"   C = CPU access only (no DMA)\n"
+"   T = report throughput\n"
+#endif
+"";
 
 const char cmd_copy_help[] =
 "copy[bwlqoh] <saddr> <daddr> <len>\n"
@@ -100,7 +108,12 @@ const char cmd_copy_help[] =
 "   l = long (4 bytes)\n"
 "   q = quad (8 bytes)\n"
 "   o = oct (16 bytes)\n"
-"   h = hex (32 bytes)\n";
+"   h = hex (32 bytes)\n"
+#ifdef HAVE_MEM_DMA
+"   C = CPU access only (no DMA)\n"
+"   T = report throughput\n"
+#endif
+"";
 
 const char cmd_d_help[] =
 "d[bwlqoh] <addr> [<len>]\n"
@@ -136,6 +149,10 @@ const char cmd_patt_help[] =
 "   o = oct (16 bytes)\n"
 "   h = hex (32 bytes)\n"
 "   S = swap bytes (endian)\n"
+#ifdef HAVE_MEM_DMA
+"   C = CPU access only (no DMA)\n"
+"   T = report throughput\n"
+#endif
 "   <pattern> may be one, zero, blip, rand, strobe, walk0, walk1, or a "
 "specific value\n";
 const char cmd_patt_patterns[] =
@@ -299,6 +316,53 @@ print_addr(uint64_t space, uint64_t addr)
     }
 }
 
+#ifdef HAVE_MEM_DMA
+/*
+ * data_dma_addr
+ * -------------
+ * Returns TRUE if the range in the specified address space is plain
+ * memory which may be transferred by DMA, and provides its bus address.
+ */
+static bool_t
+data_dma_addr(uint64_t space, uint64_t addr, uint len, bool_t write,
+              uintptr_t *dma_addr)
+{
+    switch ((uint8_t) space) {
+        case SPACE_MEMORY:
+            break;
+#ifdef MEM_DMA_FLASH_BASE
+        case SPACE_FLASH:
+            if (write)
+                return (FALSE);  // Flash must be programmed
+            addr += MEM_DMA_FLASH_BASE;
+            break;
+#endif
+        default:
+            return (FALSE);
+    }
+    if (mem_dma_capable(addr, len, write) == FALSE)
+        return (FALSE);
+    *dma_addr = (uintptr_t) addr;
+    return (TRUE);
+}
+
+/*
+ * print_throughput
+ * ----------------
+ * Report the time taken to process len bytes since the start tick.
+ */
+static void
+print_throughput(const char *what, uint len, uint64_t start, bool_t dma)
+{
+    uint64_t usec = timer_tick_to_usec(timer_tick_get() - start);
+
+    printf("%s %u bytes in %lld us", what, len, usec);
+    if (usec != 0)
+        printf(", %lld KB/s", (uint64_t) len * 1000000 / 1024 / usec);
+    printf(" (%s)\n", dma ? "DMA" : "CPU");
+}
+#endif
+
 #ifdef HAVE_SPACE_FILE
 static int
 space_add_filename(uint64_t *space, const char *name)
@@ -674,6 +738,14 @@ cmd_comp(int argc, char * const *argv)
     const char *cmd;
     const char *ptr;
     uint        mismatch_count = 0;
+#ifdef HAVE_MEM_DMA
+    bool_t      flag_C = FALSE;
+    bool_t      flag_T = FALSE;
+    bool_t      use_dma;
+    uintptr_t   dma1;
+    uintptr_t   dma2;
+    uint64_t    start;
+#endif
 
     if (argc < 4) {
         printf("compare requires three arguments: <addr1> <addr2> <len>\n");
@@ -689,6 +761,16 @@ cmd_comp(int argc, char * const *argv)
             case 'A':
                 flag_A = TRUE;
                 break;
+#ifdef HAVE_MEM_DMA
+            case 'c':
+            case 'C':
+                flag_C = TRUE;
+                break;
+            case 't':
+            case 'T':
+                flag_T = TRUE;
+                break;
+#endif
             default:
                 printf("Unknown flag \"%s\"\n", ptr);
                 return (RC_USER_HELP);
@@ -711,7 +793,30 @@ cmd_comp(int argc, char * const *argv)
     if ((rc = parse_uint(argv[0], &len)) != RC_SUCCESS)
         return (RC_USER_HELP);
 
+#ifdef HAVE_MEM_DMA
+    use_dma = (flag_C == FALSE) && ((len % width) == 0) &&
+              data_dma_addr(space1, addr1, len, FALSE, &dma1) &&
+              data_dma_addr(space2, addr2, len, FALSE, &dma2);
+    start = timer_tick_get();
+#endif
     for (offset = 0; offset < len; offset += width) {
+#ifdef HAVE_MEM_DMA
+        if (use_dma) {
+            /* Skip to the element holding the next mismatch */
+            uint match;
+            rc = mem_dma_comp(dma1 + offset, dma2 + offset, len - offset,
+                              &match);
+            if (rc != RC_SUCCESS) {
+                printf("DMA error comparing at ");
+                print_addr(space2, addr2 + offset);
+                printf("\n");
+                return (rc);
+            }
+            offset += match - (match % width);
+            if (offset >= len)
+                break;
+        }
+#endif
         rc = data_read(space1, addr1 + offset, width, buf1);
         if (rc != RC_SUCCESS) {
             if (printed)
@@ -750,6 +855,10 @@ cmd_comp(int argc, char * const *argv)
             return (RC_USR_ABORT);
         }
     }
+#ifdef HAVE_MEM_DMA
+    if (flag_T)
+        print_throughput("Compared", len, start, use_dma);
+#endif
     if (mismatch_count > 0) {
         printf("%d mismatches\n", mismatch_count);
         return (RC_FAILURE);
@@ -771,6 +880,14 @@ cmd_copy(int argc, char * const *argv)
     char        other[32];
     uint8_t     buf[MAX_TRANSFER];
     const char *cmd;
+    const char *ptr;
+#ifdef HAVE_MEM_DMA
+    bool_t      flag_C = FALSE;
+    bool_t      flag_T = FALSE;
+    uintptr_t   sdma;
+    uintptr_t   ddma;
+    uint64_t    start;
+#endif
 
     if (argc < 4) {
         printf("copy requires three arguments: <saddr> <daddr> <len>\n");
@@ -780,6 +897,23 @@ cmd_copy(int argc, char * const *argv)
     rc = parse_width(cmd, &width, other, sizeof (other));
     if (rc != RC_SUCCESS)
         return (RC_USER_HELP);
+    for (ptr = other; *ptr != '\0'; ptr++) {
+        switch (*ptr) {
+#ifdef HAVE_MEM_DMA
+            case 'c':
+            case 'C':
+                flag_C = TRUE;
+                break;
+            case 't':
+            case 'T':
+                flag_T = TRUE;
+                break;
+#endif
+            default:
+                printf("Unknown flag \"%s\"\n", ptr);
+                return (RC_USER_HELP);
+        }
+    }
     argc--;
     argv++;
     if ((rc = parse_addr(&argv, &argc, &sspace, &saddr)) != RC_SUCCESS)
@@ -797,6 +931,23 @@ cmd_copy(int argc, char * const *argv)
     if ((rc = parse_uint(argv[0], &len)) != RC_SUCCESS)
         return (RC_USER_HELP);
 
+#ifdef HAVE_MEM_DMA
+    start = timer_tick_get();
+    if ((flag_C == FALSE) && ((len % width) == 0) &&
+        data_dma_addr(sspace, saddr, len, FALSE, &sdma) &&
+        data_dma_addr(dspace, daddr, len, TRUE, &ddma)) {
+        rc = mem_dma_copy(ddma, sdma, len);
+        if (rc != RC_SUCCESS) {
+            printf("DMA error copying %u bytes to ", len);
+            print_addr(dspace, daddr);
+            printf("\n");
+            return (rc);
+        }
+        if (flag_T)
+            print_throughput("Copied", len, start, TRUE);
+        return (RC_SUCCESS);
+    }
+#endif
     for (offset = 0; offset < len; offset += width) {
         rc = data_read(sspace, saddr + offset, width, buf);
         if (rc != RC_SUCCESS) {
@@ -817,6 +968,10 @@ cmd_copy(int argc, char * const *argv)
             return (RC_USR_ABORT);
         }
     }
+#ifdef HAVE_MEM_DMA
+    if (flag_T)
+        print_throughput("Copied", len, start, FALSE);
+#endif
     return (RC_SUCCESS);
 }
 
@@ -1288,6 +1443,12 @@ cmd_patt(int argc, char * const *argv)
     uint8_t     buf[MAX_TRANSFER];
     const char *cmd;
     char       *ptr;
+#ifdef HAVE_MEM_DMA
+    bool_t      flag_C = FALSE;
+    bool_t      flag_T = FALSE;
+    uintptr_t   dma;
+    uint64_t    start;
+#endif
     static enum {
         PATT_ZERO,
         PATT_ONE,
@@ -1315,6 +1476,16 @@ cmd_patt(int argc, char * const *argv)
             case 'S':
                 flag_S = TRUE;
                 break;
+#ifdef HAVE_MEM_DMA
+            case 'c':
+            case 'C':
+                flag_C = TRUE;
+                break;
+            case 't':
+            case 'T':
+                flag_T = TRUE;
+                break;
+#endif
             default:
                 printf("Unknown flag \"%s\"\n", ptr);
                 return (RC_USER_HELP);
@@ -1374,6 +1545,25 @@ show_patterns:
         pattmode = PATT_VALUE;
     }
 
+#ifdef HAVE_MEM_DMA
+    /* Patterns which do not change from element to element may use DMA */
+    start = timer_tick_get();
+    if ((flag_C == FALSE) && ((len % width) == 0) &&
+        ((pattmode == PATT_ONE) || (pattmode == PATT_ZERO) ||
+         (pattmode == PATT_VALUE)) &&
+        data_dma_addr(space, addr, len, TRUE, &dma)) {
+        rc = mem_dma_fill(dma, buf, width, len);
+        if (rc != RC_SUCCESS) {
+            printf("DMA error filling %u bytes at ", len);
+            print_addr(space, addr);
+            printf("\n");
+            return (rc);
+        }
+        if (flag_T)
+            print_throughput("Filled", len, start, TRUE);
+        return (RC_SUCCESS);
+    }
+#endif
     for (offset = 0; offset < len; offset += width) {
         switch (pattmode) {
             case PATT_WALK0: {
@@ -1449,6 +1639,10 @@ show_patterns:
             return (RC_USR_ABORT);
         }
     }
+#ifdef HAVE_MEM_DMA
+    if (flag_T)
+        print_throughput("Filled", len, start, FALSE);
+#endif
     return (RC_SUCCESS);
 }
 
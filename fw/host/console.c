@@ -0,0 +1,345 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host console: the uart.h interface on stdin and stdout.
+ *
+ * Output is CRLF-translated as on the target so that captures from the
+ * host build are byte-identical to those from a real Brutus. Status
+ * which the target sends only to the serial UART (such as "pld walk raw"
+ * progress) goes to stderr. When stdin is a terminal it is placed in
+ * raw mode so that readline editing and ^C abort behave as on the target.
+ * Standard output is buffered by the same transmit ring used for the
+ * target UART, drained in chunks by write() in place of DMA.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <termios.h>
+#include "main.h"
+#include "uart.h"
+#include "usb.h"
+#include "tx_ring.h"
+
+#define CONS_OUT_SIZE 8192
+
+static uint8_t  cons_in_rb[1024];       // Console input ring buffer (FIFO)
+static uint     cons_in_rb_producer;    // Console input current writer pos
+static uint     cons_in_rb_consumer;    // Console input current reader pos
+static uint8_t  cons_out_buf[CONS_OUT_SIZE];
+static tx_ring_t cons_out_ring = {
+    cons_out_buf, sizeof (cons_out_buf), sizeof (cons_out_buf) / 2, 0, 0
+};
+static int      cons_in_eof;
+static int      cons_is_tty;
+static struct termios cons_saved_termios;
+
+uint8_t last_input_source = SOURCE_USB;  // stdin and stdout stand in for USB
+uint    usb_send_stalls;
+uint    usb_send_timeouts;
+
+/*
+ * cons_write
+ * ----------
+ * Writes a buffer to the specified file descriptor, retrying partial
+ * writes.
+ */
+static void
+cons_write(int fd, const void *buf, size_t len)
+{
+    const uint8_t *ptr = buf;
+
+    while (len > 0) {
+        ssize_t count = write(fd, ptr, len);
+        if (count <= 0)
+            return;
+        ptr += count;
+        len -= count;
+    }
+}
+
+void
+uart_flush(void)
+{
+    const uint8_t *ptr;
+    uint           len;
+
+    while ((len = tx_ring_peek(&cons_out_ring, &ptr)) != 0) {
+        cons_write(1, ptr, len);
+        tx_ring_consume(&cons_out_ring, len);
+    }
+}
+
+/*
+ * cons_out_write
+ * --------------
+ * Adds data to the standard output ring, sending chunks when it is full.
+ */
+static void
+cons_out_write(const void *buf, uint len)
+{
+    const uint8_t *ptr = buf;
+    uint           count;
+
+    while (len > 0) {
+        count = tx_ring_put(&cons_out_ring, ptr, len);
+        if (count == 0) {
+            const uint8_t *chunk;
+            uint           clen = tx_ring_peek(&cons_out_ring, &chunk);
+            cons_write(1, chunk, clen);
+            tx_ring_consume(&cons_out_ring, clen);
+        }
+        ptr += count;
+        len -= count;
+    }
+}
+
+static void
+cons_rb_put(uint ch)
+{
+    uint new_prod = (cons_in_rb_producer + 1) % sizeof (cons_in_rb);
+
+    if (new_prod == cons_in_rb_consumer)
+        return;  // Discard input because ring buffer is full
+    cons_in_rb[cons_in_rb_producer] = (uint8_t) ch;
+    cons_in_rb_producer = new_prod;
+}
+
+static int
+cons_rb_get(void)
+{
+    int ch;
+
+    if (cons_in_rb_consumer == cons_in_rb_producer)
+        return (-1);  // Ring buffer empty
+
+    ch = cons_in_rb[cons_in_rb_consumer];
+    cons_in_rb_consumer = (cons_in_rb_consumer + 1) % sizeof (cons_in_rb);
+    return (ch);
+}
+
+/*
+ * cons_poll
+ * ---------
+ * Moves any pending stdin data into the console input ring buffer,
+ * waiting up to the specified number of milliseconds for it to arrive.
+ */
+static void
+cons_poll(int timeout_ms)
+{
+    struct pollfd pfd;
+    uint8_t       buf[256];
+    ssize_t       count;
+    ssize_t       pos;
+    uint          space;
+
+    if (cons_in_eof)
+        return;
+
+    space = (cons_in_rb_consumer + sizeof (cons_in_rb) -
+             cons_in_rb_producer - 1) % sizeof (cons_in_rb);
+    if (space == 0)
+        return;
+    if (space > sizeof (buf))
+        space = sizeof (buf);
+
+    pfd.fd = 0;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+        return;
+
+    count = read(0, buf, space);
+    if (count <= 0) {
+        cons_in_eof = 1;
+        return;
+    }
+    for (pos = 0; pos < count; pos++)
+        cons_rb_put(buf[pos]);
+}
+
+int
+input_break_pending(void)
+{
+    uint cur;
+    uint next;
+
+    cons_poll(0);
+    for (cur = cons_in_rb_consumer; cur != cons_in_rb_producer; cur = next) {
+        next = (cur + 1) % sizeof (cons_in_rb);
+        if (cons_in_rb[cur] == 0x03) {  /* ^C is abort key */
+            cons_in_rb_consumer = next;
+            return (1);
+        }
+    }
+
+    return (0);
+}
+
+void
+usb_rb_put(uint ch)
+{
+    cons_rb_put(ch);
+}
+
+int
+uart_putchar(int ch)
+{
+    uint8_t byte = ch;
+
+    cons_write(2, &byte, 1);
+    return (0);
+}
+
+int
+puts_binary(const void *buf, uint32_t len)
+{
+    cons_out_write(buf, len);
+    return (0);
+}
+
+int
+puts_binary_stream(const void *buf, uint32_t len)
+{
+    return (puts_binary(buf, len));
+}
+
+/*
+ * usb_upload_start
+ * ----------------
+ * Uploads are read directly from the console input ring, which is only
+ * refilled from stdin as space permits, so no data is lost.
+ */
+int
+usb_upload_start(void)
+{
+    return (0);
+}
+
+void
+usb_upload_stop(void)
+{
+}
+
+uint32_t
+usb_upload_peek(const uint8_t **ptr)
+{
+    uint len;
+
+    if (cons_in_rb_consumer == cons_in_rb_producer)
+        cons_poll(10);
+    if (cons_in_rb_producer >= cons_in_rb_consumer)
+        len = cons_in_rb_producer - cons_in_rb_consumer;
+    else
+        len = sizeof (cons_in_rb) - cons_in_rb_consumer;
+    *ptr = cons_in_rb + cons_in_rb_consumer;
+    return (len);
+}
+
+void
+usb_upload_consume(uint32_t len)
+{
+    cons_in_rb_consumer = (cons_in_rb_consumer + len) % sizeof (cons_in_rb);
+}
+
+int
+putchar(int ch)
+{
+    static int last_putc = 0;
+    uint8_t    byte = ch;
+
+    if ((ch == '\n') && (last_putc != '\r') && (last_putc != '\n'))
+        cons_out_write("\r", 1);  // Always do CRLF
+    last_putc = ch;
+    cons_out_write(&byte, 1);
+    return (0);
+}
+
+void
+console_write(const char *buf, uint len)
+{
+    while (len-- > 0)
+        putchar((uint8_t) *(buf++));
+}
+
+int
+puts(const char *str)
+{
+    while (*str != '\0')
+        if (putchar((uint8_t) *(str++)))
+            return (1);
+    return (putchar('\n'));
+}
+
+/*
+ * getchar
+ * -------
+ * Returns the next console input character, or -1 if none is available.
+ * When stdin reaches end of file and all input has been consumed, the
+ * program exits.
+ */
+int
+getchar(void)
+{
+    int ch;
+
+    uart_flush();
+    ch = cons_rb_get();
+    if (ch >= 0)
+        return (ch);
+
+    cons_poll(10);
+    ch = cons_rb_get();
+    if ((ch < 0) && cons_in_eof)
+        exit(0);
+    return (ch);
+}
+
+/*
+ * getchar_queued
+ * --------------
+ * Returns the next console input character which has already been
+ * received, or -1 if none is waiting, without flushing output.
+ */
+int
+getchar_queued(void)
+{
+    return (cons_rb_get());
+}
+
+/*
+ * cons_restore
+ * ------------
+ * Flushes output and restores the terminal mode at exit.
+ */
+static void
+cons_restore(void)
+{
+    uart_flush();
+    if (cons_is_tty)
+        (void) tcsetattr(0, TCSANOW, &cons_saved_termios);
+}
+
+void
+uart_init(void)
+{
+    struct termios tio;
+
+    atexit(cons_restore);
+    if (isatty(0) && (tcgetattr(0, &cons_saved_termios) == 0)) {
+        cons_is_tty = 1;
+        tio = cons_saved_termios;
+        tio.c_iflag &= ~(ICRNL | INLCR | IGNCR | IXON);
+        tio.c_lflag &= ~(ICANON | ECHO | ISIG | IEXTEN);
+        tio.c_oflag &= ~OPOST;
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        (void) tcsetattr(0, TCSANOW, &tio);
+    }
+}
@@ -0,0 +1,208 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host microbenchmark of the walk value formatters.
+ *
+ * Formats walk lines with the firmware sprintf() and binary conversion
+ * that the walk previously used, and with the pld_fmt table-driven
+ * formatters, verifying that the output is byte-identical and reporting
+ * host nanoseconds per line for each.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "printf.h"
+#include "main.h"
+#include "utils.h"
+#include "uart.h"
+#include "pld_fmt.h"
+
+#define BENCH_LINES 1000000
+#define LINE_MAX    96
+
+typedef uint (*fmt_func_t)(char *buf, uint32_t write_mask,
+                           uint32_t read_mask, uint32_t power);
+
+/*
+ * ref_binary
+ * ----------
+ * Bit-at-a-time binary conversion, as previously done by the walk.
+ */
+static uint
+ref_binary(uint32_t value, char *buf)
+{
+    int bit;
+    for (bit = 27; bit >= 0; bit--) {
+        *(buf++) = '0' + !!(value & BIT(bit));
+        if ((bit == 24) || (bit == 16) || (bit == 8))
+            *(buf++) = ':';
+    }
+    return (31);
+}
+
+static uint
+ref_hex_line(char *buf, uint32_t write_mask, uint32_t read_mask,
+             uint32_t power)
+{
+    uint len = sprintf(buf, "%07lx %07lx", write_mask, read_mask);
+    len += sprintf(buf + len, " %03lx %03lx", power & 0xffff, power >> 16);
+    buf[len++] = '\n';
+    return (len);
+}
+
+static uint
+ref_binary_line(char *buf, uint32_t write_mask, uint32_t read_mask,
+                uint32_t power)
+{
+    uint len = ref_binary(write_mask, buf);
+    buf[len++] = ' ';
+    len += ref_binary(read_mask, buf + len);
+    buf[len++] = '\n';
+    return (len);
+}
+
+static uint
+fmt_hex_line(char *buf, uint32_t write_mask, uint32_t read_mask,
+             uint32_t power)
+{
+    uint len = pld_fmt_hex(buf, write_mask, 7);
+    buf[len++] = ' ';
+    len += pld_fmt_hex(buf + len, read_mask, 7);
+    buf[len++] = ' ';
+    len += pld_fmt_hex(buf + len, power & 0xffff, 3);
+    buf[len++] = ' ';
+    len += pld_fmt_hex(buf + len, power >> 16, 3);
+    buf[len++] = '\n';
+    return (len);
+}
+
+static uint
+fmt_binary_line(char *buf, uint32_t write_mask, uint32_t read_mask,
+                uint32_t power)
+{
+    uint len = pld_fmt_binary(buf, write_mask);
+    buf[len++] = ' ';
+    len += pld_fmt_binary(buf + len, read_mask);
+    buf[len++] = '\n';
+    return (len);
+}
+
+/*
+ * bench_vector
+ * ------------
+ * Returns a pseudo-random walk vector, occasionally with upper bits set
+ * as produced by walking zeros.
+ */
+static uint32_t
+bench_vector(uint32_t *state)
+{
+    *state = *state * 1664525 + 1013904223;
+    if ((*state & 0x700) == 0)
+        return (*state | 0xf0000000);
+    return (*state >> (*state & 0x1f));
+}
+
+static uint64_t
+bench_nsec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/*
+ * bench_run
+ * ---------
+ * Formats BENCH_LINES lines into a rolling block, returning host
+ * nanoseconds per line. The checksum defeats dead code elimination.
+ */
+static uint64_t
+bench_run(fmt_func_t func, uint32_t *checksum)
+{
+    static char block[PLD_FMT_BLOCK_SIZE];
+    uint     pos = 0;
+    uint     line;
+    uint32_t state = 1;
+    uint64_t start = bench_nsec();
+
+    for (line = 0; line < BENCH_LINES; line++) {
+        uint32_t wmask = bench_vector(&state);
+        uint32_t rmask = bench_vector(&state);
+        uint32_t power = bench_vector(&state) & 0x0fff0fff;
+        if (pos + LINE_MAX > sizeof (block)) {
+            *checksum += block[pos - 2];
+            pos = 0;
+        }
+        pos += func(block + pos, wmask, rmask, power);
+    }
+    return ((bench_nsec() - start) / BENCH_LINES);
+}
+
+/*
+ * bench_verify
+ * ------------
+ * Confirms that two line formatters produce byte-identical output.
+ */
+static int
+bench_verify(fmt_func_t ref, fmt_func_t func, const char *name)
+{
+    char     rbuf[LINE_MAX];
+    char     fbuf[LINE_MAX];
+    uint     rlen;
+    uint     flen;
+    uint     line;
+    uint32_t state = 1;
+
+    for (line = 0; line < BENCH_LINES; line++) {
+        uint32_t wmask = bench_vector(&state);
+        uint32_t rmask = bench_vector(&state);
+        uint32_t power = bench_vector(&state) & 0x0fff0fff;
+        rlen = ref(rbuf, wmask, rmask, power);
+        flen = func(fbuf, wmask, rmask, power);
+        if ((rlen != flen) || (memcmp(rbuf, fbuf, rlen) != 0)) {
+            rbuf[rlen] = '\0';
+            fbuf[flen] = '\0';
+            printf("%s mismatch for %08lx %08lx:\n  %s  %s", name,
+                   wmask, rmask, rbuf, fbuf);
+            return (1);
+        }
+    }
+    return (0);
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint32_t checksum = 0;
+    uint64_t ref_ns;
+    uint64_t fmt_ns;
+    int      rc = 0;
+
+    pld_fmt_init();
+    rc |= bench_verify(ref_hex_line, fmt_hex_line, "hex");
+    rc |= bench_verify(ref_binary_line, fmt_binary_line, "binary");
+    if (rc != 0) {
+        uart_flush();
+        exit(1);
+    }
+
+    ref_ns = bench_run(ref_hex_line, &checksum);
+    fmt_ns = bench_run(fmt_hex_line, &checksum);
+    printf("hex     sprintf %3llu ns/line  pld_fmt %3llu ns/line\n",
+           ref_ns, fmt_ns);
+    ref_ns = bench_run(ref_binary_line, &checksum);
+    fmt_ns = bench_run(fmt_binary_line, &checksum);
+    printf("binary  per-bit %3llu ns/line  pld_fmt %3llu ns/line\n",
+           ref_ns, fmt_ns);
+    printf("%u lines verified identical (checksum %08lx)\n",
+           BENCH_LINES, checksum);
+    uart_flush();
+    return (0);
+}
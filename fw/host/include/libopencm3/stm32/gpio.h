@@ -0,0 +1,2 @@
+/* Host simulator build: see sim_hw.h */
+#include "sim_hw.h"
@@ -0,0 +1,4 @@
+/* Host simulator build: see sim_hw.h */
+#include "sim_hw.h"
+
+typedef struct _usbd_device usbd_device;
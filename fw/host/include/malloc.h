@@ -0,0 +1,2 @@
+/* Host simulator build: newlib malloc.h does not pull in stdio.h */
+#include <stdlib.h>
@@ -0,0 +1,181 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host stand-in for the subset of libopencm3 used by the pld engine.
+ *
+ * Peripheral registers are backed by a scratch array indexed by the
+ * real STM32F1 peripheral address, so register writes and reads
+ * behave as plain memory. Peripheral library calls are no-ops except
+ * where the pld engine busy-waits on them, in which case they complete
+ * immediately. The PLD_* and PLDD_* GPIO ports are not accessed here;
+ * those go through pld_port.h to the simulated socket in sim.c.
+ */
+
+#ifndef _SIM_HW_H
+#define _SIM_HW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_MMIO_WORDS 0x10000
+extern volatile uint32_t sim_mmio[SIM_MMIO_WORDS];
+
+#define MMIO32(addr) (sim_mmio[((uint32_t)(addr) >> 2) & (SIM_MMIO_WORDS - 1)])
+
+/* GPIO */
+#define GPIOA 0x40010800U
+#define GPIOB 0x40010c00U
+#define GPIOC 0x40011000U
+#define GPIOD 0x40011400U
+#define GPIOE 0x40011800U
+
+#define GPIO_CRL(port)  MMIO32((port) + 0x00)
+#define GPIO_CRH(port)  MMIO32((port) + 0x04)
+#define GPIO_IDR(port)  MMIO32((port) + 0x08)
+#define GPIO_ODR(port)  MMIO32((port) + 0x0c)
+#define GPIO_BSRR(port) MMIO32((port) + 0x10)
+
+#define GPIO0  (1 << 0)
+#define GPIO1  (1 << 1)
+#define GPIO2  (1 << 2)
+#define GPIO3  (1 << 3)
+#define GPIO4  (1 << 4)
+#define GPIO5  (1 << 5)
+#define GPIO6  (1 << 6)
+#define GPIO7  (1 << 7)
+#define GPIO8  (1 << 8)
+#define GPIO9  (1 << 9)
+#define GPIO10 (1 << 10)
+#define GPIO11 (1 << 11)
+#define GPIO12 (1 << 12)
+#define GPIO13 (1 << 13)
+#define GPIO14 (1 << 14)
+#define GPIO15 (1 << 15)
+
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios);
+
+#define AFIO_MAPR                       MMIO32(0x40010004)
+#define AFIO_MAPR_TIM3_REMAP_FULL_REMAP (3 << 10)
+
+/* RCC */
+#define RCC_TIM3 3
+#define RCC_TIM5 5
+#define RCC_DMA1 8
+#define RCC_DMA2 9
+#define RST_TIM3 3
+#define RST_TIM5 5
+
+static inline void rcc_periph_clock_enable(uint32_t clken) { }
+static inline void rcc_periph_reset_pulse(uint32_t rst) { }
+
+/* Timers */
+#define TIM1 0x40012c00U
+#define TIM2 0x40000000U
+#define TIM3 0x40000400U
+#define TIM4 0x40000800U
+#define TIM5 0x40000c00U
+
+#define TIM_CR1(tim)  MMIO32((tim) + 0x00)
+#define TIM_DIER(tim) MMIO32((tim) + 0x0c)
+#define TIM_SR(tim)   MMIO32((tim) + 0x10)
+#define TIM_CNT(tim)  MMIO32((tim) + 0x24)
+#define TIM_CCR1(tim) MMIO32((tim) + 0x34)
+#define TIM_CCR2(tim) MMIO32((tim) + 0x38)
+#define TIM_CCR3(tim) MMIO32((tim) + 0x3c)
+#define TIM_CCR4(tim) MMIO32((tim) + 0x40)
+
+#define TIM_CR1_CKD_CK_INT_MASK (3 << 8)
+#define TIM_CR1_CMS_MASK        (3 << 5)
+#define TIM_CR1_DIR_DOWN        (1 << 4)
+#define TIM_DIER_UDE            (1 << 8)
+#define TIM_DIER_CC1DE          (1 << 9)
+#define TIM_SR_CC1IF            (1 << 1)
+#define TIM_SR_CC1OF            (1 << 9)
+
+enum tim_oc_id { TIM_OC1, TIM_OC1N, TIM_OC2, TIM_OC2N, TIM_OC3, TIM_OC3N,
+                 TIM_OC4 };
+enum tim_ic_id { TIM_IC1, TIM_IC2, TIM_IC3, TIM_IC4 };
+enum tim_ic_psc { TIM_IC_PSC_OFF, TIM_IC_PSC_2, TIM_IC_PSC_4, TIM_IC_PSC_8 };
+enum tim_ic_input { TIM_IC_OUT, TIM_IC_IN_TI1, TIM_IC_IN_TI2, TIM_IC_IN_TRC };
+enum tim_ic_pol { TIM_IC_RISING, TIM_IC_FALLING };
+
+static inline void timer_set_prescaler(uint32_t tim, uint32_t value) { }
+static inline void timer_set_period(uint32_t tim, uint32_t period) { }
+static inline void timer_continuous_mode(uint32_t tim) { }
+static inline void timer_enable_counter(uint32_t tim) { }
+static inline void timer_disable_counter(uint32_t tim) { }
+static inline void timer_set_oc_value(uint32_t tim, enum tim_oc_id oc,
+                                      uint32_t value) { }
+static inline void timer_set_oc_polarity_low(uint32_t tim,
+                                             enum tim_oc_id oc) { }
+static inline void timer_enable_oc_output(uint32_t tim, enum tim_oc_id oc) { }
+static inline void timer_ic_set_prescaler(uint32_t tim, enum tim_ic_id ic,
+                                          enum tim_ic_psc psc) { }
+static inline void timer_ic_set_input(uint32_t tim, enum tim_ic_id ic,
+                                      enum tim_ic_input in) { }
+static inline void timer_ic_set_polarity(uint32_t tim, enum tim_ic_id ic,
+                                         enum tim_ic_pol pol) { }
+static inline void timer_ic_enable(uint32_t tim, enum tim_ic_id ic) { }
+static inline void timer_ic_disable(uint32_t tim, enum tim_ic_id ic) { }
+
+/* DMA */
+#define DMA1 0x40020000U
+#define DMA2 0x40020400U
+
+#define DMA_CHANNEL1 1
+#define DMA_CHANNEL2 2
+#define DMA_CHANNEL5 5
+#define DMA_CHANNEL6 6
+#define DMA_TCIF     (1 << 1)
+
+#define DMA_CCR_PSIZE_16BIT (1 << 8)
+#define DMA_CCR_MSIZE_16BIT (1 << 10)
+#define DMA_CCR_PL_VERY_HIGH (3 << 12)
+
+static inline void dma_channel_reset(uint32_t dma, uint8_t ch) { }
+static inline void dma_enable_channel(uint32_t dma, uint8_t ch) { }
+static inline void dma_disable_channel(uint32_t dma, uint8_t ch) { }
+static inline void dma_enable_mem2mem_mode(uint32_t dma, uint8_t ch) { }
+static inline void dma_enable_circular_mode(uint32_t dma, uint8_t ch) { }
+static inline void dma_set_read_from_peripheral(uint32_t dma, uint8_t ch) { }
+static inline void dma_enable_memory_increment_mode(uint32_t dma,
+                                                    uint8_t ch) { }
+static inline void dma_disable_peripheral_increment_mode(uint32_t dma,
+                                                         uint8_t ch) { }
+static inline void dma_set_peripheral_size(uint32_t dma, uint8_t ch,
+                                           uint32_t size) { }
+static inline void dma_set_memory_size(uint32_t dma, uint8_t ch,
+                                       uint32_t size) { }
+static inline void dma_set_priority(uint32_t dma, uint8_t ch,
+                                    uint32_t prio) { }
+static inline void dma_set_peripheral_address(uint32_t dma, uint8_t ch,
+                                              uint32_t address) { }
+static inline void dma_set_memory_address(uint32_t dma, uint8_t ch,
+                                          uint32_t address) { }
+static inline void dma_set_number_of_data(uint32_t dma, uint8_t ch,
+                                          uint16_t number) { }
+static inline void dma_clear_interrupt_flags(uint32_t dma, uint8_t ch,
+                                             uint32_t flags) { }
+static inline bool dma_get_interrupt_flag(uint32_t dma, uint8_t ch,
+                                          uint32_t flag)
+{
+    return (true);  // Transfers complete immediately
+}
+static inline uint16_t dma_get_number_of_data(uint32_t dma, uint8_t ch)
+{
+    return (0);
+}
+
+/* Cortex-M3 core */
+bool     dwt_enable_cycle_counter(void);
+uint32_t dwt_read_cycle_counter(void);
+
+static inline void cm_disable_interrupts(void) { }
+static inline void cm_enable_interrupts(void) { }
+
+#endif /* _SIM_HW_H */
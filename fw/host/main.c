@@ -0,0 +1,116 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host build main routine.
+ *
+ * Runs the Brutus firmware command line against a simulated PLD socket.
+ * Commands are taken from -c options, or else from stdin (interactive
+ * when stdin is a terminal).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "main.h"
+#include "cmdline.h"
+#include "readline.h"
+#include "uart.h"
+#include "pld.h"
+#include "version.h"
+#include "sim.h"
+
+#define MAX_HOST_CMDS 32
+
+static const char usage_text[] =
+"Usage: fwsim [<options>]\n"
+"    -c <cmd>       execute command and exit (may be repeated)\n"
+"    -d <ns>        PLD propagation delay (default 10 ns)\n"
+"    -e <equation>  add PLD equation, such as \"p19=p2&!p3\"\n"
+"    -f <filename>  load PLD equations from file\n"
+"    -h             display this help\n"
+"    -r <filename>  replay a \"pld walk values\" or \"pld walk raw\" capture\n"
+"Commands are read from stdin when -c is not specified. See \"sim\" for\n"
+"simulator control.\n";
+
+static void
+usage(void)
+{
+    printf("%s", usage_text);
+    uart_flush();
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *cmds[MAX_HOST_CMDS];
+    uint        cmd_count = 0;
+    uint        cur;
+    int         ch;
+    rc_t        rc = RC_SUCCESS;
+
+    uart_init();
+    pld_init();
+
+    while ((ch = getopt(argc, argv, "c:d:e:f:hr:")) != -1) {
+        switch (ch) {
+            case 'c':
+                if (cmd_count >= MAX_HOST_CMDS) {
+                    printf("Too many -c commands\n");
+                    exit(1);
+                }
+                cmds[cmd_count++] = optarg;
+                break;
+            case 'd':
+                sim_set_delay(strtoul(optarg, NULL, 0));
+                break;
+            case 'e':
+                rc = sim_load_equations(optarg);
+                break;
+            case 'f':
+                rc = sim_load_equation_file(optarg);
+                break;
+            case 'r':
+                rc = sim_load_capture(optarg);
+                break;
+            case 'h':
+                usage();
+                exit(0);
+            default:
+                usage();
+                exit(1);
+        }
+        if (rc != RC_SUCCESS)
+            exit(1);
+    }
+    if (optind < argc) {
+        printf("Unexpected argument %s\n", argv[optind]);
+        usage();
+        exit(1);
+    }
+
+    if (cmd_count > 0) {
+        for (cur = 0; cur < cmd_count; cur++) {
+            rc = cmd_exec_string(cmds[cur]);
+            if (rc != RC_SUCCESS)
+                break;
+        }
+        uart_flush();
+        exit(rc);
+    }
+
+    if (isatty(0))
+        printf("\r\nBrutus-28 %s (host simulator)\n", version_str);
+
+    rl_initialize();  // Enable command editing and history
+    using_history();
+
+    while (1)
+        cmdline();
+
+    return (0);
+}
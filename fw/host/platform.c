@@ -0,0 +1,394 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host replacements for the board support code (timer, gpio, adc, led,
+ * button, clock, flash, DMA, and platform commands) which the pld engine
+ * and command line depend upon. Flash is simulated in memory. Timing is
+ * driven by the virtual CPU clock of the simulator, so firmware delays
+ * cost no host time.
+ */
+
+#include "printf.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "main.h"
+#include "cmdline.h"
+#include "cmds.h"
+#include "pcmds.h"
+#include "timer.h"
+#include "gpio.h"
+#include "adc.h"
+#include "led.h"
+#include "button.h"
+#include "clock.h"
+#include "stm32flash.h"
+#include "utils.h"
+#include "uart.h"
+#include "usb_bench.h"
+#include "mem_dma.h"
+#include "sim.h"
+
+uint32_t rcc_pclk2_frequency = SIM_HCLK;
+
+/*
+ * timer_tick_get
+ * --------------
+ * Returns the virtual tick timer, which runs at the CPU clock rate.
+ */
+uint64_t
+timer_tick_get(void)
+{
+    sim_advance(1);
+    return (sim_cycles);
+}
+
+void
+timer_delay_ticks(uint32_t ticks)
+{
+    sim_advance(ticks);
+}
+
+void
+timer_delay_usec(uint usec)
+{
+    sim_advance((uint64_t) usec * (SIM_HCLK / 1000000));
+}
+
+void
+timer_delay_msec(uint msec)
+{
+    sim_advance((uint64_t) msec * (SIM_HCLK / 1000));
+}
+
+uint64_t
+timer_usec_to_tick(uint usec)
+{
+    return ((uint64_t) usec * (SIM_HCLK / 1000000));
+}
+
+uint32_t
+timer_nsec_to_tick(uint nsec)
+{
+    return ((uint64_t) nsec * (SIM_HCLK / 1000000) / 1000);
+}
+
+uint64_t
+timer_tick_to_usec(uint64_t value)
+{
+    return (value / (SIM_HCLK / 1000000));
+}
+
+bool
+timer_tick_has_elapsed(uint64_t value)
+{
+    return ((int64_t) (timer_tick_get() - value) > 0);
+}
+
+uint64_t
+timer_tick_plus_msec(uint msec)
+{
+    return (timer_tick_get() + (uint64_t) msec * (SIM_HCLK / 1000));
+}
+
+uint64_t
+timer_tick_plus_usec(uint usec)
+{
+    return (timer_tick_get() + timer_usec_to_tick(usec));
+}
+
+bool
+dwt_enable_cycle_counter(void)
+{
+    return (true);
+}
+
+uint32_t
+dwt_read_cycle_counter(void)
+{
+    sim_advance(1);
+    return ((uint32_t) sim_cycles);
+}
+
+uint32_t
+clock_get_hclk(void)
+{
+    return (SIM_HCLK);
+}
+
+uint32_t
+clock_get_apb1(void)
+{
+    return (SIM_HCLK / 2);
+}
+
+uint32_t
+clock_get_apb2(void)
+{
+    return (SIM_HCLK);
+}
+
+void
+gpio_setv(uint32_t GPIOx, uint16_t GPIO_Pins, int value)
+{
+    sim_gpio_setv(GPIOx, GPIO_Pins, value);
+}
+
+void
+gpio_setmode(uint32_t GPIOx, uint16_t GPIO_Pins, uint value)
+{
+    sim_gpio_setmode(GPIOx, GPIO_Pins, value);
+}
+
+uint
+gpio_getmode(uint32_t GPIOx, uint pin)
+{
+    return (sim_gpio_getmode(GPIOx, pin));
+}
+
+void
+adc_enable(void)
+{
+}
+
+void
+adc_pulldown(void)
+{
+}
+
+uint
+adc_get_pld_readings(uint *pld_gnd)
+{
+    return (sim_rail_mv(pld_gnd));
+}
+
+void
+adc_show_sensors(void)
+{
+    uint pld_gnd;
+    uint pld_vcc = sim_rail_mv(&pld_gnd);
+
+    printf("PLD VCC=%u.%02uV GND=%u.%02uV (simulated)\n",
+           pld_vcc / 1000, pld_vcc % 1000 / 10,
+           pld_gnd / 1000, pld_gnd % 1000 / 10);
+}
+
+rc_t
+adc_get_pld_raw_sync(uint16_t *pld_vcc, uint16_t *pld_gnd)
+{
+    sim_advance(SIM_HCLK / 100000);  // ~10 usec per ADC sweep
+    sim_rail_raw(pld_vcc, pld_gnd);
+    return (RC_SUCCESS);
+}
+
+void
+led_power(int turn_on)
+{
+}
+
+void
+led_busy(int turn_on)
+{
+}
+
+void
+led_alert(int turn_on)
+{
+}
+
+void
+led_pld_vcc(int turn_on)
+{
+}
+
+int
+is_abort_button_pressed(void)
+{
+    return (0);
+}
+
+/*
+ * Simulated internal flash. As on the STM32F1, erase is by 2 KB page to
+ * all ones, and a programmed halfword may only be rewritten with zero.
+ */
+#define SIM_FLASH_SIZE      0x40000
+#define SIM_FLASH_PAGE_SIZE 2048
+
+static uint8_t sim_flash[SIM_FLASH_SIZE];
+static uint    sim_flash_ready;
+
+static void
+sim_flash_init(void)
+{
+    if (sim_flash_ready == 0) {
+        memset(sim_flash, 0xff, sizeof (sim_flash));
+        sim_flash_ready = 1;
+    }
+}
+
+int
+stm32flash_erase(uint32_t addr, uint len)
+{
+    uint32_t page;
+
+    if ((addr >= SIM_FLASH_SIZE) || (len > SIM_FLASH_SIZE - addr))
+        return (RC_BAD_PARAM);
+    sim_flash_init();
+    for (page = addr & ~(SIM_FLASH_PAGE_SIZE - 1); page < addr + len;
+         page += SIM_FLASH_PAGE_SIZE) {
+        memset(sim_flash + page, 0xff, SIM_FLASH_PAGE_SIZE);
+        sim_advance(SIM_HCLK / 50);  // ~20 msec page erase
+    }
+    return (0);
+}
+
+int
+stm32flash_write(uint32_t addr, uint len, void *buf, uint flags)
+{
+    const uint8_t *bufp = buf;
+    uint           pos;
+    int            rc = 0;
+
+    if ((addr >= SIM_FLASH_SIZE) || (len > SIM_FLASH_SIZE - addr))
+        return (RC_BAD_PARAM);
+    sim_flash_init();
+    if ((flags & STM32FLASH_FLAG_AUTOERASE) &&
+        ((addr & (SIM_FLASH_PAGE_SIZE - 1)) == 0)) {
+        (void) stm32flash_erase(addr, len);
+    }
+    for (pos = 0; pos < len; ) {
+        uint32_t half = (addr + pos) & ~1;
+        uint8_t  val[2] = { sim_flash[half], sim_flash[half + 1] };
+        uint16_t old = val[0] | (val[1] << 8);
+        uint16_t new;
+
+        for (; (pos < len) && (((addr + pos) & ~1) == half); pos++)
+            val[(addr + pos) & 1] = bufp[pos];
+        new = val[0] | (val[1] << 8);
+        if (new == old)
+            continue;
+        if ((old != 0xffff) && (new != 0)) {
+            rc++;  // Programming error: halfword not erased
+            continue;
+        }
+        sim_flash[half] = val[0];
+        sim_flash[half + 1] = val[1];
+        sim_advance(SIM_HCLK / 50000);  // ~20 usec halfword program
+    }
+    return (rc);
+}
+
+int
+stm32flash_read(uint32_t addr, uint len, void *buf)
+{
+    if ((addr >= SIM_FLASH_SIZE) || (len > SIM_FLASH_SIZE - addr))
+        return (RC_BAD_PARAM);
+    sim_flash_init();
+    memcpy(buf, sim_flash + addr, len);
+    return (0);
+}
+
+/*
+ * sim_dma_mem2mem
+ * ---------------
+ * Performs a DMA memory-to-memory transfer one item at a time, in the
+ * order the DMA controller would, so that a fill which copies from the
+ * preceding element behaves as on the target.
+ */
+void
+sim_dma_mem2mem(uintptr_t daddr, uintptr_t saddr, uint count, uint size,
+                bool_t src_inc)
+{
+    uint pos;
+
+    for (pos = 0; pos < count; pos++) {
+        memcpy((void *) daddr, (const void *) saddr, size);
+        daddr += size;
+        if (src_inc)
+            saddr += size;
+    }
+    sim_advance((uint64_t) count * SIM_DMA_CYCLES);
+}
+
+const char cmd_cpu_help[] = "cpu - not available in host build\n";
+const char cmd_gpio_help[] = "gpio - not available in host build\n";
+const char cmd_reset_help[] = "reset - exit the host build\n";
+const char cmd_usb_help[] =
+"usb bench recv <bytes>        - verify pattern upload from host\n"
+"usb bench send <bytes> [fast] - stream pattern to host (see sw/usbbench)\n"
+"Other usb commands are not available in host build\n";
+
+rc_t
+cmd_cpu(int argc, char * const *argv)
+{
+    printf("%s", cmd_cpu_help);
+    return (RC_FAILURE);
+}
+
+rc_t
+cmd_gpio(int argc, char * const *argv)
+{
+    printf("%s", cmd_gpio_help);
+    return (RC_FAILURE);
+}
+
+rc_t
+cmd_map(int argc, char * const *argv)
+{
+    printf("Host build: PLD socket is simulated; see \"sim\"\n");
+    return (RC_SUCCESS);
+}
+
+rc_t
+cmd_reset(int argc, char * const *argv)
+{
+    uart_flush();
+    exit(0);
+}
+
+rc_t
+cmd_usb(int argc, char * const *argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "bench") == 0))
+        return (usb_bench(argc - 1, argv + 1));
+    printf("%s", cmd_usb_help);
+    return (RC_FAILURE);
+}
+
+rc_t
+cmd_time(int argc, char * const *argv)
+{
+    rc_t rc;
+
+    if (argc <= 1)
+        return (RC_USER_HELP);
+
+    if (strncmp(argv[1], "cmd", 1) == 0) {
+        uint64_t time_start;
+        uint64_t time_diff;
+
+        if (argc <= 2) {
+            printf("error: time cmd requires command to execute\n");
+            return (RC_USER_HELP);
+        }
+        time_start = timer_tick_get();
+        rc = cmd_exec_argv(argc - 2, argv + 2);
+        time_diff = timer_tick_get() - time_start;
+        printf("%lld us\n", timer_tick_to_usec(time_diff));
+        if (rc == RC_USER_HELP)
+            rc = RC_FAILURE;
+    } else if (strncmp(argv[1], "now", 1) == 0) {
+        uint64_t now = timer_tick_get();
+        printf("tick=0x%llx uptime=%lld usec\n", now, timer_tick_to_usec(now));
+        rc = RC_SUCCESS;
+    } else {
+        printf("Unknown argument %s\n", argv[1]);
+        return (RC_USER_HELP);
+    }
+    return (rc);
+}
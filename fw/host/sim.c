@@ -0,0 +1,1300 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Simulated PLD socket for the host build.
+ *
+ * The STM32 GPIO ports which connect to the PLD socket are modelled
+ * here: PLD1-PLD28 (PE0-PE15, PC0-PC11) connect directly to the socket
+ * and PLDD1-PLDD28 (PD0-PD15, PA0-PA7, PB12-PB15) connect through 1K
+ * resistors. A device in the socket overrides whatever the STM32 drives
+ * on the pins it has output-enabled.
+ *
+ * The device is described by one of:
+ *   Equations - <pin>=<expr> and optionally <pin>.oe=<expr>, where
+ *               pins are named p1-p28 and expr uses ! & ^ | ( ) 0 1
+ *               (also / * + as in PALASM). A registered output is
+ *               given as <pin>:=<expr>, which is latched on the rising
+ *               edge of the clock pin (p1 unless set by "sim clock").
+ *               Registers are cleared when the device is powered off.
+ *   Capture   - A "pld walk values" or "pld walk raw" capture from a
+ *               real device, which is replayed by input vector.
+ *
+ * Time is virtual: it advances by a fixed cost per GPIO register access
+ * and by the requested amount for each firmware delay. Device outputs
+ * become visible a configurable propagation delay after the inputs
+ * which caused them change.
+ *
+ * For "pld watch", a target board may be simulated which powers the
+ * device and drives a binary count on selected pins, and the timer-paced
+ * DMA sampling of the PLD ports is performed here at virtual times.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+#include "main.h"
+#include "cmdline.h"
+#include "cmds.h"
+#include "utils.h"
+#include "gpio.h"
+#include "pld_port.h"
+#include "sim.h"
+
+#define SIM_PINS        28
+#define SIM_PIN_MASK    0x0fffffff
+#define SIM_PORTS       5        // GPIOA - GPIOE
+#define SIM_EVENTS      64       // Pending output changes
+#define SIM_EQ_CODE_MAX 128      // Opcodes per equation
+
+/* Equation opcodes; operands 0-27 push the state of PLD pin 1-28 */
+#define OP_PIN   0x00
+#define OP_ZERO  0x40
+#define OP_ONE   0x41
+#define OP_NOT   0x42
+#define OP_AND   0x43
+#define OP_XOR   0x44
+#define OP_OR    0x45
+
+#define MODEL_NONE     0
+#define MODEL_EQUATION 1
+#define MODEL_CAPTURE  2
+
+typedef struct {
+    uint8_t se_code[SIM_EQ_CODE_MAX];  // Reverse-polish opcodes
+    uint8_t se_len;                    // Number of opcodes
+} sim_eq_t;
+
+typedef struct {
+    uint32_t sc_write;  // PLDD_* vector written
+    uint32_t sc_read;   // PLD_* vector read back
+} sim_cap_t;
+
+typedef struct {
+    uint64_t sv_time;   // Cycle at which the change becomes visible
+    uint32_t sv_out;    // Device output values
+    uint32_t sv_oe;     // Device output enables
+} sim_event_t;
+
+uint64_t sim_cycles;
+volatile uint32_t sim_mmio[SIM_MMIO_WORDS];
+
+static uint       sim_model = MODEL_NONE;
+static uint       sim_delay_ns = 10;
+static uint64_t   sim_delay_cycles = 1;
+
+static sim_eq_t  *sim_eq[SIM_PINS];     // Output equations by pin
+static sim_eq_t  *sim_eq_oe[SIM_PINS];  // Output enable equations by pin
+static uint32_t   sim_reg_pins;         // Pins with registered equations
+static uint32_t   sim_reg_q;            // Register state
+static uint       sim_clock_pin;        // Register clock pin (0-27)
+static uint       sim_clock_prev;       // Clock pin level at last update
+
+static sim_cap_t *sim_cap;              // Capture, sorted by write vector
+static uint       sim_cap_count;
+static uint32_t   sim_cap_walked;       // Pins which vary in the capture
+static uint32_t   sim_cap_fixed;        // Value of pins which do not vary
+static uint32_t   sim_cap_outputs;      // Pins ever driven by the device
+static char       sim_cap_name[64];
+
+static uint16_t   sim_odr[SIM_PORTS];
+static uint8_t    sim_mode[SIM_PORTS][16];
+static uint16_t   sim_out_mask[SIM_PORTS];   // Pins in an output mode
+static uint16_t   sim_pull_mask[SIM_PORTS];  // Pins in pull-up/down mode
+
+static uint32_t   dev_out;              // Visible device output values
+static uint32_t   dev_oe;               // Visible device output enables
+static uint32_t   dev_next_out;         // Most recently scheduled outputs
+static uint32_t   dev_next_oe;          // Most recently scheduled enables
+static sim_event_t sim_events[SIM_EVENTS];
+static uint       sim_event_head;
+static uint       sim_event_tail;
+
+static uint32_t   sim_target_pins;      // Pins counted by simulated target
+static uint64_t   sim_target_cycles;    // Cycles per target count step
+static uint64_t   sim_target_step;      // Count step last applied
+static uint64_t   sim_sample_period;    // Cycles per "pld watch" sample
+static uint64_t   sim_sample_next;      // Cycle of the next sample
+static uint32_t   sim_sample_index;     // Next sample buffer position
+
+static uint64_t   sim_stat_writes;      // PLDD_* port writes
+static uint64_t   sim_stat_reads;       // PLD_* port reads
+
+static void sim_update(void);
+
+/*
+ * sim_port_index
+ * --------------
+ * Converts a GPIO port base address to an index for the simulator.
+ */
+static uint
+sim_port_index(uint32_t port)
+{
+    return ((port - GPIOA) / (GPIOB - GPIOA));
+}
+
+/*
+ * sim_advance
+ * -----------
+ * Advances the virtual CPU clock by the specified number of cycles.
+ */
+void
+sim_advance(uint64_t cycles)
+{
+    sim_cycles += cycles;
+}
+
+/*
+ * sim_set_delay
+ * -------------
+ * Sets the propagation delay of the simulated PLD, in nanoseconds.
+ */
+void
+sim_set_delay(uint nsec)
+{
+    sim_delay_ns = nsec;
+    sim_delay_cycles = ((uint64_t) nsec * (SIM_HCLK / 1000000) + 999) / 1000;
+}
+
+/*
+ * sim_pld_bits
+ * ------------
+ * Gathers the specified per-port bits for PLD1-PLD28 (PE0-PE15,
+ * PC0-PC11) into a 28-bit socket pin vector.
+ */
+static uint32_t
+sim_pld_bits(const uint16_t *bits)
+{
+    return (bits[sim_port_index(PLD1_PORT)] |
+            ((bits[sim_port_index(PLD17_PORT)] & 0x0fff) << 16));
+}
+
+/*
+ * sim_pldd_bits
+ * -------------
+ * Gathers the specified per-port bits for PLDD1-PLDD28 (PD0-PD15,
+ * PA0-PA7, PB12-PB15) into a 28-bit socket pin vector.
+ */
+static uint32_t
+sim_pldd_bits(const uint16_t *bits)
+{
+    return (bits[sim_port_index(PLDD1_PORT)] |
+            ((bits[sim_port_index(PLDD17_PORT)] & 0x00ff) << 16) |
+            ((bits[sim_port_index(PLDD25_PORT)] & 0xf000) << 12));
+}
+
+/*
+ * sim_stm32_drive
+ * ---------------
+ * Computes the values the STM32 presents to the socket in absence of a
+ * device driving the pins. The PLD_* pins connect directly, so they win
+ * over the PLDD_* resistors. Pull-up / pull-down modes are weakest.
+ */
+static uint32_t
+sim_stm32_drive(void)
+{
+    uint32_t pld_odr   = sim_pld_bits(sim_odr);
+    uint32_t pld_out   = sim_pld_bits(sim_out_mask);
+    uint32_t pld_pull  = sim_pld_bits(sim_pull_mask);
+    uint32_t pldd_odr  = sim_pldd_bits(sim_odr);
+    uint32_t pldd_out  = sim_pldd_bits(sim_out_mask) |
+                         sim_pldd_bits(sim_pull_mask);
+    uint32_t value;
+
+    value = (pldd_odr & pldd_out) | (pld_odr & pld_pull & ~pldd_out);
+    return (((pld_odr & pld_out) | (value & ~pld_out)) & SIM_PIN_MASK);
+}
+
+/*
+ * sim_external_drive
+ * ------------------
+ * Computes the values presented to the socket in absence of a device
+ * driving the pins: those of the STM32, overridden on the counted pins
+ * by the simulated target board.
+ */
+static uint32_t
+sim_external_drive(void)
+{
+    uint32_t value = sim_stm32_drive();
+    uint64_t step;
+    uint     pin;
+
+    if (sim_target_pins == 0)
+        return (value);
+    step = sim_cycles / sim_target_cycles;
+    for (pin = 0; pin < SIM_PINS; pin++) {
+        if ((sim_target_pins & BIT(pin)) == 0)
+            continue;
+        if (step & 1)
+            value |= BIT(pin);
+        else
+            value &= ~BIT(pin);
+        step >>= 1;
+    }
+    return (value);
+}
+
+/*
+ * sim_powered
+ * -----------
+ * Returns true if both the PLD VCC and GND rails are enabled, or the
+ * simulated target board powers the device.
+ */
+static bool
+sim_powered(void)
+{
+    if (sim_target_pins != 0)
+        return (true);
+    return ((sim_odr[sim_port_index(EN_VCC_PORT)] & EN_VCC_PIN) &&
+            (sim_odr[sim_port_index(EN_GND_PORT)] & EN_GND_PIN));
+}
+
+/*
+ * sim_eq_eval
+ * -----------
+ * Evaluates a compiled equation against the specified pin state.
+ */
+static uint
+sim_eq_eval(const sim_eq_t *eq, uint32_t pins)
+{
+    uint8_t stack[SIM_EQ_CODE_MAX];
+    uint    sp = 0;
+    uint    pos;
+
+    for (pos = 0; pos < eq->se_len; pos++) {
+        uint8_t op = eq->se_code[pos];
+        switch (op) {
+            case OP_ZERO:
+                stack[sp++] = 0;
+                break;
+            case OP_ONE:
+                stack[sp++] = 1;
+                break;
+            case OP_NOT:
+                stack[sp - 1] ^= 1;
+                break;
+            case OP_AND:
+                sp--;
+                stack[sp - 1] &= stack[sp];
+                break;
+            case OP_XOR:
+                sp--;
+                stack[sp - 1] ^= stack[sp];
+                break;
+            case OP_OR:
+                sp--;
+                stack[sp - 1] |= stack[sp];
+                break;
+            default:
+                stack[sp++] = (pins >> op) & 1;
+                break;
+        }
+    }
+    return (stack[0]);
+}
+
+/*
+ * sim_cap_compare
+ * ---------------
+ * Sort / search comparison of capture records by write vector.
+ */
+static int
+sim_cap_compare(const void *ptr1, const void *ptr2)
+{
+    const sim_cap_t *cap1 = ptr1;
+    const sim_cap_t *cap2 = ptr2;
+
+    if (cap1->sc_write < cap2->sc_write)
+        return (-1);
+    return (cap1->sc_write > cap2->sc_write);
+}
+
+/*
+ * sim_device_eval
+ * ---------------
+ * Computes the device outputs and output enables for the specified
+ * socket pin state.
+ */
+static void
+sim_device_eval(uint32_t pins, uint32_t *out, uint32_t *oe)
+{
+    uint pin;
+
+    *out = 0;
+    *oe = 0;
+    switch (sim_model) {
+        case MODEL_EQUATION:
+            for (pin = 0; pin < SIM_PINS; pin++) {
+                if (sim_eq[pin] == NULL)
+                    continue;
+                if ((sim_eq_oe[pin] != NULL) &&
+                    (sim_eq_eval(sim_eq_oe[pin], pins) == 0))
+                    continue;
+                *oe |= BIT(pin);
+                if (sim_reg_pins & BIT(pin))
+                    *out |= sim_reg_q & BIT(pin);
+                else
+                    *out |= sim_eq_eval(sim_eq[pin], pins) << pin;
+            }
+            break;
+        case MODEL_CAPTURE: {
+            sim_cap_t  key;
+            sim_cap_t *cap;
+
+            key.sc_write = (pins & sim_cap_walked) | sim_cap_fixed;
+            cap = bsearch(&key, sim_cap, sim_cap_count, sizeof (*sim_cap),
+                          sim_cap_compare);
+            if (cap != NULL) {
+                *oe = sim_cap_outputs;
+                *out = cap->sc_read & sim_cap_outputs;
+            }
+            break;
+        }
+    }
+}
+
+/*
+ * sim_settle
+ * ----------
+ * Makes visible all scheduled device output changes which are due.
+ */
+static void
+sim_settle(void)
+{
+    while (sim_event_tail != sim_event_head) {
+        sim_event_t *ev = &sim_events[sim_event_tail];
+        if (ev->sv_time > sim_cycles)
+            break;
+        dev_out = ev->sv_out;
+        dev_oe  = ev->sv_oe;
+        sim_event_tail = (sim_event_tail + 1) % SIM_EVENTS;
+    }
+}
+
+/*
+ * sim_clock_registers
+ * -------------------
+ * Latches the registered equations on a rising edge of the clock pin.
+ */
+static void
+sim_clock_registers(uint32_t drive)
+{
+    uint32_t pins = (drive & ~dev_next_oe) | (dev_next_out & dev_next_oe);
+    uint     clock = (pins >> sim_clock_pin) & 1;
+    uint     pin;
+
+    if (clock && !sim_clock_prev) {
+        uint32_t q = 0;
+        for (pin = 0; pin < SIM_PINS; pin++)
+            if (sim_reg_pins & BIT(pin))
+                q |= sim_eq_eval(sim_eq[pin], pins) << pin;
+        sim_reg_q = q;
+    }
+    sim_clock_prev = clock;
+}
+
+/*
+ * sim_update
+ * ----------
+ * Re-evaluates the device after the STM32 side of the socket has
+ * changed, and schedules any resulting output change to become visible
+ * after the propagation delay. Outputs of the device feed back as
+ * inputs, so evaluation is repeated until the result is stable.
+ */
+static void
+sim_update(void)
+{
+    uint32_t drive = sim_external_drive();
+    uint32_t out = dev_next_out;
+    uint32_t oe = dev_next_oe;
+    uint     iter;
+
+    if (sim_powered()) {
+        if (sim_reg_pins != 0)
+            sim_clock_registers(drive);
+        for (iter = 0; iter < 4; iter++) {
+            uint32_t pins = (drive & ~oe) | (out & oe);
+            uint32_t new_out;
+            uint32_t new_oe;
+            sim_device_eval(pins, &new_out, &new_oe);
+            if ((new_out == out) && (new_oe == oe))
+                break;
+            out = new_out;
+            oe = new_oe;
+        }
+    } else {
+        out = 0;
+        oe = 0;
+        sim_reg_q = 0;
+        sim_clock_prev = 0;
+    }
+
+    if ((out == dev_next_out) && (oe == dev_next_oe))
+        return;
+
+    if ((sim_event_head + 1) % SIM_EVENTS == sim_event_tail) {
+        /* Queue is full: the oldest change becomes visible now */
+        dev_out = sim_events[sim_event_tail].sv_out;
+        dev_oe  = sim_events[sim_event_tail].sv_oe;
+        sim_event_tail = (sim_event_tail + 1) % SIM_EVENTS;
+    }
+    sim_events[sim_event_head].sv_time = sim_cycles + sim_delay_cycles;
+    sim_events[sim_event_head].sv_out = out;
+    sim_events[sim_event_head].sv_oe = oe;
+    sim_event_head = (sim_event_head + 1) % SIM_EVENTS;
+    dev_next_out = out;
+    dev_next_oe = oe;
+}
+
+/*
+ * sim_reset_device
+ * ----------------
+ * Discards any device state after the model has changed.
+ */
+static void
+sim_reset_device(void)
+{
+    sim_event_head = 0;
+    sim_event_tail = 0;
+    dev_out = 0;
+    dev_oe = 0;
+    dev_next_out = 0;
+    dev_next_oe = 0;
+    sim_reg_q = 0;
+    sim_clock_prev = 0;
+    sim_update();
+}
+
+/*
+ * sim_socket_pins
+ * ---------------
+ * Returns the current visible state of the socket pins.
+ */
+static uint32_t
+sim_socket_pins(void)
+{
+    if ((sim_target_pins != 0) &&
+        (sim_cycles / sim_target_cycles != sim_target_step)) {
+        /* Evaluate the device as of the target count step */
+        uint64_t now = sim_cycles;
+        sim_target_step = now / sim_target_cycles;
+        sim_cycles = sim_target_step * sim_target_cycles;
+        sim_update();
+        sim_cycles = now;
+    }
+    sim_settle();
+    return ((sim_external_drive() & ~dev_oe) | (dev_out & dev_oe));
+}
+
+/*
+ * sim_port_idr
+ * ------------
+ * Returns the GPIO input value of the specified port. Pins which
+ * connect to the socket report the socket state, except PLDD_* pins
+ * which are driving (the 1K resistor isolates them from the socket).
+ */
+uint32_t
+sim_port_idr(uint32_t port)
+{
+    uint     index = sim_port_index(port);
+    uint32_t pins;
+    uint32_t socket;
+    uint32_t value;
+    uint32_t mask;
+
+    sim_cycles += SIM_PORT_CYCLES;
+    if (index >= SIM_PORTS)
+        return (0);
+    if ((port == PLD1_PORT) || (port == PLD17_PORT))
+        sim_stat_reads++;
+
+    /* Outputs and pull-up / pull-down inputs read back the ODR */
+    value = sim_odr[index] & (sim_out_mask[index] | sim_pull_mask[index]);
+
+    /* Socket pins which are not driving report the socket state */
+    pins = sim_socket_pins();
+    if ((port == PLD1_PORT) || (port == PLDD1_PORT)) {
+        socket = pins & 0xffff;
+        mask = 0xffff;
+    } else if (port == PLD17_PORT) {
+        socket = (pins >> 16) & 0x0fff;
+        mask = 0x0fff;
+    } else if (port == PLDD17_PORT) {
+        socket = (pins >> 16) & 0x00ff;
+        mask = 0x00ff;
+    } else if (port == PLDD25_PORT) {
+        socket = (pins >> 12) & 0xf000;
+        mask = 0xf000;
+    } else {
+        return (value);
+    }
+    mask &= ~sim_out_mask[index];
+    value = (value & ~mask) | (socket & mask);
+    return (value);
+}
+
+/*
+ * sim_port_sample_start
+ * ---------------------
+ * Starts simulated timer-paced DMA sampling of the PLD_* ports, with
+ * the specified sample period in cycles.
+ */
+void
+sim_port_sample_start(uint32_t period)
+{
+    sim_sample_period = period;
+    sim_sample_next = sim_cycles + period;
+    sim_sample_index = 0;
+}
+
+/*
+ * sim_port_sample_pos
+ * -------------------
+ * Takes all samples of PLD1-PLD16 and PLD17-PLD28 which are due, each
+ * at its own virtual time, into the circular sample buffers. Returns
+ * the position of the next sample to be written. Each call lets at
+ * least one sample period pass, so the firmware waiting for samples
+ * costs little host time.
+ */
+uint32_t
+sim_port_sample_pos(uint16_t *buf_lo, uint16_t *buf_hi, uint32_t samples)
+{
+    uint64_t now = sim_cycles + sim_sample_period;
+
+    while (sim_sample_next <= now) {
+        sim_cycles = sim_sample_next;
+        buf_lo[sim_sample_index] = sim_port_idr(PLD1_PORT);
+        buf_hi[sim_sample_index] = sim_port_idr(PLD17_PORT);
+        sim_sample_index = (sim_sample_index + 1) % samples;
+        sim_sample_next += sim_sample_period;
+    }
+    sim_cycles = now;
+    return (sim_sample_index);
+}
+
+/*
+ * sim_port_odr
+ * ------------
+ * Returns the GPIO output register value of the specified port.
+ */
+uint32_t
+sim_port_odr(uint32_t port)
+{
+    uint index = sim_port_index(port);
+
+    sim_cycles += SIM_PORT_CYCLES;
+    if (index >= SIM_PORTS)
+        return (0);
+    return (sim_odr[index]);
+}
+
+/*
+ * sim_port_odr_write
+ * ------------------
+ * Writes the GPIO output register of the specified port.
+ */
+void
+sim_port_odr_write(uint32_t port, uint32_t value)
+{
+    uint index = sim_port_index(port);
+
+    sim_cycles += SIM_PORT_CYCLES;
+    if (index >= SIM_PORTS)
+        return;
+    if (port == PLDD1_PORT)
+        sim_stat_writes++;
+    sim_odr[index] = value;
+    sim_update();
+}
+
+/*
+ * sim_port_bsrr_write
+ * -------------------
+ * Writes the GPIO bit set / reset register of the specified port.
+ * As on the STM32, set takes priority over reset for the same bit.
+ */
+void
+sim_port_bsrr_write(uint32_t port, uint32_t value)
+{
+    uint index = sim_port_index(port);
+
+    sim_cycles += SIM_PORT_CYCLES;
+    if (index >= SIM_PORTS)
+        return;
+    sim_odr[index] &= ~(value >> 16);
+    sim_odr[index] |= value & 0xffff;
+    sim_update();
+}
+
+/*
+ * sim_gpio_setv
+ * -------------
+ * Sets or clears the output value of the specified GPIO pins.
+ */
+void
+sim_gpio_setv(uint32_t port, uint16_t pins, int value)
+{
+    sim_port_bsrr_write(port, value ? pins : ((uint32_t) pins << 16));
+}
+
+/*
+ * sim_gpio_setmode
+ * ----------------
+ * Sets the mode of the specified GPIO pins.
+ */
+void
+sim_gpio_setmode(uint32_t port, uint16_t pins, uint mode)
+{
+    uint index = sim_port_index(port);
+    uint pin;
+
+    if (index >= SIM_PORTS)
+        return;
+    for (pin = 0; pin < 16; pin++) {
+        if ((pins & BIT(pin)) == 0)
+            continue;
+        sim_mode[index][pin] = mode;
+        sim_out_mask[index] &= ~BIT(pin);
+        sim_pull_mask[index] &= ~BIT(pin);
+        if ((mode & 0x3) != 0)
+            sim_out_mask[index] |= BIT(pin);
+        else if (mode == GPIO_SETMODE_INPUT_PULLUPDOWN)
+            sim_pull_mask[index] |= BIT(pin);
+    }
+    sim_update();
+}
+
+/*
+ * sim_gpio_getmode
+ * ----------------
+ * Returns the mode of the specified GPIO pin.
+ */
+uint
+sim_gpio_getmode(uint32_t port, uint pin)
+{
+    uint index = sim_port_index(port);
+
+    if (index >= SIM_PORTS)
+        return (GPIO_SETMODE_INPUT);
+    return (sim_mode[index][pin & 0xf]);
+}
+
+/*
+ * gpio_get
+ * --------
+ * Returns the input state of the specified GPIO pins.
+ */
+uint16_t
+gpio_get(uint32_t port, uint16_t pins)
+{
+    return (sim_port_idr(port) & pins);
+}
+
+/*
+ * sim_rail_raw
+ * ------------
+ * Returns raw ADC readings for the PLD VCC and GND rails. A powered
+ * device sags VCC slightly for each output it is driving high, which
+ * gives "pld walk power" something to correlate.
+ */
+void
+sim_rail_raw(uint16_t *pld_vcc, uint16_t *pld_gnd)
+{
+    uint high;
+
+    *pld_vcc = 0x006;  // Rails float a little above 0V when unpowered
+    *pld_gnd = 0x00c;
+    if ((sim_odr[sim_port_index(EN_VCC_PORT)] & EN_VCC_PIN) == 0)
+        return;
+
+    *pld_vcc = 0xc1c;  // 5V through the 2:1 divider
+    sim_settle();
+    if (sim_powered()) {
+        high = __builtin_popcount(dev_out & dev_oe);
+        *pld_vcc -= high * 3;
+        *pld_gnd = 0x008 + high;
+    }
+}
+
+/*
+ * sim_rail_mv
+ * -----------
+ * Returns the PLD VCC rail voltage in millivolts, and updates pld_gnd
+ * with the PLD GND rail voltage.
+ */
+uint
+sim_rail_mv(uint *pld_gnd)
+{
+    uint16_t vcc;
+    uint16_t gnd;
+
+    sim_rail_raw(&vcc, &gnd);
+    *pld_gnd = gnd * 3300 / 4096;
+    return (vcc * 3300 * 2 / 4096);
+}
+
+/*
+ * sim_eq_parse_pin
+ * ----------------
+ * Parses a pin name (p1-p28) and returns the pin number (0-27).
+ */
+static int
+sim_eq_parse_pin(const char **str)
+{
+    const char *ptr = *str;
+    int         pin;
+
+    if ((*ptr != 'p') && (*ptr != 'P'))
+        return (-1);
+    ptr++;
+    if (!isdigit((uint8_t) *ptr))
+        return (-1);
+    pin = strtoul(ptr, (char **) &ptr, 10);
+    if ((pin < 1) || (pin > SIM_PINS))
+        return (-1);
+    *str = ptr;
+    return (pin - 1);
+}
+
+static int sim_eq_parse_or(const char **str, sim_eq_t *eq);
+
+/*
+ * sim_eq_emit
+ * -----------
+ * Appends an opcode to the equation being compiled.
+ */
+static int
+sim_eq_emit(sim_eq_t *eq, uint8_t op)
+{
+    if (eq->se_len >= SIM_EQ_CODE_MAX)
+        return (-1);
+    eq->se_code[eq->se_len++] = op;
+    return (0);
+}
+
+/*
+ * sim_eq_skip
+ * -----------
+ * Skips whitespace in an equation.
+ */
+static void
+sim_eq_skip(const char **str)
+{
+    while (isspace((uint8_t) **str))
+        (*str)++;
+}
+
+/*
+ * sim_eq_parse_factor
+ * -------------------
+ * Parses a pin, constant, negation, or parenthesized expression.
+ */
+static int
+sim_eq_parse_factor(const char **str, sim_eq_t *eq)
+{
+    int pin;
+
+    sim_eq_skip(str);
+    switch (**str) {
+        case '!':
+        case '/':
+        case '~':
+            (*str)++;
+            if (sim_eq_parse_factor(str, eq))
+                return (-1);
+            return (sim_eq_emit(eq, OP_NOT));
+        case '(':
+            (*str)++;
+            if (sim_eq_parse_or(str, eq))
+                return (-1);
+            sim_eq_skip(str);
+            if (**str != ')')
+                return (-1);
+            (*str)++;
+            return (0);
+        case '0':
+            (*str)++;
+            return (sim_eq_emit(eq, OP_ZERO));
+        case '1':
+            (*str)++;
+            return (sim_eq_emit(eq, OP_ONE));
+    }
+    pin = sim_eq_parse_pin(str);
+    if (pin < 0)
+        return (-1);
+    return (sim_eq_emit(eq, OP_PIN + pin));
+}
+
+/*
+ * sim_eq_parse_and
+ * ----------------
+ * Parses a sequence of factors joined by AND.
+ */
+static int
+sim_eq_parse_and(const char **str, sim_eq_t *eq)
+{
+    if (sim_eq_parse_factor(str, eq))
+        return (-1);
+    while (1) {
+        sim_eq_skip(str);
+        if ((**str != '&') && (**str != '*'))
+            return (0);
+        (*str)++;
+        if (sim_eq_parse_factor(str, eq) || sim_eq_emit(eq, OP_AND))
+            return (-1);
+    }
+}
+
+/*
+ * sim_eq_parse_xor
+ * ----------------
+ * Parses a sequence of AND terms joined by XOR.
+ */
+static int
+sim_eq_parse_xor(const char **str, sim_eq_t *eq)
+{
+    if (sim_eq_parse_and(str, eq))
+        return (-1);
+    while (1) {
+        sim_eq_skip(str);
+        if (**str != '^')
+            return (0);
+        (*str)++;
+        if (sim_eq_parse_and(str, eq) || sim_eq_emit(eq, OP_XOR))
+            return (-1);
+    }
+}
+
+/*
+ * sim_eq_parse_or
+ * ---------------
+ * Parses a sequence of XOR terms joined by OR.
+ */
+static int
+sim_eq_parse_or(const char **str, sim_eq_t *eq)
+{
+    if (sim_eq_parse_xor(str, eq))
+        return (-1);
+    while (1) {
+        sim_eq_skip(str);
+        if ((**str != '|') && (**str != '+'))
+            return (0);
+        (*str)++;
+        if (sim_eq_parse_xor(str, eq) || sim_eq_emit(eq, OP_OR))
+            return (-1);
+    }
+}
+
+/*
+ * sim_load_equation
+ * -----------------
+ * Compiles a single <pin>=<expr> or <pin>.oe=<expr> equation.
+ */
+static rc_t
+sim_load_equation(const char *text)
+{
+    const char *ptr = text;
+    sim_eq_t   *eq;
+    sim_eq_t  **slot;
+    int         pin;
+    int         registered = 0;
+
+    sim_eq_skip(&ptr);
+    if (*ptr == '\0')
+        return (RC_SUCCESS);
+    pin = sim_eq_parse_pin(&ptr);
+    if (pin < 0) {
+        printf("Invalid pin in equation: %s\n", text);
+        return (RC_BAD_PARAM);
+    }
+    if (strncasecmp(ptr, ".oe", 3) == 0) {
+        ptr += 3;
+        slot = &sim_eq_oe[pin];
+    } else {
+        slot = &sim_eq[pin];
+    }
+    sim_eq_skip(&ptr);
+    if ((slot == &sim_eq[pin]) && (ptr[0] == ':') && (ptr[1] == '=')) {
+        registered = 1;
+        ptr++;
+    }
+    if (*ptr != '=') {
+        printf("Missing = in equation: %s\n", text);
+        return (RC_BAD_PARAM);
+    }
+    ptr++;
+
+    eq = calloc(1, sizeof (*eq));
+    if (eq == NULL)
+        return (RC_FAILURE);
+    if (sim_eq_parse_or(&ptr, eq) != 0) {
+        printf("Invalid equation at \"%s\": %s\n", ptr, text);
+        free(eq);
+        return (RC_BAD_PARAM);
+    }
+    sim_eq_skip(&ptr);
+    if (*ptr != '\0') {
+        printf("Unexpected \"%s\" in equation: %s\n", ptr, text);
+        free(eq);
+        return (RC_BAD_PARAM);
+    }
+    free(*slot);
+    *slot = eq;
+    if (slot == &sim_eq[pin]) {
+        if (registered)
+            sim_reg_pins |= BIT(pin);
+        else
+            sim_reg_pins &= ~BIT(pin);
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * sim_clear_model
+ * ---------------
+ * Removes the device from the simulated socket.
+ */
+static void
+sim_clear_model(void)
+{
+    uint pin;
+
+    for (pin = 0; pin < SIM_PINS; pin++) {
+        free(sim_eq[pin]);
+        free(sim_eq_oe[pin]);
+        sim_eq[pin] = NULL;
+        sim_eq_oe[pin] = NULL;
+    }
+    sim_reg_pins = 0;
+    free(sim_cap);
+    sim_cap = NULL;
+    sim_cap_count = 0;
+    sim_model = MODEL_NONE;
+    sim_reset_device();
+}
+
+/*
+ * sim_load_equations
+ * ------------------
+ * Adds one or more equations, separated by ';' or newline, to the
+ * simulated device. A capture which was previously loaded is discarded.
+ */
+rc_t
+sim_load_equations(const char *text)
+{
+    char  line[512];
+    rc_t  rc = RC_SUCCESS;
+
+    if (sim_model == MODEL_CAPTURE)
+        sim_clear_model();
+
+    while (*text != '\0') {
+        size_t len = strcspn(text, ";\n");
+        char  *comment;
+
+        if (len >= sizeof (line)) {
+            printf("Equation too long\n");
+            return (RC_BAD_PARAM);
+        }
+        memcpy(line, text, len);
+        line[len] = '\0';
+        comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        rc = sim_load_equation(line);
+        if (rc != RC_SUCCESS)
+            break;
+        text += len;
+        if (*text != '\0')
+            text++;
+    }
+    sim_model = MODEL_EQUATION;
+    sim_reset_device();
+    return (rc);
+}
+
+/*
+ * sim_load_equation_file
+ * ----------------------
+ * Loads device equations from a file, one per line.
+ */
+rc_t
+sim_load_equation_file(const char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    char  line[512];
+    rc_t  rc = RC_SUCCESS;
+
+    if (fp == NULL) {
+        printf("Could not open %s\n", filename);
+        return (RC_FAILURE);
+    }
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        rc = sim_load_equations(line);
+        if (rc != RC_SUCCESS)
+            break;
+    }
+    fclose(fp);
+    return (rc);
+}
+
+/*
+ * sim_cap_add
+ * -----------
+ * Appends a record to the capture being loaded.
+ */
+static rc_t
+sim_cap_add(uint *alloc, uint32_t write, uint32_t read)
+{
+    if (sim_cap_count >= *alloc) {
+        sim_cap_t *ncap;
+        *alloc = (*alloc == 0) ? 4096 : (*alloc * 2);
+        ncap = realloc(sim_cap, *alloc * sizeof (*sim_cap));
+        if (ncap == NULL) {
+            printf("Out of memory loading capture\n");
+            return (RC_FAILURE);
+        }
+        sim_cap = ncap;
+    }
+    sim_cap[sim_cap_count].sc_write = write & SIM_PIN_MASK;
+    sim_cap[sim_cap_count].sc_read = read & SIM_PIN_MASK;
+    sim_cap_count++;
+    return (RC_SUCCESS);
+}
+
+/*
+ * sim_load_capture
+ * ----------------
+ * Loads a capture from "pld walk values" (ASCII) or "pld walk raw"
+ * (binary) to be replayed as the simulated device. Pins which were
+ * seen to differ from the value written are treated as device outputs.
+ */
+rc_t
+sim_load_capture(const char *filename)
+{
+    FILE    *fp = fopen(filename, "rb");
+    char     line[256];
+    uint     alloc = 0;
+    uint     pos;
+    uint32_t bytes;
+    rc_t     rc = RC_SUCCESS;
+
+    if (fp == NULL) {
+        printf("Could not open %s\n", filename);
+        return (RC_FAILURE);
+    }
+    sim_clear_model();
+
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        unsigned long write;
+        unsigned long read;
+
+        if (sscanf(line, "---- BYTES=%x", &bytes) == 1) {
+            /* Binary records: write, read, and optional power */
+            uint     rec_size = (strstr(line, " POWER ") != NULL) ? 12 : 8;
+            uint32_t rec[3];
+            for (pos = 0; pos < bytes / rec_size; pos++) {
+                if (fread(rec, rec_size, 1, fp) != 1)
+                    break;
+                rc = sim_cap_add(&alloc, rec[0], rec[1]);
+                if (rc != RC_SUCCESS)
+                    break;
+            }
+            continue;
+        }
+        if (strncmp(line, "----", 4) == 0)
+            continue;
+        if (sscanf(line, "%lx %lx", &write, &read) != 2)
+            continue;
+        rc = sim_cap_add(&alloc, write, read);
+        if (rc != RC_SUCCESS)
+            break;
+    }
+    fclose(fp);
+
+    if (sim_cap_count == 0) {
+        printf("No capture records found in %s\n", filename);
+        return (RC_FAILURE);
+    }
+
+    qsort(sim_cap, sim_cap_count, sizeof (*sim_cap), sim_cap_compare);
+    sim_cap_walked = 0;
+    sim_cap_outputs = 0;
+    for (pos = 0; pos < sim_cap_count; pos++) {
+        sim_cap_walked |= sim_cap[pos].sc_write ^ sim_cap[0].sc_write;
+        sim_cap_outputs |= sim_cap[pos].sc_write ^ sim_cap[pos].sc_read;
+    }
+    sim_cap_fixed = sim_cap[0].sc_write & ~sim_cap_walked;
+    snprintf(sim_cap_name, sizeof (sim_cap_name), "%s", filename);
+    sim_model = MODEL_CAPTURE;
+    sim_reset_device();
+    return (rc);
+}
+
+/*
+ * sim_show
+ * --------
+ * Displays the simulated device and socket state.
+ */
+static void
+sim_show(void)
+{
+    uint32_t pins;
+    uint     pin;
+
+    printf("Model:  ");
+    switch (sim_model) {
+        case MODEL_NONE:
+            printf("empty socket\n");
+            break;
+        case MODEL_EQUATION:
+            printf("equations for");
+            for (pin = 0; pin < SIM_PINS; pin++)
+                if (sim_eq[pin] != NULL)
+                    printf(" p%u%s%s", pin + 1,
+                           (sim_reg_pins & BIT(pin)) ? "(reg)" : "",
+                           (sim_eq_oe[pin] != NULL) ? "(oe)" : "");
+            printf("\n");
+            if (sim_reg_pins != 0)
+                printf("Clock:  p%u  registers %07x\n",
+                       sim_clock_pin + 1, sim_reg_q & sim_reg_pins);
+            break;
+        case MODEL_CAPTURE:
+            printf("capture %s, %u vectors, walked %07x outputs %07x\n",
+                   sim_cap_name, sim_cap_count, sim_cap_walked,
+                   sim_cap_outputs);
+            break;
+    }
+    printf("Delay:  %u ns (%u cycles)\n",
+           sim_delay_ns, (uint) sim_delay_cycles);
+    printf("Power:  %s\n", sim_powered() ? "on" : "off");
+    if (sim_target_pins != 0)
+        printf("Target: counting on %07x every %llu cycles\n",
+               sim_target_pins, (unsigned long long) sim_target_cycles);
+    pins = sim_socket_pins();
+    printf("Socket: %07x  outputs %07x oe %07x\n", pins, dev_out, dev_oe);
+    printf("Time:   %llu cycles; %llu PLDD writes, %llu PLD reads\n",
+           (unsigned long long) sim_cycles,
+           (unsigned long long) sim_stat_writes,
+           (unsigned long long) sim_stat_reads);
+}
+
+/*
+ * sim_bench
+ * ---------
+ * Runs a command and reports host execution time and the rate at which
+ * the firmware applied vectors to the simulated socket.
+ */
+static rc_t
+sim_bench(int argc, char * const *argv)
+{
+    struct timespec start;
+    struct timespec end;
+    uint64_t        writes = sim_stat_writes;
+    uint64_t        cycles = sim_cycles;
+    uint64_t        usec;
+    rc_t            rc;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    rc = cmd_exec_argv(argc, argv);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    usec = (end.tv_sec - start.tv_sec) * 1000000ULL +
+           (end.tv_nsec - start.tv_nsec) / 1000;
+    if (usec == 0)
+        usec = 1;
+    writes = sim_stat_writes - writes;
+    cycles = sim_cycles - cycles;
+    printf("Host %llu us, %llu vectors, %llu vectors/sec; "
+           "simulated target %llu us\n",
+           (unsigned long long) usec, (unsigned long long) writes,
+           (unsigned long long) (writes * 1000000 / usec),
+           (unsigned long long) (cycles / (SIM_HCLK / 1000000)));
+    return (rc);
+}
+
+const char cmd_sim_help[] =
+"sim                     - show simulated PLD state\n"
+"sim bench <cmd>         - report host time and vectors/sec of <cmd>\n"
+"sim clear               - remove device from socket\n"
+"sim clock <pin>         - set register clock pin (default 1)\n"
+"sim delay <ns>          - set device propagation delay\n"
+"sim eq <pin>=<expr>...  - add device equation (p1-p28, ! & ^ | ( ))\n"
+"                          <pin>:=<expr> is registered on the clock pin\n"
+"sim eqfile <filename>   - load device equations from a file\n"
+"sim load <filename>     - replay a pld walk values or raw capture\n"
+"sim target <mask> <ns>  - target board powers the device and counts\n"
+"                          on pins <mask>, one step each <ns> (0 for off)\n";
+
+rc_t
+cmd_sim(int argc, char * const *argv)
+{
+    rc_t rc = RC_SUCCESS;
+    int  arg;
+
+    if (argc <= 1) {
+        sim_show();
+        return (RC_SUCCESS);
+    }
+    if (strcmp(argv[1], "bench") == 0) {
+        if (argc < 3)
+            return (RC_USER_HELP);
+        return (sim_bench(argc - 2, argv + 2));
+    } else if (strcmp(argv[1], "clear") == 0) {
+        sim_clear_model();
+    } else if (strcmp(argv[1], "clock") == 0) {
+        uint pin;
+        if ((argc != 3) || (parse_uint(argv[2], &pin) != RC_SUCCESS) ||
+            (pin < 1) || (pin > SIM_PINS))
+            return (RC_USER_HELP);
+        sim_clock_pin = pin - 1;
+        sim_reset_device();
+    } else if (strcmp(argv[1], "delay") == 0) {
+        uint nsec;
+        if ((argc != 3) || (parse_uint(argv[2], &nsec) != RC_SUCCESS))
+            return (RC_USER_HELP);
+        sim_set_delay(nsec);
+    } else if (strcmp(argv[1], "eq") == 0) {
+        if (argc < 3)
+            return (RC_USER_HELP);
+        for (arg = 2; (arg < argc) && (rc == RC_SUCCESS); arg++)
+            rc = sim_load_equations(argv[arg]);
+    } else if (strcmp(argv[1], "eqfile") == 0) {
+        if (argc != 3)
+            return (RC_USER_HELP);
+        rc = sim_load_equation_file(argv[2]);
+    } else if (strcmp(argv[1], "load") == 0) {
+        if (argc != 3)
+            return (RC_USER_HELP);
+        rc = sim_load_capture(argv[2]);
+    } else if (strcmp(argv[1], "target") == 0) {
+        uint mask;
+        uint nsec = 0;
+        if ((argc < 3) || (argc > 4) ||
+            (parse_uint(argv[2], &mask) != RC_SUCCESS) ||
+            ((argc == 4) && (parse_uint(argv[3], &nsec) != RC_SUCCESS)))
+            return (RC_USER_HELP);
+        sim_target_cycles = (uint64_t) nsec * (SIM_HCLK / 1000000) / 1000;
+        if ((mask & SIM_PIN_MASK) == 0)
+            sim_target_pins = 0;
+        else if (sim_target_cycles == 0)
+            return (RC_USER_HELP);
+        else
+            sim_target_pins = mask & SIM_PIN_MASK;
+        sim_target_step = 0;
+        sim_reset_device();
+    } else {
+        printf("Unknown argument %s\n", argv[1]);
+        return (RC_USER_HELP);
+    }
+    return (rc);
+}
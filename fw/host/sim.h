@@ -0,0 +1,36 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Simulated PLD socket for the host build.
+ */
+
+#ifndef _SIM_H
+#define _SIM_H
+
+#define SIM_HCLK        72000000  // Simulated CPU clock (Hz)
+#define SIM_PORT_CYCLES 2         // CPU cycles per GPIO register access
+#define SIM_DMA_CYCLES  5         // CPU cycles per DMA memory-to-memory item
+
+extern uint64_t sim_cycles;
+
+void     sim_advance(uint64_t cycles);
+void     sim_set_delay(uint nsec);
+rc_t     sim_load_equations(const char *text);
+rc_t     sim_load_equation_file(const char *filename);
+rc_t     sim_load_capture(const char *filename);
+
+void     sim_gpio_setv(uint32_t port, uint16_t pins, int value);
+void     sim_gpio_setmode(uint32_t port, uint16_t pins, uint mode);
+uint     sim_gpio_getmode(uint32_t port, uint pin);
+uint     sim_rail_mv(uint *pld_gnd);
+void     sim_rail_raw(uint16_t *pld_vcc, uint16_t *pld_gnd);
+
+rc_t cmd_sim(int argc, char * const *argv);
+extern const char cmd_sim_help[];
+
+#endif /* _SIM_H */
@@ -0,0 +1,139 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Host check of the pld measure statistics and speed grade classifier.
+ *
+ * Feeds synthetic loop period samples with known statistics to
+ * pld_stats_compute(), and loop periods on either side of each speed
+ * grade band boundary to pld_speed_classify().
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "printf.h"
+#include "main.h"
+#include "utils.h"
+#include "uart.h"
+#include "pld_stats.h"
+
+static uint failures;
+
+/*
+ * check_value
+ * -----------
+ * Report a mismatch between a computed and expected value.
+ */
+static void
+check_value(const char *name, uint32_t value, uint32_t expect)
+{
+    if (value != expect) {
+        printf("FAIL %s=%u, expected %u\n", name, value, expect);
+        failures++;
+    }
+}
+
+/*
+ * check_stats
+ * -----------
+ * Compute statistics for the specified samples and verify the results.
+ * The expected histogram is given as a list of bin counts; bins beyond
+ * the list must be empty.
+ */
+static void
+check_stats(const char *name, const uint16_t *samples, uint count,
+            uint32_t min, uint32_t max, uint32_t mean_x256,
+            uint32_t stddev_x256, uint32_t hist_width,
+            const uint32_t *hist, uint hist_bins)
+{
+    pld_stats_t stats;
+    uint        bin;
+
+    printf("%-10s", name);
+    pld_stats_compute(samples, count, &stats);
+    check_value("count", stats.ps_count, count);
+    check_value("min", stats.ps_min, min);
+    check_value("max", stats.ps_max, max);
+    check_value("mean_x256", stats.ps_mean_x256, mean_x256);
+    check_value("stddev_x256", stats.ps_stddev_x256, stddev_x256);
+    check_value("hist_base", stats.ps_hist_base, min);
+    check_value("hist_width", stats.ps_hist_width, hist_width);
+    for (bin = 0; bin < PLD_STATS_HIST_BINS; bin++)
+        check_value("hist", stats.ps_hist[bin],
+                    (bin < hist_bins) ? hist[bin] : 0);
+    printf("done\n");
+}
+
+/*
+ * check_grade
+ * -----------
+ * Classify the specified loop period and verify the grade band and the
+ * closest reference part.
+ */
+static void
+check_grade(uint loop_ps, const char *grade, const char *part)
+{
+    const pld_speed_ref_t *ref;
+    const char            *got = pld_speed_classify(loop_ps, &ref);
+
+    printf("%7u ps  %-14s %s\n", loop_ps, got, ref->psr_part);
+    if (strcmp(got, grade) != 0) {
+        printf("FAIL grade %s, expected %s\n", got, grade);
+        failures++;
+    }
+    if ((part != NULL) && (strcmp(ref->psr_part, part) != 0)) {
+        printf("FAIL reference %s, expected %s\n", ref->psr_part, part);
+        failures++;
+    }
+}
+
+int
+main(void)
+{
+    static const uint16_t flat[] = { 10, 10, 10, 10 };
+    static const uint32_t flat_hist[] = { 4 };
+    static const uint16_t small[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+    static const uint32_t small_hist[] = { 1, 0, 3, 2, 0, 1, 0, 1 };
+    static const uint32_t ramp_hist[] = {
+        10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10, 10
+    };
+    uint16_t ramp[160];
+    uint     cur;
+
+    for (cur = 0; cur < ARRAY_SIZE(ramp); cur++)
+        ramp[cur] = 100 + cur;
+
+    /* Population stddev: 0, exactly 2, and sqrt((160^2 - 1) / 12) */
+    check_stats("flat", flat, ARRAY_SIZE(flat), 10, 10, 10 * 256, 0, 1,
+                flat_hist, ARRAY_SIZE(flat_hist));
+    check_stats("small", small, ARRAY_SIZE(small), 2, 9, 5 * 256, 2 * 256,
+                1, small_hist, ARRAY_SIZE(small_hist));
+    check_stats("ramp", ramp, ARRAY_SIZE(ramp), 100, 259, 45952, 11823, 10,
+                ramp_hist, ARRAY_SIZE(ramp_hist));
+    check_stats("empty", NULL, 0, 0, 0, 0, 0, 0, NULL, 0);
+
+    /* Each side of the band boundaries at 61.7 ns and 93.0 ns */
+    check_grade(45500, "-5", "GAL22V10D-5LJ");
+    check_grade(61799, "-5", NULL);
+    check_grade(61800, "-6", NULL);
+    check_grade(78000, "-6", "GAL22V10C-6LJ");
+    check_grade(93099, "-6", NULL);
+    check_grade(93100, "-7 or slower", NULL);
+    check_grade(134500, "-7 or slower", "GAL22V10C-25LJ");
+    check_grade(166300, "-7 or slower", "GAL22V10B-15LJ");
+    check_grade(999900, "-7 or slower", NULL);
+
+    if (failures != 0) {
+        printf("%u failures\n", failures);
+        uart_flush();
+        exit(1);
+    }
+    printf("ok\n");
+    uart_flush();
+    return (0);
+}
@@ -20,9 +20,9 @@
 #include "usb.h"
 #include "led.h"
 #include "gpio.h"
+#include "cmdline.h"
 #include "adc.h"
 #include "pld.h"
-#include "cmdline.h"
 #include "readline.h"
 #include "timer.h"
 #include "utils.h"
@@ -0,0 +1,311 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * DMA memory-to-memory copy, fill, and compare.
+ *
+ * The STM32F1 DMA controller can move memory to memory at bus speed,
+ * using the "peripheral" side of a channel as the source. These
+ * routines let the copy, patt, and comp commands move large regions
+ * of SRAM (and read flash) without a CPU access per element. Only one
+ * channel is used, DMA1 channel 2, which is otherwise idle: DMA1
+ * channels 1, 4, and 6 serve the ADC, console UART transmit, and
+ * pld measure, while DMA2 channels 1, 2, and 5 serve pld timing and
+ * pld watch.
+ *
+ * In the host build, transfers are performed by the simulator.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "cmdline.h"
+#include "main.h"
+#include "mem_dma.h"
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/dma.h>
+
+#define MEM_DMA              DMA1
+#define MEM_DMA_CHANNEL      DMA_CHANNEL2
+#define MEM_DMA_MAX_ITEMS    0xffff   // CNDTR is 16 bits
+#define MEM_DMA_SPIN_TIMEOUT 1000000  // Far longer than 64K items
+
+#define MEM_DMA_SRAM_BASE    0x20000000
+#define MEM_DMA_SRAM_SIZE    0x10000  // STM32F107: 64 KB
+
+#ifdef MEM_DMA_FLASH_BASE
+#define MEM_DMA_FLASH_SIZE   0x40000  // STM32F107: 256 KB
+#endif
+
+static uint32_t mem_dma_fill_word;
+static uint32_t mem_dma_stage[2][MEM_DMA_STAGE_SIZE / 4];
+
+/*
+ * mem_dma_capable
+ * ---------------
+ * Returns TRUE if the specified bus address range is plain memory which
+ * may be transferred by DMA. Flash may only be read.
+ */
+bool_t
+mem_dma_capable(uint64_t addr, uint len, bool_t write)
+{
+    if (len == 0)
+        return (FALSE);
+#ifdef HOST_SIM
+    /* All host memory is plain memory */
+    return (TRUE);
+#else
+    if ((addr >= MEM_DMA_SRAM_BASE) &&
+        (addr + len <= MEM_DMA_SRAM_BASE + MEM_DMA_SRAM_SIZE))
+        return (TRUE);
+    if ((write == FALSE) && (addr >= MEM_DMA_FLASH_BASE) &&
+        (addr + len <= MEM_DMA_FLASH_BASE + MEM_DMA_FLASH_SIZE))
+        return (TRUE);
+    return (FALSE);
+#endif
+}
+
+/*
+ * mem_dma_size
+ * ------------
+ * Returns the largest DMA item size (1, 2, or 4 bytes) to which all
+ * of the specified addresses and length are aligned.
+ */
+static uint
+mem_dma_size(uintptr_t addr1, uintptr_t addr2, uint len)
+{
+    uintptr_t bits = addr1 | addr2 | len;
+
+    if ((bits & 3) == 0)
+        return (4);
+    if ((bits & 1) == 0)
+        return (2);
+    return (1);
+}
+
+/*
+ * mem_dma_start
+ * -------------
+ * Start a memory-to-memory transfer of count items of the specified
+ * size. If src_inc is not set, the same source item is written to
+ * every destination item.
+ */
+static void
+mem_dma_start(uintptr_t daddr, uintptr_t saddr, uint count, uint size,
+              bool_t src_inc)
+{
+#ifdef HOST_SIM
+    sim_dma_mem2mem(daddr, saddr, count, size, src_inc);
+#else
+    uint32_t psize;
+    uint32_t msize;
+
+    switch (size) {
+        case 4:
+            psize = DMA_CCR_PSIZE_32BIT;
+            msize = DMA_CCR_MSIZE_32BIT;
+            break;
+        case 2:
+            psize = DMA_CCR_PSIZE_16BIT;
+            msize = DMA_CCR_MSIZE_16BIT;
+            break;
+        default:
+            psize = DMA_CCR_PSIZE_8BIT;
+            msize = DMA_CCR_MSIZE_8BIT;
+            break;
+    }
+
+    rcc_periph_clock_enable(RCC_DMA1);
+    dma_disable_channel(MEM_DMA, MEM_DMA_CHANNEL);
+    dma_channel_reset(MEM_DMA, MEM_DMA_CHANNEL);
+    dma_set_peripheral_address(MEM_DMA, MEM_DMA_CHANNEL, saddr);
+    dma_set_memory_address(MEM_DMA, MEM_DMA_CHANNEL, daddr);
+    dma_set_read_from_peripheral(MEM_DMA, MEM_DMA_CHANNEL);
+    dma_enable_mem2mem_mode(MEM_DMA, MEM_DMA_CHANNEL);
+    if (src_inc)
+        dma_enable_peripheral_increment_mode(MEM_DMA, MEM_DMA_CHANNEL);
+    else
+        dma_disable_peripheral_increment_mode(MEM_DMA, MEM_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(MEM_DMA, MEM_DMA_CHANNEL);
+    dma_set_peripheral_size(MEM_DMA, MEM_DMA_CHANNEL, psize);
+    dma_set_memory_size(MEM_DMA, MEM_DMA_CHANNEL, msize);
+
+    /* Lowest priority, so the console and ADC channels are not starved */
+    dma_set_priority(MEM_DMA, MEM_DMA_CHANNEL, DMA_CCR_PL_LOW);
+    dma_set_number_of_data(MEM_DMA, MEM_DMA_CHANNEL, count);
+    dma_enable_channel(MEM_DMA, MEM_DMA_CHANNEL);
+#endif
+}
+
+/*
+ * mem_dma_wait
+ * ------------
+ * Wait for the transfer started by mem_dma_start() to complete.
+ */
+static rc_t
+mem_dma_wait(void)
+{
+#ifndef HOST_SIM
+    uint timeout;
+
+    for (timeout = MEM_DMA_SPIN_TIMEOUT; timeout > 0; timeout--) {
+        if (dma_get_interrupt_flag(MEM_DMA, MEM_DMA_CHANNEL, DMA_TEIF)) {
+            dma_disable_channel(MEM_DMA, MEM_DMA_CHANNEL);
+            return (RC_FAILURE);
+        }
+        if (dma_get_interrupt_flag(MEM_DMA, MEM_DMA_CHANNEL, DMA_TCIF))
+            break;
+    }
+    dma_disable_channel(MEM_DMA, MEM_DMA_CHANNEL);
+    if (timeout == 0)
+        return (RC_TIMEOUT);
+#endif
+    return (RC_SUCCESS);
+}
+
+/*
+ * mem_dma_run
+ * -----------
+ * Transfer len bytes as items of the specified size, in as many DMA
+ * bursts as the 16-bit item count requires. Bursts are sequential, so
+ * a transfer whose source trails the destination replicates the data
+ * between them.
+ */
+static rc_t
+mem_dma_run(uintptr_t daddr, uintptr_t saddr, uint len, uint size,
+            bool_t src_inc)
+{
+    rc_t rc;
+
+    while (len > 0) {
+        uint count = len / size;
+        if (count > MEM_DMA_MAX_ITEMS)
+            count = MEM_DMA_MAX_ITEMS;
+        mem_dma_start(daddr, saddr, count, size, src_inc);
+        rc = mem_dma_wait();
+        if (rc != RC_SUCCESS)
+            return (rc);
+        daddr += count * size;
+        if (src_inc)
+            saddr += count * size;
+        len -= count * size;
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * mem_dma_copy
+ * ------------
+ * Copy len bytes from saddr to daddr.
+ */
+rc_t
+mem_dma_copy(uintptr_t daddr, uintptr_t saddr, uint len)
+{
+    return (mem_dma_run(daddr, saddr, len, mem_dma_size(daddr, saddr, len),
+                        TRUE));
+}
+
+/*
+ * mem_dma_fill
+ * ------------
+ * Fill len bytes at daddr with a pattern of width bytes. A 1, 2, or 4
+ * byte pattern at an aligned address is replicated to a word which is
+ * stored repeatedly. Otherwise, the first copy of the pattern is
+ * written by the CPU, and the DMA copies each element from the one
+ * before it.
+ */
+rc_t
+mem_dma_fill(uintptr_t daddr, const uint8_t *pattern, uint width, uint len)
+{
+    uint pos;
+
+    if ((width == 0) || (len < width))
+        return (RC_BAD_PARAM);
+
+    if ((width <= 4) && ((4 % width) == 0) && (((daddr | len) & 3) == 0)) {
+        for (pos = 0; pos < 4; pos += width)
+            memcpy((uint8_t *) &mem_dma_fill_word + pos, pattern, width);
+        return (mem_dma_run(daddr, (uintptr_t) &mem_dma_fill_word, len, 4,
+                            FALSE));
+    }
+
+    memcpy((void *) daddr, pattern, width);
+    return (mem_dma_run(daddr + width, daddr, len - width,
+                        mem_dma_size(daddr, width, len), TRUE));
+}
+
+/*
+ * mem_dma_diff
+ * ------------
+ * Returns the offset of the first byte which differs between the two
+ * buffers, or len if they match.
+ */
+static uint
+mem_dma_diff(const uint8_t *buf1, const uint8_t *buf2, uint len)
+{
+    uint pos = 0;
+
+    if (((uintptr_t) buf1 & 3) == 0) {
+        for (; pos + 4 <= len; pos += 4)
+            if (*(const uint32_t *) (buf1 + pos) !=
+                *(const uint32_t *) (buf2 + pos))
+                break;
+    }
+    for (; pos < len; pos++)
+        if (buf1[pos] != buf2[pos])
+            break;
+    return (pos);
+}
+
+/*
+ * mem_dma_comp
+ * ------------
+ * Compare len bytes at addr1 and addr2, providing in *match the offset
+ * of the first byte which differs (len if none differ). The DMA copies
+ * addr2 into one staging buffer while the CPU compares the previous
+ * staging buffer against addr1, so each element costs the CPU only one
+ * memory read.
+ */
+rc_t
+mem_dma_comp(uintptr_t addr1, uintptr_t addr2, uint len, uint *match)
+{
+    uint size = mem_dma_size(addr2, 0, len);
+    uint pos;
+    uint chunk;
+    uint next;
+    uint diff;
+    uint cur = 0;
+    rc_t rc;
+
+    chunk = (len < MEM_DMA_STAGE_SIZE) ? len : MEM_DMA_STAGE_SIZE;
+    if (chunk != 0)
+        mem_dma_start((uintptr_t) mem_dma_stage[cur], addr2, chunk / size,
+                      size, TRUE);
+    for (pos = 0; pos < len; pos += chunk, chunk = next, cur ^= 1) {
+        rc = mem_dma_wait();
+        if (rc != RC_SUCCESS)
+            return (rc);
+
+        next = len - pos - chunk;
+        if (next > MEM_DMA_STAGE_SIZE)
+            next = MEM_DMA_STAGE_SIZE;
+        if (next != 0) {
+            mem_dma_start((uintptr_t) mem_dma_stage[cur ^ 1],
+                          addr2 + pos + chunk, next / size, size, TRUE);
+        }
+
+        diff = mem_dma_diff((const uint8_t *) (addr1 + pos),
+                            (const uint8_t *) mem_dma_stage[cur], chunk);
+        if (diff < chunk) {
+            if (next != 0)
+                (void) mem_dma_wait();
+            *match = pos + diff;
+            return (RC_SUCCESS);
+        }
+    }
+    *match = len;
+    return (RC_SUCCESS);
+}
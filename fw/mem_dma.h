@@ -0,0 +1,32 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * DMA memory-to-memory copy, fill, and compare.
+ */
+
+#ifndef _MEM_DMA_H
+#define _MEM_DMA_H
+
+#define MEM_DMA_STAGE_SIZE 512  // Compare staging buffer size (bytes)
+
+#ifndef HOST_SIM
+#define MEM_DMA_FLASH_BASE 0x08000000  // Flash is readable by DMA
+#endif
+
+bool_t mem_dma_capable(uint64_t addr, uint len, bool_t write);
+rc_t   mem_dma_copy(uintptr_t daddr, uintptr_t saddr, uint len);
+rc_t   mem_dma_fill(uintptr_t daddr, const uint8_t *pattern, uint width,
+                    uint len);
+rc_t   mem_dma_comp(uintptr_t addr1, uintptr_t addr2, uint len, uint *match);
+
+#ifdef HOST_SIM
+void   sim_dma_mem2mem(uintptr_t daddr, uintptr_t saddr, uint count,
+                       uint size, bool_t src_inc);
+#endif
+
+#endif /* _MEM_DMA_H */
@@ -25,6 +25,7 @@
 #include "adc.h"
 #include "utils.h"
 #include "usb.h"
+#include "usb_bench.h"
 #include "irq.h"
 
 #include <libopencm3/cm3/scb.h>
@@ -75,6 +76,8 @@ const char cmd_snoop_help[] =
 #endif
 
 const char cmd_usb_help[] =
+"usb bench recv <bytes>        - verify pattern upload from host\n"
+"usb bench send <bytes> [fast] - stream pattern to host (see sw/usbbench)\n"
 "usb disable - reset and disable USB\n"
 "usb regs    - display USB device registers\n"
 "usb reset   - reset and restart USB device\n"
@@ -508,7 +511,9 @@ cmd_usb(int argc, char * const *argv)
 {
     if (argc < 2)
         return (RC_USER_HELP);
-    if (strncmp(argv[1], "disable", 1) == 0) {
+    if (strcmp(argv[1], "bench") == 0) {
+        return (usb_bench(argc - 1, argv + 1));
+    } else if (strncmp(argv[1], "disable", 1) == 0) {
         timer_delay_msec(1);
         usb_shutdown();
         usb_signal_reset_to_host(0);
@@ -14,6 +14,7 @@
 
 #undef HAVE_SPACE_PROM
 #define HAVE_SPACE_FLASH
+#define HAVE_MEM_DMA
 
 rc_t cmd_cpu(int argc, char * const *argv);
 rc_t cmd_gpio(int argc, char * const *argv);
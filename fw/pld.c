@@ -14,21 +14,29 @@
 #include <string.h>
 #include "printf.h"
 #include "uart.h"
+#include "usb.h"
 #include <stdbool.h>
 #include "timer.h"
 #include "gpio.h"
+#include "cmdline.h"
 #include "adc.h"
 #include "led.h"
 #include "pld.h"
+#include "pld_port.h"
+#include "pld_fmt.h"
+#include "pld_stats.h"
 #include "utils.h"
-#include "cmdline.h"
 #include "cmds.h"
 #include "pcmds.h"
 #include "button.h"
 #include "irq.h"
+#include "clock.h"
+#include "sigstore.h"
 #include <libopencm3/stm32/timer.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/f1/gpio.h>
+#include <libopencm3/stm32/dma.h>
+#include <libopencm3/cm3/dwt.h>
 
 #undef DEBUG_DETECT_PART_PRESENT
 #undef DEBUG_VCC_AND_GND_JUMPERS
@@ -250,7 +258,8 @@ pld_output_disable(void)
 static uint32_t
 pld_output_value(void)
 {
-    return (GPIO_ODR(PLD1_PORT) | ((GPIO_ODR(PLD17_PORT) & 0x0fff) << 16));
+    return (pld_port_out_value(PLD1_PORT) |
+            ((pld_port_out_value(PLD17_PORT) & 0x0fff) << 16));
 }
 
 /*
@@ -273,9 +282,9 @@ pldd_output_enable(void)
 static uint32_t
 pldd_output_value(void)
 {
-    return (GPIO_ODR(PLDD1_PORT) |
-            ((GPIO_ODR(PLDD17_PORT) & 0x00ff) << 16) |
-            ((GPIO_ODR(PLDD25_PORT) & 0xf000) << 12));
+    return (pld_port_out_value(PLDD1_PORT) |
+            ((pld_port_out_value(PLDD17_PORT) & 0x00ff) << 16) |
+            ((pld_port_out_value(PLDD25_PORT) & 0xf000) << 12));
 }
 
 /*
@@ -286,13 +295,15 @@ pldd_output_value(void)
 static void
 pldd_output(uint32_t data)
 {
-    GPIO_ODR(PLDD1_PORT) = data;  // PLDD1-PLDD16
+    pld_port_out(PLDD1_PORT, data);  // PLDD1-PLDD16
 
-    GPIO_BSRR(PLDD17_PORT) = 0x00ff0000 |             // Clear PLDD17-PLDD24
-                             ((data >> 16) & 0x00ff); // Set PLDD17-PLDD24
+    pld_port_set_reset(PLDD17_PORT,
+                       0x00ff0000 |                // Clear PLDD17-PLDD24
+                       ((data >> 16) & 0x00ff));   // Set PLDD17-PLDD24
 
-    GPIO_BSRR(PLDD25_PORT) = 0xf0000000 |             // Clear PLDD25-PLDD28
-                             ((data >> 12) & 0xf000); // Set PLDD25-PLDD28
+    pld_port_set_reset(PLDD25_PORT,
+                       0xf0000000 |                // Clear PLDD25-PLDD28
+                       ((data >> 12) & 0xf000));   // Set PLDD25-PLDD28
 }
 
 /*
@@ -303,9 +314,9 @@ pldd_output(uint32_t data)
 static uint32_t
 pldd_input(void)
 {
-    return (GPIO_IDR(PLDD1_PORT) |                     // PLDD1-PLDD16
-            ((GPIO_IDR(PLDD17_PORT) & 0x00ff) << 16) | // PLDD17-PLDD24
-            ((GPIO_IDR(PLDD25_PORT) & 0xf000) << 12)); // PLDD25-PLDD28
+    return (pld_port_in(PLDD1_PORT) |                     // PLDD1-PLDD16
+            ((pld_port_in(PLDD17_PORT) & 0x00ff) << 16) | // PLDD17-PLDD24
+            ((pld_port_in(PLDD25_PORT) & 0xf000) << 12)); // PLDD25-PLDD28
 }
 
 /*
@@ -316,8 +327,8 @@ pldd_input(void)
 static uint32_t
 pld_input(void)
 {
-    return (GPIO_IDR(PLD1_PORT) |                     // PLD1-PLD16
-            ((GPIO_IDR(PLD17_PORT) & 0x0fff) << 16)); // PLD17-PLD28
+    return (pld_port_in(PLD1_PORT) |                     // PLD1-PLD16
+            ((pld_port_in(PLD17_PORT) & 0x0fff) << 16)); // PLD17-PLD28
 }
 
 /*
@@ -331,10 +342,11 @@ static void
 pld_output(uint32_t data)
 {
     /* Set the PLD output value */
-    GPIO_ODR(PLD1_PORT) = data;  // PLD1-PLD16
+    pld_port_out(PLD1_PORT, data);  // PLD1-PLD16
 
-    GPIO_BSRR(PLD17_PORT) = 0x0fff0000 |              // Clear PLD17-PLD24
-                             ((data >> 16) & 0x0fff); // Set PLD17-PLD28
+    pld_port_set_reset(PLD17_PORT,
+                       0x0fff0000 |                // Clear PLD17-PLD28
+                       ((data >> 16) & 0x0fff));   // Set PLD17-PLD28
 }
 
 /*
@@ -404,6 +416,7 @@ void
 pld_init(void)
 {
     pld_disable();
+    pld_fmt_init();
 }
 
 /*
@@ -451,23 +464,6 @@ print_binary(uint32_t value)
     }
 }
 
-/*
- * print_binary_buf
- * ----------------
- * Saves a 28-bit value in human-readable binary to the specified buffer.
- */
-static int
-print_binary_buf(uint32_t value, char *buf)
-{
-    int bit;
-    for (bit = 27; bit >= 0; bit--) {
-        *(buf++) = '0' + !!(value & BIT(bit));
-        if ((bit == 24) || (bit == 16) || (bit == 8))
-            *(buf++) = ':';
-    }
-    return (31);
-}
-
 /*
  * pld_check_vcc_gnd_shorts
  * ------------------------
@@ -868,26 +864,287 @@ pld_detect_part_present(uint32_t *pins_present)
         *pins_present = present;
 }
 
+/*
+ * pld_check_pin
+ * -------------
+ * Drives a single PLDD_* pin high with all others pulled low, verifying
+ * that only the corresponding PLD_* pin goes high. On failure, attempts
+ * to diagnose the cause.
+ */
+static rc_t
+pld_check_pin(uint pin, uint32_t ignore_pins, uint32_t gnd_pins)
+{
+    uint32_t pldd_indata;
+    uint32_t pldd_outdata = BIT(pin);
+    uint32_t pld_indata;
+    uint32_t log_indata[4];
+    uint64_t time_start;
+    uint     rep;
+
+    time_start = timer_tick_get();
+    pldd_output(pldd_outdata);
+    pldd_gpio_setmode(~BIT(pin), GPIO_SETMODE_INPUT_PULLUPDOWN);
+    pldd_gpio_setmode(BIT(pin), GPIO_SETMODE_OUTPUT_PPULL_10);
+    timer_delay_msec(1);
+#define CHECK_REPS 10000  // ~100 msec
+    for (rep = 0; rep < CHECK_REPS; rep++) {
+        pld_indata = pld_input() & ~ignore_pins;
+        if (pld_indata == pldd_outdata) {
+            if ((rep > 0) && ((gnd_pins & BIT(pin)) == 0)) {
+                /* GND pins take longer to settle because of capacitor */
+                uint cur;
+
+                printf("Pin%-2u took %llu usec to settle\n", pin + 1,
+                       timer_tick_to_usec(timer_tick_get() - time_start));
+                if (rep < 4) {
+                    cur = 0;
+                } else {
+                    cur = rep - 4;
+                }
+                printf("    Most recent states:\n");
+                while (cur < rep) {
+                    printf("    ");
+                    print_binary(log_indata[cur & 3]);
+                    printf("\n");
+                    cur++;
+                }
+                printf("    ");
+                print_binary(pld_indata);
+                printf("\n");
+            }
+            break;
+        }
+        log_indata[rep & 3] = pld_indata;
+        timer_delay_usec(1);
+    }
+    if (rep >= CHECK_REPS) {
+        int  tpin;
+        uint pins_high = pld_indata & ~BIT(pin);
+        pldd_indata = pldd_input() & ~ignore_pins;
+        printf("FAIL when Pin%u driven high\n    ", pin + 1);
+        print_binary(pld_indata);
+        printf("\n    ");
+        for (tpin = 27; tpin > 0; tpin--) {
+            char ch = ' ';
+            if (tpin == (int)pin) {
+                if ((pld_indata & BIT(tpin)) == 0)
+                    ch = '!';
+            } else if ((pldd_indata | pld_indata) & BIT(tpin)) {
+                ch = '!';
+            }
+            putchar(ch);
+            if ((tpin == 24) || (tpin == 16) || (tpin == 8))
+                putchar(' ');
+        }
+        printf("\n");
+        for (tpin = 0; tpin < 28; tpin++) {
+            if (pins_high & BIT(tpin)) {
+                printf("    Pin%u is high when it should be low\n",
+                       tpin + 1);
+            }
+        }
+        if ((pldd_indata & BIT(pin)) == 0) {
+            printf("    Pin%u (PLDD) overdriven - short to GND?\n",
+                   pin + 1);
+        } else if ((pld_indata & BIT(pin)) == 0) {
+            /*
+             * Either open circuit or PLD pin shorted to GND.
+             * Attempt to differentiate a short to GND.
+             */
+            uint32_t temp_in;
+            pld_output(BIT(pin));
+            pld_gpio_setmode(BIT(pin), GPIO_SETMODE_OUTPUT_PPULL_10);
+            timer_delay_msec(1);
+            temp_in = pld_input();
+            pld_output(9);
+            pld_gpio_setmode(BIT(pin), GPIO_SETMODE_INPUT_PULLUPDOWN);
+            printf("    Pin%u (PLD) is low when it should be high - ",
+                   pin + 1);
+            if (temp_in & BIT(pin))
+                printf("bad connection at resistor?\n");
+            else
+                printf("short to GND?\n");
+        }
+        return (RC_FAILURE);
+    }
+    return (RC_SUCCESS);
+}
+
+#define CHECK_FAST_CODE_BITS 5    // ceil(log2(28)) bits to number the pins
+#define CHECK_FAST_PATTERNS  (CHECK_FAST_CODE_BITS + 2)
+#define CHECK_FAST_REPS      100  // ~100 usec per pattern to settle
+#define CHECK_SLOW_REPS      10000  // ~10 msec retry for slow pins
+
+/*
+ * pld_check_fast_pattern
+ * ----------------------
+ * Returns the PLDD_* drive value for the specified pattern number of the
+ * fast check. Pattern 0 drives all pins low, and pattern 1 drives all
+ * pins high. The remaining patterns each drive one bit of the pin's
+ * number (1-28), so every pin sees a sequence across all patterns which
+ * is unique and differs from the sequence of a pin stuck low or high.
+ */
+static uint32_t
+pld_check_fast_pattern(uint pattern)
+{
+    uint32_t value = 0;
+    uint     pin;
+
+    if (pattern == 0)
+        return (0);
+    if (pattern == 1)
+        return (0x0fffffff);
+    for (pin = 0; pin < 28; pin++)
+        if ((pin + 1) & BIT(pattern - 2))
+            value |= BIT(pin);
+    return (value);
+}
+
+/*
+ * pld_check_fast_code
+ * -------------------
+ * Gathers one pin's value from each pattern of the fast check into a
+ * code, where bit N is the pin's value in pattern N.
+ */
+static uint
+pld_check_fast_code(const uint32_t *values, uint pin)
+{
+    uint code = 0;
+    uint pattern;
+
+    for (pattern = 0; pattern < CHECK_FAST_PATTERNS; pattern++)
+        if (values[pattern] & BIT(pin))
+            code |= BIT(pattern);
+    return (code);
+}
+
+/*
+ * pld_check_fast
+ * --------------
+ * Checks all PLDD_* to PLD_* paths at once by driving a small set of
+ * patterns on every pin simultaneously. Pins which do not read back
+ * as expected are diagnosed from the codes read across all patterns:
+ * a pin stuck low or high, or a pin which follows another pin's
+ * sequence (alone, or combined by wired-AND / wired-OR) and so is
+ * likely bridged to it. A pattern which does not settle within the
+ * fast settle time is given the longer settle time of the per-pin check
+ * before its pins are suspected. Returns the mask of suspect pins.
+ */
+static uint32_t
+pld_check_fast(uint32_t ignore_pins)
+{
+    uint32_t drive = 0x0fffffff & ~ignore_pins;
+    uint32_t expect[CHECK_FAST_PATTERNS];
+    uint32_t values[CHECK_FAST_PATTERNS];
+    uint32_t pld_indata = 0;
+    uint32_t suspect = 0;
+    uint32_t slow = 0;
+    uint     pattern;
+    uint     pin;
+    uint     rep;
+
+    pld_disable();
+    pld_output(0x00000000);
+    pld_gpio_setmode(0x0fffffff, GPIO_SETMODE_INPUT_PULLUPDOWN);
+    pldd_output(0x00000000);
+    pldd_gpio_setmode(ignore_pins & 0x0fffffff,
+                      GPIO_SETMODE_INPUT_PULLUPDOWN);
+    pldd_gpio_setmode(drive, GPIO_SETMODE_OUTPUT_PPULL_10);
+
+    for (pattern = 0; pattern < CHECK_FAST_PATTERNS; pattern++) {
+        expect[pattern] = pld_check_fast_pattern(pattern) & drive;
+        pldd_output(expect[pattern]);
+        for (rep = 0; rep < CHECK_FAST_REPS; rep++) {
+            pld_indata = pld_input() & drive;
+            if (pld_indata == expect[pattern])
+                break;
+            timer_delay_usec(1);
+        }
+        if (rep >= CHECK_FAST_REPS) {
+            /* Retry with the settle time of the per-pin check */
+            uint32_t unsettled = pld_indata ^ expect[pattern];
+            timer_delay_msec(1);
+            for (rep = 0; rep < CHECK_SLOW_REPS; rep++) {
+                pld_indata = pld_input() & drive;
+                if (pld_indata == expect[pattern])
+                    break;
+                timer_delay_usec(1);
+            }
+            slow |= unsettled & ~(pld_indata ^ expect[pattern]);
+        }
+        values[pattern] = pld_indata;
+        suspect |= pld_indata ^ expect[pattern];
+    }
+    pld_disable();
+
+    for (pin = 0; pin < 28; pin++) {
+        uint code;
+        uint pin_code;
+        uint other;
+
+        if ((slow & ~suspect) & BIT(pin))
+            printf("    Pin%u was slow to settle\n", pin + 1);
+        if ((suspect & BIT(pin)) == 0)
+            continue;
+        code = pld_check_fast_code(values, pin);
+        if (code & BIT(0)) {
+            printf("    Pin%u is high when all pins driven low - "
+                   "short to VCC?\n", pin + 1);
+            continue;
+        }
+        if ((code & BIT(1)) == 0) {
+            printf("    Pin%u is low when all pins driven high - "
+                   "open or short to GND?\n", pin + 1);
+            continue;
+        }
+        pin_code = pld_check_fast_code(expect, pin);
+        for (other = 0; other < 28; other++) {
+            uint other_code;
+
+            if ((other == pin) || ((drive & BIT(other)) == 0))
+                continue;
+            other_code = pld_check_fast_code(expect, other);
+            if ((code == other_code) ||
+                (code == (pin_code & other_code)) ||
+                (code == (pin_code | other_code))) {
+                printf("    Pin%u follows Pin%u - bridged?\n",
+                       pin + 1, other + 1);
+                break;
+            }
+        }
+        if (other >= 28)
+            printf("    Pin%u read unexpected pattern %02x\n", pin + 1, code);
+    }
+    return (suspect);
+}
+
 /*
  * pld_check
  * ---------
  * Implements the "pld check" command. Several checks are performed,
  * including verifying that GND and VCC jumpers are set, the voltage
  * is set, and that there are no shorts or open paths on the PCB.
+ * PCB paths are first tested together with a few patterns, and then
+ * only suspect pins are tested individually (unless "all" is given).
  * This command does not currently work when a part is installed.
  */
 static rc_t
-pld_check(void)
+pld_check(int argc, char * const *argv)
 {
     uint     pin;
-    uint     rep;
     uint32_t vcc_pins;
     uint32_t gnd_pins;
     uint32_t pld_indata;
     uint32_t ignore_pins;
+    uint32_t check_pins;
     uint64_t time_start;
     rc_t     rc = RC_SUCCESS;
 
+    if ((argc > 1) && (strcmp(argv[1], "all") != 0)) {
+        printf("Unknown argument %s\n", argv[1]);
+        return (RC_USER_HELP);
+    }
+
     pld_detect_part_present(NULL);
     rc = pld_report_5v_3p3v_jumper(1);
     if (rc != RC_SUCCESS)
@@ -928,101 +1185,33 @@ pld_check(void)
         }
     }
 
-    for (pin = 0; pin < 28; pin++) {
-        uint32_t pldd_indata;
-        uint32_t pldd_outdata = BIT(pin);
-        uint32_t log_indata[4];
-
-        if (BIT(pin) & ignore_pins)
-            continue;
-
+    /*
+     * Test all paths at once with the fast patterns, falling back to
+     * testing each suspect pin individually for a detailed diagnosis.
+     */
+    check_pins = 0x0fffffff & ~ignore_pins;
+    if ((argc <= 1) && (rc == RC_SUCCESS)) {
         time_start = timer_tick_get();
-        pldd_output(pldd_outdata);
-        pldd_gpio_setmode(~BIT(pin), GPIO_SETMODE_INPUT_PULLUPDOWN);
-        pldd_gpio_setmode(BIT(pin), GPIO_SETMODE_OUTPUT_PPULL_10);
-        timer_delay_msec(1);
-#define CHECK_REPS 10000  // ~100 msec
-        for (rep = 0; rep < CHECK_REPS; rep++) {
-            pld_indata = pld_input() & ~ignore_pins;
-            if (pld_indata == pldd_outdata) {
-                if ((rep > 0) && ((gnd_pins & BIT(pin)) == 0)) {
-                    /* GND pins take longer to settle because of capacitor */
-                    uint cur;
-
-                    printf("Pin%-2u took %llu usec to settle\n", pin + 1,
-                           timer_tick_to_usec(timer_tick_get() - time_start));
-                    if (rep < 4) {
-                        cur = 0;
-                    } else {
-                        cur = rep - 4;
-                    }
-                    printf("    Most recent states:\n");
-                    while (cur < rep) {
-                        printf("    ");
-                        print_binary(log_indata[cur & 3]);
-                        printf("\n");
-                        cur++;
-                    }
-                    printf("    ");
-                    print_binary(pld_indata);
-                    printf("\n");
-                }
-                break;
-            }
-            log_indata[rep & 3] = pld_indata;
-            timer_delay_usec(1);
-        }
-        if (rep >= CHECK_REPS) {
-            int  tpin;
-            uint pins_high = pld_indata & ~BIT(pin);
-            pldd_indata = pldd_input() & ~ignore_pins;
-            printf("FAIL when Pin%u driven high\n    ", pin + 1);
-            print_binary(pld_indata);
-            printf("\n    ");
-            for (tpin = 27; tpin > 0; tpin--) {
-                char ch = ' ';
-                if (tpin == (int)pin) {
-                    if ((pld_indata & BIT(tpin)) == 0)
-                        ch = '!';
-                } else if ((pldd_indata | pld_indata) & BIT(tpin)) {
-                    ch = '!';
-                }
-                putchar(ch);
-                if ((tpin == 24) || (tpin == 16) || (tpin == 8))
-                    putchar(' ');
-            }
-            printf("\n");
-            for (tpin = 0; tpin < 28; tpin++) {
-                if (pins_high & BIT(tpin)) {
-                    printf("    Pin%u is high when it should be low\n",
-                           tpin + 1);
-                }
-            }
-            if ((pldd_indata & BIT(pin)) == 0) {
-                printf("    Pin%u (PLDD) overdriven - short to GND?\n",
-                       pin + 1);
-            } else if ((pld_indata & BIT(pin)) == 0) {
-                /*
-                 * Either open circuit or PLD pin shorted to GND.
-                 * Attempt to differentiate a short to GND.
-                 */
-                uint32_t temp_in;
-                pld_output(BIT(pin));
-                pld_gpio_setmode(BIT(pin), GPIO_SETMODE_OUTPUT_PPULL_10);
-                timer_delay_msec(1);
-                temp_in = pld_input();
-                pld_output(9);
-                pld_gpio_setmode(BIT(pin), GPIO_SETMODE_INPUT_PULLUPDOWN);
-                printf("    Pin%u (PLD) is low when it should be high - ",
-                       pin + 1);
-                if (temp_in & BIT(pin))
-                    printf("bad connection at resistor?\n");
-                else
-                    printf("short to GND?\n");
-            }
+        check_pins = pld_check_fast(ignore_pins);
+        if (check_pins != 0) {
+            printf("FAIL: %u suspect pins in fast check (%llu usec); "
+                   "checking individually\n", bit_count(check_pins),
+                   timer_tick_to_usec(timer_tick_get() - time_start));
             rc = RC_FAILURE;
         }
     }
+
+    pld_disable();
+    pldd_output(0x00000000);
+    pldd_gpio_setmode(0x0fffffff, GPIO_SETMODE_INPUT_PULLUPDOWN);
+    pld_output(0x00000000);
+    pld_gpio_setmode(0x0fffffff, GPIO_SETMODE_INPUT_PULLUPDOWN);
+    for (pin = 0; pin < 28; pin++) {
+        if (BIT(pin) & check_pins) {
+            if (pld_check_pin(pin, ignore_pins, gnd_pins) != RC_SUCCESS)
+                rc = RC_FAILURE;
+        }
+    }
 fail:
     pld_disable();
     return (rc);
@@ -1035,11 +1224,23 @@ const char cmd_pld_walk_help[] =
 "  analyze        - perform a quick analysis\n"
 "  auto           - automatically probe to select device pins\n"
 "  binary         - show binary instead of hex\n"
+"  classify       - pre-pass to find output pins and not walk them\n"
+"  clock=<pin>    - explore registered logic states clocked by <pin>\n"
 "  deep           - perform a deep analysis (takes a lot longer)\n"
+"  digest         - compute signature and look it up (see pld sig)\n"
 "  dip            - select standard DIP 22V10 pins\n"
+"  extend=<mask>  - only walk vectors which a walk of <mask> ignored\n"
+"  hazard[=<ns>,..] - capture glitches at post-transition delays (nsec)\n"
+"  hold0=<pins>   - hold pins low instead of walking them\n"
+"  hold1=<pins>   - hold pins high instead of walking them\n"
 "  invert         - invert ignored pins (make them 1 instead of 0)\n"
 "  plcc           - select standard PLCC 22V10 pins\n"
+"  power[=<n>]    - record PLD VCC/GND ADC readings (average of n)\n"
+"  profile        - account cycles per walk phase (see pld stats)\n"
 "  raw            - dump raw values (not ASCII)\n"
+"  reset=<pin>    - clock with <pin> high to reset registers (clock=)\n"
+"  sample=<n>     - apply only <n> pseudo-random vectors (hex count)\n"
+"  seed=<value>   - starting state of the sample vector sequence\n"
 "  values         - report values (ASCII hex or binary)\n"
 "  zero           - perform walking zeros instead of walking ones\n";
 
@@ -1055,6 +1256,314 @@ const char cmd_pld_walk_help[] =
 #define WALK_FLAG_RAW_BINARY    0x10  // Show raw binary values
 #define WALK_FLAG_VALUES        0x20  // Show ASCII values
 #define WALK_FLAG_WALK_ZERO     0x48  // Walking zeros
+#define WALK_FLAG_HAZARD        0x80  // Capture hazards at short delays
+#define WALK_FLAG_POWER         0x100 // Record PLD VCC/GND per vector
+#define WALK_FLAG_PROFILE       0x200 // Account cycles to walk loop phases
+#define WALK_FLAG_CLOCKED       0x400 // Explore registered logic states
+#define WALK_FLAG_DIGEST        0x800 // Fold read values into a signature
+#define WALK_FLAG_EXTEND        0x1000 // Extend a previous walk to more pins
+#define WALK_FLAG_SAMPLE        0x2000 // Apply pseudo-random sample vectors
+#define WALK_FLAG_CLASSIFY      0x4000 // Pre-pass to exclude output pins
+
+#define WALK_LFSR_TAPS          0x80200003  // x^32 + x^22 + x^2 + x + 1
+#define WALK_CLASSIFY_VECTORS   64          // Pre-pass vectors
+#define WALK_CLASSIFY_SEED      0x12345678  // Pre-pass LFSR starting state
+
+#define POWER_MAX_SWEEPS        64    // Maximum ADC sweeps to average
+
+#define HAZARD_MAX_SAMPLES      16    // Maximum post-transition samples
+
+#define EXPLORE_MAX_STATES      256   // Register states tracked
+#define EXPLORE_HASH_BITS       9     // Hash table of 512 state indexes
+#define EXPLORE_HASH_EMPTY      0xffff
+#define EXPLORE_POWER_OFF_MSEC  10    // Power-off time to reset registers
+
+/*
+ * Default post-transition sample delays for hazard capture (nsec).
+ * At 72 MHz, one CPU cycle is ~13.9 ns, and a single PLD_* pin read
+ * takes a few cycles, so the shortest delays will be rounded up to
+ * however fast the CPU can actually sample GPIO_IDR.
+ */
+static const uint16_t hazard_default_delays[] = {
+    0, 15, 30, 45, 60, 80, 100, 150, 200, 300, 500, 1000
+};
+static uint16_t hazard_delays[HAZARD_MAX_SAMPLES];
+static uint     hazard_samples;
+static uint     power_sweeps;
+static uint     power_stale;        // Vectors with no fresh ADC sweep
+static uint     explore_clock_pin;  // Register clock pin (1-28)
+static uint     explore_reset_pin;  // Optional synchronous reset pin (1-28)
+static uint32_t walk_hold_mask;     // Pins held at a fixed level
+static uint32_t walk_hold_value;    // Level of held pins
+static uint     walk_extend_mask;   // Ignore mask of walk being extended
+static uint     walk_sample_count;  // Number of sampled vectors to apply
+static uint     walk_sample_seed;   // Starting LFSR state of sampled walk
+
+/*
+ * Register state reached by registered logic exploration. States are
+ * identified by the pins read with all walked inputs low. Each state
+ * records the input vector which was clocked in its parent state to
+ * reach it, so any state can be revisited by replaying the chain of
+ * inputs from the reset state.
+ */
+typedef struct {
+    uint32_t es_state;   // Pins read in this state
+    uint32_t es_input;   // Input vector clocked in parent to reach state
+    uint16_t es_parent;  // Index of parent state
+    uint16_t es_depth;   // Clocks from the reset state
+} explore_state_t;
+
+static explore_state_t explore_states[EXPLORE_MAX_STATES];
+static uint16_t        explore_hash[BIT(EXPLORE_HASH_BITS)];
+static uint            explore_count;
+
+/*
+ * Walk loop profiling. Every walk records its total time and vector
+ * count. With the "profile" option, the DWT cycle counter is also
+ * sampled between each phase of the loop and the delta accumulated
+ * against that phase. "pld stats" reports the result of the last walk.
+ */
+typedef enum {
+    WALK_PROF_DRIVE,      // PLDD_* GPIO writes
+    WALK_PROF_SETTLE,     // Propagation delay before sampling
+    WALK_PROF_READ,       // PLD_* GPIO reads
+    WALK_PROF_POWER,      // ADC sweeps of PLD VCC/GND
+    WALK_PROF_ANALYZE,    // Accumulation of analysis masks
+    WALK_PROF_FORMAT,     // Record formatting (sprintf / binary)
+    WALK_PROF_OUTPUT,     // Block flush to puts_binary(), USB/UART waits
+    WALK_PROF_POLL,       // Abort polling and progress display
+    WALK_PROF_PHASES
+} walk_prof_phase_t;
+
+static const char * const walk_prof_phase_names[] = {
+    "drive", "settle", "read", "power", "analyze", "format", "output", "poll"
+};
+
+typedef struct {
+    const char *name;                     // Loop which was profiled
+    uint64_t    ticks;                    // Elapsed timer ticks
+    uint64_t    cycles[WALK_PROF_PHASES]; // DWT cycles per phase
+    uint32_t    vectors;                  // Vectors applied to the PLD
+    uint32_t    usb_stalls;               // USB sends which had to wait
+    uint32_t    usb_timeouts;             // USB sends which gave up
+    uint8_t     profiled;                 // Phase cycles are valid
+    uint8_t     aborted;                  // Loop did not complete
+} walk_prof_t;
+
+#define WALK_PROF_LOOPS 2                 // Walk pass and analysis pass
+static walk_prof_t walk_prof[WALK_PROF_LOOPS];
+static walk_prof_t *walk_prof_cur;
+static uint32_t     walk_prof_last;
+static uint32_t     walk_prof_usb_stalls;
+static uint32_t     walk_prof_usb_timeouts;
+
+#define WALK_PROF_MARK(profile, phase) \
+    do { \
+        if (profile) \
+            walk_prof_mark(phase); \
+    } while (0)
+
+/*
+ * walk_prof_mark
+ * --------------
+ * Charge the cycles elapsed since the previous mark to the specified
+ * walk loop phase.
+ */
+static inline void
+walk_prof_mark(uint phase)
+{
+    uint32_t now = dwt_read_cycle_counter();
+
+    walk_prof_cur->cycles[phase] += now - walk_prof_last;
+    walk_prof_last = now;
+}
+
+/*
+ * walk_prof_start
+ * ---------------
+ * Begin accounting for a walk loop. Returns non-zero if per-phase cycle
+ * accounting should be done by the loop.
+ */
+static uint
+walk_prof_start(uint loop, const char *name, uint flags)
+{
+    walk_prof_t *prof = &walk_prof[loop];
+
+    if (loop == 0)
+        memset(walk_prof, 0, sizeof (walk_prof));
+    prof->name = name;
+    prof->profiled = (flags & WALK_FLAG_PROFILE) &&
+                     dwt_enable_cycle_counter();
+    walk_prof_cur = prof;
+    walk_prof_usb_stalls = usb_send_stalls;
+    walk_prof_usb_timeouts = usb_send_timeouts;
+    prof->ticks = timer_tick_get();
+    walk_prof_last = dwt_read_cycle_counter();
+    return (prof->profiled);
+}
+
+/*
+ * walk_prof_stop
+ * --------------
+ * Complete accounting for the current walk loop.
+ */
+static void
+walk_prof_stop(uint vectors, uint aborted)
+{
+    walk_prof_t *prof = walk_prof_cur;
+
+    prof->ticks = timer_tick_get() - prof->ticks;
+    prof->vectors = vectors;
+    prof->aborted = aborted;
+    prof->usb_stalls = usb_send_stalls - walk_prof_usb_stalls;
+    prof->usb_timeouts = usb_send_timeouts - walk_prof_usb_timeouts;
+}
+
+/*
+ * pld_walk_stats
+ * --------------
+ * Report where time was spent in the most recent walk: cycles per
+ * vector for each loop phase (when walked with "profile"), achieved
+ * vectors per second, and USB stalls and timeouts during the walk.
+ */
+static rc_t
+pld_walk_stats(void)
+{
+    uint loop;
+    uint phase;
+    uint hclk_mhz = clock_get_hclk() / 1000000;
+
+    if (walk_prof[0].name == NULL) {
+        printf("No walk has been run\n");
+        return (RC_FAILURE);
+    }
+    for (loop = 0; loop < WALK_PROF_LOOPS; loop++) {
+        walk_prof_t *prof = &walk_prof[loop];
+        uint64_t     usec = timer_tick_to_usec(prof->ticks);
+        uint64_t     vec_per_sec = 0;
+        uint64_t     cycles_sum = 0;
+
+        if (prof->name == NULL)
+            continue;
+        if (usec != 0)
+            vec_per_sec = (uint64_t) prof->vectors * 1000000 / usec;
+        printf("%s: %u vectors in %llu us = %llu vectors/sec%s\n",
+               prof->name, prof->vectors, usec, vec_per_sec,
+               prof->aborted ? " (aborted)" : "");
+        printf("  usb stalls=%u timeouts=%u\n",
+               prof->usb_stalls, prof->usb_timeouts);
+        if ((prof->profiled == 0) || (prof->vectors == 0))
+            continue;
+
+        printf("  %-8s %10s %8s\n", "phase", "cycles", "cyc/vec");
+        for (phase = 0; phase < WALK_PROF_PHASES; phase++) {
+            uint64_t x10 = prof->cycles[phase] * 10 / prof->vectors;
+            cycles_sum += prof->cycles[phase];
+            if (prof->cycles[phase] == 0)
+                continue;
+            printf("  %-8s %10llu %6llu.%llu\n", walk_prof_phase_names[phase],
+                   prof->cycles[phase], x10 / 10, x10 % 10);
+        }
+        printf("  %-8s %10llu %6llu.%llu  (%u MHz)\n", "total", cycles_sum,
+               cycles_sum / prof->vectors,
+               cycles_sum * 10 / prof->vectors % 10, hclk_mhz);
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * pld_walk_vector_profiled
+ * ------------------------
+ * Equivalent to pldd_output_pld_input(), but with the drive, settle,
+ * and read phases separately accounted.
+ */
+static uint32_t
+pld_walk_vector_profiled(uint32_t wvalue)
+{
+    uint32_t value;
+
+    pldd_output(wvalue);
+    walk_prof_mark(WALK_PROF_DRIVE);
+    timer_delay_usec(1);
+    walk_prof_mark(WALK_PROF_SETTLE);
+    value = pld_input();
+    walk_prof_mark(WALK_PROF_READ);
+    return (value);
+}
+
+/*
+ * pld_walk_print_hold
+ * -------------------
+ * Annotate a capture header with the pins held at a fixed level, so
+ * that the host analyzer can report them as literals of every term.
+ */
+static void
+pld_walk_print_hold(void)
+{
+    if (walk_hold_mask != 0)
+        printf("HOLD=%07lx:%07lx ", walk_hold_mask, walk_hold_value);
+}
+
+/*
+ * cmd_pld_parse_pins
+ * ------------------
+ * Convert a list of pin numbers and ranges, such as "1-9,11", to a mask
+ * of pins where bit 0 is PLD pin 1.
+ */
+static rc_t
+cmd_pld_parse_pins(const char *ptr, uint32_t *pins)
+{
+    const char *nptr;
+    uint32_t    mask = 0;
+
+    while (*ptr != '\0') {
+        int pos;
+        int start;
+        int end;
+        if ((sscanf(ptr, "%d%n", &start, &pos) != 1) || (pos == 0) ||
+            (start < 1) || (start > 28)) {
+            printf("Invalid argument '%s'\n", ptr);
+            printf("%s", cmd_pld_walk_help);
+            return (RC_FAILURE);
+        }
+        nptr = ptr + pos;
+        if ((*nptr == ',') || (*nptr == '\0')) {
+            /* Single position */
+            mask |= BIT(start - 1);
+            ptr = nptr;
+            if (*ptr == '\0')
+                break;
+        } else if (*nptr == '-') {
+            nptr++;
+            if ((sscanf(nptr, "%d%n", &end, &pos) != 1) || (pos == 0) ||
+                (end < 1) || (end > 28)) {
+                printf("Invalid argument '%s' at '%s'\n", ptr, nptr);
+                return (RC_USER_HELP);
+            }
+            nptr += pos;
+
+            /* Allow bits to be specified in either order */
+            if (end < start) {
+                int temp = end;
+                end = start;
+                start = temp;
+            }
+            start--;
+            mask |= ((BIT(end) - 1) ^ (BIT(start) - 1));
+
+            if (*nptr == '\0')
+                break;
+            if (*nptr != ',') {
+                printf("Invalid argument '%s' at '%s'\n", ptr, nptr);
+                return (RC_USER_HELP);
+            }
+            ptr = nptr;
+        }
+        ptr++;
+    }
+    *pins = mask;
+    return (RC_SUCCESS);
+}
 
 /*
  * cmd_pld_get_ignore_mask
@@ -1073,10 +1582,15 @@ cmd_pld_get_ignore_mask(int argc, char * const *argv,
     rc_t     rc = RC_SUCCESS;
     uint     ignore_initialized = 0;
 
+    explore_reset_pin = 0;
+    walk_hold_mask = 0;
+    walk_hold_value = 0;
+    walk_sample_seed = 0;
+
     /* Capture bits to walk from command arguments */
     for (arg = 1; arg < argc; arg++) {
         const char *ptr = argv[arg];
-        const char *nptr;
+        uint32_t    pins;
         int         mode;
         uint        type;
         uint        plen;
@@ -1127,32 +1641,164 @@ cmd_pld_get_ignore_mask(int argc, char * const *argv,
                     goto invalid_argument;
                 *flags |= WALK_FLAG_SHOW_BINARY;
                 continue;
+            case 'c': {
+                const char *eq = strchr(ptr, '=');
+                if ((eq == NULL) && (plen > 1) &&
+                    (strncmp("classify", ptr, plen) == 0)) {
+                    *flags |= WALK_FLAG_CLASSIFY;
+                    continue;
+                }
+                if ((eq == NULL) || (strncmp("clock", ptr, eq - ptr) != 0))
+                    goto invalid_argument;
+                if ((parse_uint(eq + 1, &explore_clock_pin) != RC_SUCCESS) ||
+                    (explore_clock_pin < 1) || (explore_clock_pin > 28)) {
+                    printf("Invalid clock pin '%s'; range 1-28\n", eq + 1);
+                    return (RC_FAILURE);
+                }
+                *flags |= WALK_FLAG_CLOCKED;
+                continue;
+            }
             case 'd':
                 if (strncmp("deep", ptr, plen) == 0) {
                     *flags |= WALK_FLAG_ANALYZE_DEEP | WALK_FLAG_ANALYZE;
                 } else if (strcmp("dip", ptr) == 0) {
                     ignore_mask = DIP_22V20_IGNORE_PINS;
                     ignore_initialized = 1;
+                } else if ((plen > 2) && (strncmp("digest", ptr, plen) == 0)) {
+                    *flags |= WALK_FLAG_DIGEST;
                 } else {
                     goto invalid_argument;
                 }
                 continue;
-            case 'i':
-                if (strncmp("invert", ptr, plen))
+            case 'h': {
+                const char *eq = strchr(ptr, '=');
+                if ((strncmp(ptr, "hold0=", 6) == 0) ||
+                    (strncmp(ptr, "hold1=", 6) == 0)) {
+                    rc = cmd_pld_parse_pins(ptr + 6, &pins);
+                    if (rc != RC_SUCCESS)
+                        return (rc);
+                    walk_hold_mask |= pins;
+                    if (ptr[4] == '1')
+                        walk_hold_value |= pins;
+                    else
+                        walk_hold_value &= ~pins;
+                    continue;
+                }
+                if (eq != NULL)
+                    plen = eq - ptr;
+                if (strncmp("hazard", ptr, plen))
                     goto invalid_argument;
-                *flags |= WALK_FLAG_INVERT_IGNORE;
-                continue;
-            case 'p':
-                if (strncmp("plcc", ptr, plen))
+                *flags |= WALK_FLAG_HAZARD;
+                if (eq == NULL) {
+                    hazard_samples = ARRAY_SIZE(hazard_default_delays);
+                    memcpy(hazard_delays, hazard_default_delays,
+                           sizeof (hazard_default_delays));
+                    continue;
+                }
+                hazard_samples = 0;
+                ptr = eq;
+                do {
+                    int delay;
+                    int pos;
+                    ptr++;
+                    if ((sscanf(ptr, "%d%n", &delay, &pos) != 1) ||
+                        (delay < 0) || (delay > 65535) ||
+                        (hazard_samples >= HAZARD_MAX_SAMPLES) ||
+                        ((hazard_samples > 0) &&
+                         (delay < hazard_delays[hazard_samples - 1]))) {
+                        printf("Invalid hazard delay at '%s'; specify up to "
+                               "%u ascending nsec values\n",
+                               ptr, HAZARD_MAX_SAMPLES);
+                        return (RC_FAILURE);
+                    }
+                    hazard_delays[hazard_samples++] = delay;
+                    ptr += pos;
+                } while (*ptr == ',');
+                if (*ptr != '\0')
                     goto invalid_argument;
-                ignore_mask = PLCC_22V20_IGNORE_PINS;
-                ignore_initialized = 1;
                 continue;
-            case 'r':
-                if (strncmp("raw", ptr, plen))
+            }
+            case 'e': {
+                const char *eq = strchr(ptr, '=');
+                if ((eq == NULL) || (strncmp("extend", ptr, eq - ptr) != 0))
+                    goto invalid_argument;
+                if (parse_uint(eq + 1, &walk_extend_mask) != RC_SUCCESS)
+                    return (RC_FAILURE);
+                *flags |= WALK_FLAG_EXTEND;
+                continue;
+            }
+            case 'i':
+                if (strncmp("invert", ptr, plen))
+                    goto invalid_argument;
+                *flags |= WALK_FLAG_INVERT_IGNORE;
+                continue;
+            case 'p': {
+                const char *eq = strchr(ptr, '=');
+                if (eq != NULL)
+                    plen = eq - ptr;
+                if ((plen > 1) && (strncmp("power", ptr, plen) == 0)) {
+                    *flags |= WALK_FLAG_POWER;
+                    power_sweeps = 1;
+                    if ((eq != NULL) &&
+                        ((parse_uint(eq + 1, &power_sweeps) != RC_SUCCESS) ||
+                         (power_sweeps == 0) ||
+                         (power_sweeps > POWER_MAX_SWEEPS))) {
+                        printf("Invalid power sweeps '%s'; range 1-%u\n",
+                               eq + 1, POWER_MAX_SWEEPS);
+                        return (RC_FAILURE);
+                    }
+                    continue;
+                }
+                if ((eq == NULL) && (plen > 1) &&
+                    (strncmp("profile", ptr, plen) == 0)) {
+                    *flags |= WALK_FLAG_PROFILE;
+                    continue;
+                }
+                if ((eq != NULL) || strncmp("plcc", ptr, plen))
+                    goto invalid_argument;
+                ignore_mask = PLCC_22V20_IGNORE_PINS;
+                ignore_initialized = 1;
+                continue;
+            }
+            case 'r': {
+                const char *eq = strchr(ptr, '=');
+                if (eq != NULL) {
+                    if (strncmp("reset", ptr, eq - ptr) != 0)
+                        goto invalid_argument;
+                    if ((parse_uint(eq + 1, &explore_reset_pin) !=
+                         RC_SUCCESS) ||
+                        (explore_reset_pin < 1) || (explore_reset_pin > 28)) {
+                        printf("Invalid reset pin '%s'; range 1-28\n",
+                               eq + 1);
+                        return (RC_FAILURE);
+                    }
+                    continue;
+                }
+                if (strncmp("raw", ptr, plen))
                     goto invalid_argument;
                 *flags |= WALK_FLAG_RAW_BINARY | WALK_FLAG_VALUES;
                 continue;
+            }
+            case 's': {
+                const char *eq = strchr(ptr, '=');
+                if ((eq != NULL) && (strncmp("sample", ptr, eq - ptr) == 0)) {
+                    if ((parse_uint(eq + 1, &walk_sample_count) !=
+                         RC_SUCCESS) || (walk_sample_count == 0)) {
+                        printf("Invalid sample count '%s'\n", eq + 1);
+                        return (RC_FAILURE);
+                    }
+                    *flags |= WALK_FLAG_SAMPLE;
+                    continue;
+                }
+                if ((eq == NULL) || (strncmp("seed", ptr, eq - ptr) != 0))
+                    goto invalid_argument;
+                if ((parse_uint(eq + 1, &walk_sample_seed) != RC_SUCCESS) ||
+                    (walk_sample_seed == 0)) {
+                    printf("Invalid seed '%s'; must be non-zero\n", eq + 1);
+                    return (RC_FAILURE);
+                }
+                continue;
+            }
             case 'v':
                 if (strncmp("values", ptr, plen))
                     goto invalid_argument;
@@ -1184,60 +1830,13 @@ invalid_argument:
                 mode = 1;  // Remove
                 break;
         }
-        while (*ptr != '\0') {
-            int pos;
-            int start;
-            int end;
-            if ((sscanf(ptr, "%d%n", &start, &pos) != 1) || (pos == 0) ||
-                (start < 1) || (start > 28)) {
-                printf("Invalid argument '%s'\n", ptr);
-                printf("%s", cmd_pld_walk_help);
-                return (RC_FAILURE);
-            }
-            nptr = ptr + pos;
-            if ((*nptr == ',') || (*nptr == '\0')) {
-                /* Single position */
-                start--;
-                ptr = nptr;
-                if (mode == 0)
-                    ignore_mask |= BIT(start);
-                else
-                    ignore_mask &= ~BIT(start);
-                if (*ptr == '\0')
-                    break;
-            } else if (*nptr == '-') {
-                uint32_t newmask;
-                nptr++;
-                if ((sscanf(nptr, "%d%n", &end, &pos) != 1) || (pos == 0) ||
-                    (end < 1) || (end > 28)) {
-                    printf("Invalid argument '%s' at '%s'\n", ptr, nptr);
-                    return (RC_USER_HELP);
-                }
-                nptr += pos;
-
-                /* Allow bits to be specified in either order */
-                if (end < start) {
-                    int temp = end;
-                    end = start;
-                    start = temp;
-                }
-                start--;
-                newmask = ((BIT(end) - 1) ^ (BIT(start) - 1));
-                if (mode == 0)
-                    ignore_mask |= newmask;
-                else
-                    ignore_mask &= ~newmask;
-
-                if (*nptr == '\0')
-                    break;
-                if (*nptr != ',') {
-                    printf("Invalid argument '%s' at '%s'\n", ptr, nptr);
-                    return (RC_USER_HELP);
-                }
-                ptr = nptr;
-            }
-            ptr++;
-        }
+        rc = cmd_pld_parse_pins(ptr, &pins);
+        if (rc != RC_SUCCESS)
+            return (rc);
+        if (mode == 0)
+            ignore_mask |= pins;
+        else
+            ignore_mask &= ~pins;
     }
 
     if (ignore_initialized == 0) {
@@ -1248,7 +1847,8 @@ invalid_argument:
     if (ignore_mask == 0)
         ignore_mask = ~0x0000013;  // Debug with just 3 bits
 
-    *ignore = ignore_mask;
+    /* Held pins are driven at a fixed level, so are not walked */
+    *ignore = ignore_mask | walk_hold_mask;
 
     return (rc);
 }
@@ -1269,6 +1869,8 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
     uint     walk_invert  = flags & WALK_FLAG_INVERT_IGNORE;
     uint     walk_zero    = flags & WALK_FLAG_WALK_ZERO;
     uint     not_deep     = !(flags & WALK_FLAG_ANALYZE_DEEP);
+    uint     vectors      = 0;
+    uint     profile;
     uint32_t cur_mask     = 0;
     uint32_t last_write_mask;
     uint32_t last_read_mask;
@@ -1279,6 +1881,7 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
 
     cur_mask = 0;
     expected_count = 1 << (32 - bit_count(ignore_mask));
+    profile = walk_prof_start(1, "analyze", flags);
     do {
         if (not_deep && (cur_mask != 0)) {
             cur_mask = 0x0fffffff & ~ignore_mask;
@@ -1290,6 +1893,8 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
             main_write_mask = cur_mask;
         if (walk_invert)
             main_write_mask |= ignore_mask;
+        main_write_mask = (main_write_mask & ~walk_hold_mask) |
+                          walk_hold_value;
 
         for (bit = 0; bit < 28; bit++) {
             if (ignore_mask & BIT(bit))
@@ -1298,18 +1903,26 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
             last_write_mask = main_write_mask;
             write_mask      = main_write_mask ^ BIT(bit);
 
-            last_read_mask = pldd_output_pld_input(last_write_mask);
-            read_mask      = pldd_output_pld_input(write_mask);
+            if (profile) {
+                last_read_mask = pld_walk_vector_profiled(last_write_mask);
+                read_mask      = pld_walk_vector_profiled(write_mask);
+            } else {
+                last_read_mask = pldd_output_pld_input(last_write_mask);
+                read_mask      = pldd_output_pld_input(write_mask);
+            }
+            vectors += 2;
 
             /* Calculate pins that were affected by this pin */
             rdiff_mask = (read_mask ^ last_read_mask) & ~BIT(bit);
             pins_affected_by[bit] |= rdiff_mask;
 
             last_read_mask = read_mask;
+            WALK_PROF_MARK(profile, WALK_PROF_ANALYZE);
         }
 
         if ((count++ & 0x1f) == 0) {
             if (is_abort_button_pressed() || input_break_pending()) {
+                walk_prof_stop(vectors, 1);
                 printf("^C Abort\n");
                 return (RC_USR_ABORT);
             }
@@ -1319,9 +1932,11 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
                 printed = 1;
             }
         }
+        WALK_PROF_MARK(profile, WALK_PROF_POLL);
 
         cur_mask = ((cur_mask | ignore_mask) + 1) & ~ignore_mask;
     } while (cur_mask != 0);
+    walk_prof_stop(vectors, 0);
 
     if (printed)
         printf("\r100%%\n");
@@ -1330,213 +1945,1033 @@ cmd_pld_walk_analyze(uint32_t *pins_affected_by, uint flags,
 }
 
 /*
- * cmd_pld_walk
- * ------------
- * Run through all binary combinations of inputs to the PLD, analyzing
- * or reporting the resulting output. This function is path through
- * which a user will request analysis of the inserted part.
+ * pld_hazard_sample
+ * -----------------
+ * Drive a single-bit input transition to the PLD and capture the PLD_*
+ * pins at each of the programmed post-transition delays. Delays are
+ * timed by the DWT cycle counter with interrupts disabled, so the
+ * samples are not disturbed by USB or timer activity.
  */
-static rc_t
-cmd_pld_walk(int argc, char * const *argv)
+static void
+pld_hazard_sample(uint32_t write_mask, const uint32_t *delay_cycles,
+                  uint32_t *samples)
 {
-    uint32_t ignore_mask = 0;
-    uint32_t cur_mask = 0;
-    uint32_t write_mask;
-    uint32_t read_mask;
-    uint32_t pins_touched          = 0;
-    uint32_t pins_output           = 0;
-    uint32_t pins_always_low       = 0xffffffff;
-    uint32_t pins_always_high      = 0xffffffff;
-    uint32_t pins_always_input     = 0xffffffff;
-    uint32_t pins_only_output_high = 0xffffffff;
-    uint32_t pins_only_output_low  = 0xffffffff;
-    uint32_t pins_affected_by[32];
-    uint     count = 0;
-    uint     expected_count;
-    uint     flags = 0;
-    uint     printed = 0;
-    int      bit;
-    rc_t     rc = RC_SUCCESS;
-    char     outbuf[90];
+    uint32_t start;
+    uint     cur;
 
-    if (argc < 1) {
-        printf("%s", cmd_pld_walk_help);
-        return (RC_FAILURE);
+    disable_irq();
+    start = dwt_read_cycle_counter();
+    pldd_output(write_mask);
+    for (cur = 0; cur < hazard_samples; cur++) {
+        while (dwt_read_cycle_counter() - start < delay_cycles[cur])
+            continue;
+        samples[cur] = pld_input();
     }
+    enable_irq();
+}
 
-    memset(pins_affected_by, 0, sizeof (pins_affected_by));
-
-    rc = cmd_pld_get_ignore_mask(argc, argv, &ignore_mask, &flags);
-    if (rc != RC_SUCCESS)
-        return (rc);
-
-    if ((flags & (WALK_FLAG_ANALYZE | WALK_FLAG_VALUES)) == 0) {
-        printf("walk requires one of: analyze, deep, values, raw\n");
+/*
+ * cmd_pld_walk_hazard
+ * -------------------
+ * This function implements the "hazard" option of the "walk" command.
+ * For every walked vector, each non-ignored input is flipped in turn
+ * and the PLD outputs are sampled at a series of short delays after
+ * the transition. Any output pin which changes state more than once
+ * between the settled "before" and "after" readings is a hazard
+ * (static or dynamic glitch). This includes output pins which are not
+ * walked, such as those left out by classify. Only transitions with a
+ * hazard are reported, one line per transition:
+ *     <write_before> <write_after> <hazard_mask> <read_before>
+ *     <sample_0> ... <sample_N-1> <read_after>
+ */
+static rc_t
+cmd_pld_walk_hazard(uint flags, uint32_t ignore_mask)
+{
+    int      bit;
+    uint     cur;
+    uint     len;
+    uint     count        = 0;
+    uint     hazards      = 0;
+    uint     vectors      = 0;
+    uint     printed      = 0;
+    uint     expected_count;
+    uint     walk_invert  = flags & WALK_FLAG_INVERT_IGNORE;
+    uint     walk_zero    = flags & WALK_FLAG_WALK_ZERO;
+    uint32_t cur_mask     = 0;
+    uint32_t hazard_pins  = 0;
+    uint32_t main_write_mask;
+    uint32_t write_mask;
+    uint32_t read_before;
+    uint32_t read_after;
+    uint32_t prev;
+    uint32_t diff;
+    uint32_t changed;
+    uint32_t changed_again;
+    uint32_t delay_cycles[HAZARD_MAX_SAMPLES];
+    uint32_t samples[HAZARD_MAX_SAMPLES];
+    uint32_t cycles_per_usec = clock_get_hclk() / 1000000;
+    char     outbuf[16 + 8 * (HAZARD_MAX_SAMPLES + 5)];
+
+    if (!dwt_enable_cycle_counter()) {
+        printf("DWT cycle counter is not available\n");
         return (RC_FAILURE);
     }
+    for (cur = 0; cur < hazard_samples; cur++)
+        delay_cycles[cur] = hazard_delays[cur] * cycles_per_usec / 1000;
 
-    if (flags & (WALK_FLAG_SHOW_BINARY | WALK_FLAG_ANALYZE)) {
-        print_binary(ignore_mask);
-        printf(" ignoring\n");
-    }
-
-    /*
-     * GAL22V10-25 empirical power-on time is ~500usec
-     */
-    pld_enable();
-    timer_delay_msec(2);
-
-    uint walk_zero = flags & WALK_FLAG_WALK_ZERO;
-    uint walk_invert = flags & WALK_FLAG_INVERT_IGNORE;
-    uint walk_analyze = flags & WALK_FLAG_ANALYZE;
-    uint show_binary = flags & WALK_FLAG_SHOW_BINARY;
-    uint raw_binary = (flags & WALK_FLAG_RAW_BINARY);
-    uint values = (flags & WALK_FLAG_VALUES);
+    printf("---- HAZARDS DELAYS=");
+    for (cur = 0; cur < hazard_samples; cur++)
+        printf("%s%u", (cur == 0) ? "" : ",", hazard_delays[cur]);
+    printf(" ");
+    pld_walk_print_hold();
+    printf("----\n");
 
     expected_count = 1 << (32 - bit_count(ignore_mask));
-    if (raw_binary) {
-        printf("---- BYTES=0x%x ----\n", expected_count * 8);
-    } else if (values) {
-        printf("---- LINES=0x%x ----\n", expected_count);
-    }
-
-    cur_mask = 0;
+    walk_prof_start(0, "hazard", 0);
     do {
         if (walk_zero)
-            write_mask = ~cur_mask;
+            main_write_mask = ~cur_mask;
         else
-            write_mask = cur_mask;
+            main_write_mask = cur_mask;
         if (walk_invert)
-            write_mask |= ignore_mask;
-
-        read_mask = pldd_output_pld_input(write_mask);
-
-        if (walk_analyze) {
-            pins_touched      |= write_mask;
-            pins_always_low   &= ~read_mask;
-            pins_always_high  &= read_mask;
-            pins_always_input &= ~(read_mask ^ write_mask);
-            pins_output       |= (read_mask ^ write_mask);
-            pins_only_output_high &= (read_mask | ~write_mask);
-            pins_only_output_low &= (~read_mask | write_mask);
-        }
+            main_write_mask |= ignore_mask;
+        main_write_mask = (main_write_mask & ~walk_hold_mask) |
+                          walk_hold_value;
 
-        if (raw_binary) {
-            ((uint32_t *)outbuf)[0] = write_mask;
-            ((uint32_t *)outbuf)[1] = read_mask;
-            puts_binary(outbuf, 8);
-        } else if (values) {
-            int len = 0;
-            if (show_binary) {
-                len = print_binary_buf(write_mask, outbuf);
-                outbuf[len++] = ' ';
-                len += print_binary_buf(read_mask, outbuf + len);
-                outbuf[len++] = '\n';
-                puts_binary(outbuf, len);
-            } else {
-                len = sprintf(outbuf, "%07lx %07lx\n", write_mask, read_mask);
-                puts_binary(outbuf, len);
+        for (bit = 0; bit < 28; bit++) {
+            if (ignore_mask & BIT(bit))
+                continue;
+
+            write_mask  = main_write_mask ^ BIT(bit);
+            read_before = pldd_output_pld_input(main_write_mask);
+            pld_hazard_sample(write_mask, delay_cycles, samples);
+            timer_delay_usec(1);
+            read_after = pld_input();
+            vectors += 2;
+
+            /* Find pins which changed state more than once */
+            prev          = read_before;
+            changed       = 0;
+            changed_again = 0;
+            for (cur = 0; cur <= hazard_samples; cur++) {
+                uint32_t value = (cur < hazard_samples) ? samples[cur] :
+                                                          read_after;
+                diff           = value ^ prev;
+                changed_again |= changed & diff;
+                changed       |= diff;
+                prev           = value;
             }
+            /* Pins left out of the walk may still glitch; keep them */
+            changed_again &= 0x0fffffff & ~BIT(bit);
+            if (changed_again == 0)
+                continue;
+
+            hazards++;
+            hazard_pins |= changed_again;
+            len = sprintf(outbuf, "%07lx %07lx %07lx %07lx",
+                          main_write_mask & 0x0fffffff,
+                          write_mask & 0x0fffffff,
+                          changed_again, read_before);
+            for (cur = 0; cur < hazard_samples; cur++)
+                len += sprintf(outbuf + len, " %07lx", samples[cur]);
+            len += sprintf(outbuf + len, " %07lx\n", read_after);
+            puts_binary(outbuf, len);
         }
+
         if ((count++ & 0x1f) == 0) {
             if (is_abort_button_pressed() || input_break_pending()) {
+                walk_prof_stop(vectors, 1);
                 printf("^C Abort\n");
-                rc = RC_USR_ABORT;
-                goto walk_abort;
+                return (RC_USR_ABORT);
             }
-            if ((raw_binary || !values) && ((count & 0x7fff) == 1)) {
+            if ((count & 0x7fff) == 1) {
                 char buf[16];
                 char *ptr;
                 sprintf(buf, "\r%u%%", count * 100 / expected_count);
-                if (raw_binary) {
-                    for (ptr = buf; *ptr != '\0'; ptr++)
-                        uart_putchar(*ptr);
-                } else {
-                    printf("%s", buf);
-                }
+                for (ptr = buf; *ptr != '\0'; ptr++)
+                    uart_putchar(*ptr);
                 printed = 1;
             }
         }
         cur_mask = ((cur_mask | ignore_mask) + 1) & ~ignore_mask;
     } while (cur_mask != 0);
 
-    if (printed) {
-        if (raw_binary)
-            uart_putchar('\r');
-        else
-            putchar('\r');
+    walk_prof_stop(vectors, 0);
+
+    if (printed)
+        uart_putchar('\r');
+
+    printf("---- END ----\n");
+    printf("%u hazards  ", hazards);
+    print_binary(hazard_pins);
+    printf(" glitching pins\n");
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * pld_power_sample
+ * ----------------
+ * Return the raw PLD VCC (low 16 bits) and PLD GND (high 16 bits) ADC
+ * readings for the currently applied vector, averaged over the
+ * requested number of conversion sweeps. Sweeps which timed out are
+ * left out of the average; if all of them did, the stale reading is
+ * returned and counted in power_stale.
+ */
+static uint32_t
+pld_power_sample(void)
+{
+    uint     sweep;
+    uint     fresh   = 0;
+    uint     vcc_sum = 0;
+    uint     gnd_sum = 0;
+    uint16_t vcc;
+    uint16_t gnd;
+
+    for (sweep = 0; sweep < power_sweeps; sweep++) {
+        if (adc_get_pld_raw_sync(&vcc, &gnd) != RC_SUCCESS)
+            continue;
+        vcc_sum += vcc;
+        gnd_sum += gnd;
+        fresh++;
     }
+    if (fresh == 0) {
+        power_stale++;
+        return (vcc | (gnd << 16));
+    }
+    return ((vcc_sum / fresh) | ((gnd_sum / fresh) << 16));
+}
 
-    if (values)
-        printf("---- END ----\n");
+/*
+ * explore_lookup
+ * --------------
+ * Returns the index of the specified register state, adding it to the
+ * visited states if it has not been seen before. Returns -1 if the state
+ * is new but the table is full.
+ */
+static int
+explore_lookup(uint32_t state, uint *is_new)
+{
+    uint slot = (state * 0x9e3779b1) >> (32 - EXPLORE_HASH_BITS);
+    uint index;
 
-    if (walk_analyze) {
-        int pin;
-        printed = 0;
+    while ((index = explore_hash[slot]) != EXPLORE_HASH_EMPTY) {
+        if (explore_states[index].es_state == state) {
+            *is_new = 0;
+            return (index);
+        }
+        slot = (slot + 1) & (BIT(EXPLORE_HASH_BITS) - 1);
+    }
+    if (explore_count >= EXPLORE_MAX_STATES)
+        return (-1);
+
+    index = explore_count++;
+    explore_hash[slot] = index;
+    explore_states[index].es_state = state;
+    *is_new = 1;
+    return (index);
+}
 
-        pins_touched &= ~ignore_mask;
-        pins_only_output_low  &= ~(pins_always_low | pins_always_input);
-        pins_only_output_high &= ~(pins_always_high | pins_always_input);
-        print_binary(pins_always_input & pins_touched);
-        printf(" input\n");
-        print_binary(pins_output & pins_touched);
-        printf(" output\n");
-        print_binary(pins_always_low & pins_touched);
-        printf(" output always low\n");
-        print_binary(pins_always_high);
-        printf(" output always high\n");
-        print_binary(pins_only_output_low & pins_touched);
-        printf(" open drain: only drives low\n");
-        print_binary(pins_only_output_high & pins_touched);
-        printf(" open drain: only drives high\n");
+/*
+ * explore_clock
+ * -------------
+ * Applies an input vector and pulses the register clock, returning the
+ * pins read after the clock with the inputs still applied.
+ */
+static uint32_t
+explore_clock(uint32_t inputs, uint32_t clock)
+{
+    pldd_output(inputs);
+    timer_delay_usec(1);  // Register setup time
+    pldd_output(inputs | clock);
+    timer_delay_usec(1);
+    pldd_output(inputs);
+    timer_delay_usec(1);
+    return (pld_input() & 0x0fffffff);
+}
 
-        /* Run an analysis pass */
-        rc = cmd_pld_walk_analyze(pins_affected_by, flags, ignore_mask);
-        if (rc != RC_SUCCESS)
-            goto walk_abort;
+/*
+ * explore_read_state
+ * ------------------
+ * Returns the current register state: all pins read with the base
+ * input vector applied.
+ */
+static uint32_t
+explore_read_state(uint32_t base)
+{
+    return (pldd_output_pld_input(base) & 0x0fffffff);
+}
 
-        for (bit = 0; bit < 28; bit++) {
-            uint32_t mask = BIT(bit);
-            uint32_t pins_affecting = 0;
+/*
+ * explore_reset
+ * -------------
+ * Returns the device to its reset state, either by clocking with the
+ * reset pin high or by cycling power (which clears the registers of a
+ * 22V10).
+ */
+static void
+explore_reset(uint32_t base, uint32_t clock, uint32_t reset)
+{
+    if (reset != 0) {
+        (void) explore_clock(base | reset, clock);
+    } else {
+        pld_disable();
+        timer_delay_msec(EXPLORE_POWER_OFF_MSEC);
+        pld_enable();
+        timer_delay_msec(2);
+    }
+}
 
-            for (pin = 0; pin < 28; pin++) {
-                if (pins_affected_by[pin] & mask)
-                    pins_affecting |= BIT(pin);
+/*
+ * explore_goto
+ * ------------
+ * Moves the device to the specified visited state by resetting and then
+ * replaying the recorded input sequence which first reached that state.
+ * Returns the number of clocks replayed.
+ */
+static uint
+explore_goto(uint index, uint32_t base, uint32_t clock, uint32_t reset)
+{
+    uint depth;
+    uint anc;
+
+    explore_reset(base, clock, reset);
+    for (depth = 1; depth <= explore_states[index].es_depth; depth++) {
+        for (anc = index; explore_states[anc].es_depth > depth;
+             anc = explore_states[anc].es_parent)
+            ;
+        (void) explore_clock(explore_states[anc].es_input, clock);
+    }
+    return (explore_states[index].es_depth);
+}
+
+/*
+ * cmd_pld_walk_clocked
+ * --------------------
+ * Explores the reachable states of registered logic. Starting from the
+ * reset state, a breadth-first search applies every combination of the
+ * walked pins in every visited state and pulses the clock pin. Each
+ * (state, inputs) pair is measured exactly once, and the transitions
+ * are reported one line per transition:
+ *     <state> <inputs> <next_state> <outputs>
+ * where outputs are the pins read after the clock with inputs applied.
+ * With raw, the same four values are sent as 32-bit binary words.
+ */
+static rc_t
+cmd_pld_walk_clocked(uint flags, uint32_t ignore_mask)
+{
+    uint32_t clock = BIT(explore_clock_pin - 1);
+    uint32_t reset = explore_reset_pin ? BIT(explore_reset_pin - 1) : 0;
+    uint32_t base;
+    uint32_t cur_mask;
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t next;
+    uint     raw_binary = flags & WALK_FLAG_RAW_BINARY;
+    uint     values = flags & WALK_FLAG_VALUES;
+    uint     transitions = 0;
+    uint     replays = 0;
+    uint     replay_clocks = 0;
+    uint     mismatches = 0;
+    uint     count = 0;
+    uint     is_new;
+    uint     src;
+    int      cur;
+    rc_t     rc = RC_SUCCESS;
+
+    ignore_mask |= clock | reset | 0xf0000000;
+    base = (flags & WALK_FLAG_INVERT_IGNORE) ? (ignore_mask & ~clock &
+                                                 ~reset) : 0;
+    base = (base & ~walk_hold_mask) | (walk_hold_value & ~clock & ~reset);
+    base &= 0x0fffffff;
+
+    explore_count = 0;
+    memset(explore_hash, 0xff, sizeof (explore_hash));
+
+    if (values)
+        printf("---- TRANSITIONS CLOCK=%u RESET=%u ----\n",
+               explore_clock_pin, explore_reset_pin);
+
+    explore_reset(base, clock, reset);
+    cur = explore_lookup(explore_read_state(base), &is_new);
+    explore_states[0].es_parent = 0;
+    explore_states[0].es_depth = 0;
+    explore_states[0].es_input = base;
+    walk_prof_start(0, "clocked", 0);
+
+    for (src = 0; src < explore_count; src++) {
+        cur_mask = 0;
+        do {
+            inputs = cur_mask | base;
+            if ((uint) cur != src) {
+                replay_clocks += explore_goto(src, base, clock, reset);
+                replays++;
+                if (explore_read_state(base) != explore_states[src].es_state)
+                    mismatches++;
             }
-            if ((pins_affected_by[bit] != 0) || (pins_affecting != 0)) {
-                if (printed == 0) {
-                    printed = 1;
-                    printf("\n        %-40sPins affected\n", "Pins affecting");
-                }
-                if (pins_affecting != 0) {
-                    print_binary(pins_affecting);
-                    printf(" ->");
-                } else {
-                    printf("%34s", "");
-                }
-                printf(" Pin%-2u", bit + 1);
-                if (pins_affected_by[bit] != 0) {
-                    printf(" -> ");
-                    print_binary(pins_affected_by[bit]);
+            outputs = explore_clock(inputs, clock);
+            next = explore_read_state(base);
+            transitions++;
+
+            cur = explore_lookup(next, &is_new);
+            if (cur < 0) {
+                pld_fmt_flush();
+                printf("State table full at %u states\n", explore_count);
+                rc = RC_FAILURE;
+                goto explore_done;
+            }
+            if (is_new) {
+                explore_states[cur].es_parent = src;
+                explore_states[cur].es_depth = explore_states[src].es_depth + 1;
+                explore_states[cur].es_input = inputs;
+            }
+
+            if (raw_binary) {
+                uint32_t rec[4];
+                rec[0] = explore_states[src].es_state;
+                rec[1] = inputs;
+                rec[2] = next;
+                rec[3] = outputs;
+                memcpy(pld_fmt_reserve(sizeof (rec)), rec, sizeof (rec));
+                pld_fmt_commit(sizeof (rec));
+            } else if (values) {
+                char *ptr = pld_fmt_reserve(PLD_FMT_LINE_MAX);
+                uint  len;
+                len = pld_fmt_hex(ptr, explore_states[src].es_state, 7);
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, inputs, 7);
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, next, 7);
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, outputs, 7);
+                ptr[len++] = '\n';
+                pld_fmt_commit(len);
+            }
+
+            if ((count++ & 0x1f) == 0) {
+                if (is_abort_button_pressed() || input_break_pending()) {
+                    walk_prof_stop(count, 1);
+                    pld_fmt_flush();
+                    printf("^C Abort\n");
+                    return (RC_USR_ABORT);
                 }
-                printf("\n");
             }
-        }
+            cur_mask = ((cur_mask | ignore_mask) + 1) & ~ignore_mask;
+        } while (cur_mask != 0);
+    }
+
+explore_done:
+    pld_fmt_flush();
+    walk_prof_stop(count, rc != RC_SUCCESS);
+    if (values)
+        printf("---- END ----\n");
+    if (power_stale != 0)
+        printf("ADC timeout: %u vectors have stale power readings\n",
+               power_stale);
+    printf("%u states, %u transitions, %u replays of %u clocks\n",
+           explore_count, transitions, replays, replay_clocks);
+    if (mismatches != 0) {
+        printf("WARNING: %u replays did not reach the recorded state; "
+               "device state may depend on more than the register "
+               "outputs\n", mismatches);
     }
-walk_abort:
-    pld_disable();
     return (rc);
 }
 
-
+/* Walk output formats */
+#define WALK_OUT_NONE   0     // No per-vector output (analyze only)
+#define WALK_OUT_RAW    1     // Binary records
+#define WALK_OUT_HEX    2     // ASCII hex lines
+#define WALK_OUT_BINARY 3     // ASCII binary lines
+
+/* State shared between cmd_pld_walk() and the walk loop variants */
+typedef struct {
+    uint32_t ws_ignore_mask;    // Pins which are not walked
+    uint32_t ws_ext_mask;       // Extension: pins of which one must be set
+    uint32_t ws_lfsr;           // Sampled walk: LFSR state
+    uint32_t ws_xor;            // Applied to counter (walking zeros)
+    uint32_t ws_or;             // Applied after xor (inverted ignore pins)
+    uint32_t ws_touched;        // Analysis: pins driven high
+    uint32_t ws_output;         // Analysis: pins not following drive
+    uint32_t ws_always_low;     // Analysis: pins never read high
+    uint32_t ws_always_high;    // Analysis: pins never read low
+    uint32_t ws_always_input;   // Analysis: pins always following drive
+    uint32_t ws_only_high;      // Analysis: pins only overriding high
+    uint32_t ws_only_low;       // Analysis: pins only overriding low
+    uint     ws_expected;       // Number of vectors in the walk
+    uint     ws_count;          // Number of vectors applied
+    uint     ws_out;            // WALK_OUT_* format
+    uint     ws_analyze;        // Accumulate analysis masks
+    uint     ws_power;          // Record PLD VCC/GND per vector
+    uint     ws_profile;        // Account cycles per phase
+    uint     ws_digest_on;      // Fold read values into ws_digest
+    uint     ws_sample;         // Apply ws_expected LFSR vectors
+    uint32_t ws_digest;         // Signature of the values read
+    uint     ws_printed;        // Progress was displayed
+} walk_state_t;
 
 /*
- * PLD Pins        GPIO Pins
- * -------------   ---------
- * PLD1-PLD16    = PE0-PE15
- * PLD17-PLD28   = PC0-PC11
- * PLDD1-PLDD16  = PD0-PD15
- * PLDD17-PLDD24 = PA0-PA7
+ * pld_walk_poll
+ * -------------
+ * Periodic work of the walk loop: check for user abort and display
+ * progress. This is kept out of line so that it does not burden the
+ * specialized loop bodies.
+ */
+static rc_t __attribute__((noinline))
+pld_walk_poll(walk_state_t *ws, uint count)
+{
+    if (is_abort_button_pressed() || input_break_pending()) {
+        walk_prof_stop(count, 1);
+        pld_fmt_flush();
+        printf("^C Abort\n");
+        return (RC_USR_ABORT);
+    }
+    if (((ws->ws_out == WALK_OUT_RAW) || (ws->ws_out == WALK_OUT_NONE)) &&
+        ((count & 0x7fff) == 1)) {
+        char buf[16];
+        char *ptr;
+        pld_fmt_flush();
+        sprintf(buf, "\r%u%%", count * 100 / ws->ws_expected);
+        if (ws->ws_out == WALK_OUT_RAW) {
+            for (ptr = buf; *ptr != '\0'; ptr++)
+                uart_putchar(*ptr);
+        } else {
+            printf("%s", buf);
+        }
+        ws->ws_printed = 1;
+    }
+    return (RC_SUCCESS);
+}
+
+/*
+ * pld_walk_lfsr_next
+ * ------------------
+ * Advance the sampled walk Galois LFSR by 32 steps, so that every bit
+ * of the next vector is freshly generated. The brutus utility repeats
+ * this sequence to regenerate the vectors of a sampled capture.
+ */
+static inline uint32_t
+pld_walk_lfsr_next(uint32_t state)
+{
+    uint bit;
+
+    for (bit = 0; bit < 32; bit++)
+        state = (state >> 1) ^ (-(state & 1) & WALK_LFSR_TAPS);
+    return (state);
+}
+
+/*
+ * pld_walk_loop
+ * -------------
+ * Body of the walk, applying every combination of the non-ignored pins.
+ * An extension walk applies only the combinations where at least one of
+ * the ext_mask pins is set, as those with none set were previously walked.
+ * A sampled walk applies ws_expected vectors from the LFSR sequence.
+ * This is always inlined with constant arguments by the variants below,
+ * so the compiler generates a separate loop for each output format and
+ * analysis combination with no per-vector tests of the walk flags.
+ */
+static inline __attribute__((always_inline)) rc_t
+pld_walk_loop(walk_state_t *ws, const uint out, const uint analyze,
+              const uint digest, const uint power_on, const uint profile,
+              const uint sample)
+{
+    const uint32_t ignore_mask = ws->ws_ignore_mask;
+    const uint32_t ext_mask    = ws->ws_ext_mask;
+    const uint32_t walk_xor    = ws->ws_xor;
+    const uint32_t walk_or     = ws->ws_or;
+    const uint     rec_size    = power_on ? 12 : 8;
+    uint32_t ext          = ext_mask & -ext_mask;
+    uint32_t vec_xor      = walk_xor ^ ext;
+    uint32_t lfsr         = ws->ws_lfsr;
+    uint32_t cur_mask     = 0;
+    uint32_t write_mask;
+    uint32_t read_mask;
+    uint32_t power        = 0;
+    uint32_t touched      = ws->ws_touched;
+    uint32_t output       = ws->ws_output;
+    uint32_t always_low   = ws->ws_always_low;
+    uint32_t always_high  = ws->ws_always_high;
+    uint32_t always_input = ws->ws_always_input;
+    uint32_t only_high    = ws->ws_only_high;
+    uint32_t only_low     = ws->ws_only_low;
+    uint32_t hash         = ws->ws_digest;
+    uint     count        = 0;
+    rc_t     rc           = RC_SUCCESS;
+
+    if (sample) {
+        lfsr = pld_walk_lfsr_next(lfsr);
+        cur_mask = lfsr & ~ignore_mask;
+    }
+    do {
+        write_mask = (cur_mask ^ vec_xor) | walk_or;
+
+        if (profile)
+            read_mask = pld_walk_vector_profiled(write_mask);
+        else
+            read_mask = pldd_output_pld_input(write_mask);
+        if (power_on) {
+            power = pld_power_sample();
+            WALK_PROF_MARK(profile, WALK_PROF_POWER);
+        }
+
+        if (analyze) {
+            touched      |= write_mask;
+            always_low   &= ~read_mask;
+            always_high  &= read_mask;
+            always_input &= ~(read_mask ^ write_mask);
+            output       |= (read_mask ^ write_mask);
+            only_high    &= (read_mask | ~write_mask);
+            only_low     &= (~read_mask | write_mask);
+            WALK_PROF_MARK(profile, WALK_PROF_ANALYZE);
+        }
+        if (digest)
+            hash = (hash ^ read_mask) * SIGSTORE_HASH_MULT;
+
+        if (out == WALK_OUT_RAW) {
+            uint32_t rec[3];
+            char    *ptr = pld_fmt_reserve(rec_size);
+            WALK_PROF_MARK(profile, WALK_PROF_OUTPUT);
+            rec[0] = write_mask;
+            rec[1] = read_mask;
+            rec[2] = power;
+            memcpy(ptr, rec, rec_size);
+            pld_fmt_commit(rec_size);
+            WALK_PROF_MARK(profile, WALK_PROF_FORMAT);
+        } else if (out != WALK_OUT_NONE) {
+            char *ptr = pld_fmt_reserve(PLD_FMT_LINE_MAX);
+            uint  len;
+            WALK_PROF_MARK(profile, WALK_PROF_OUTPUT);
+            if (out == WALK_OUT_BINARY) {
+                len = pld_fmt_binary(ptr, write_mask);
+                ptr[len++] = ' ';
+                len += pld_fmt_binary(ptr + len, read_mask);
+            } else {
+                len = pld_fmt_hex(ptr, write_mask, 7);
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, read_mask, 7);
+            }
+            if (power_on) {
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, power & 0xffff, 3);
+                ptr[len++] = ' ';
+                len += pld_fmt_hex(ptr + len, power >> 16, 3);
+            }
+            ptr[len++] = '\n';
+            pld_fmt_commit(len);
+            WALK_PROF_MARK(profile, WALK_PROF_FORMAT);
+        }
+        if ((count++ & 0x1f) == 0) {
+            rc = pld_walk_poll(ws, count);
+            if (rc != RC_SUCCESS)
+                break;
+        }
+        WALK_PROF_MARK(profile, WALK_PROF_POLL);
+        if (sample) {
+            lfsr = pld_walk_lfsr_next(lfsr);
+            cur_mask = lfsr & ~ignore_mask;
+            continue;
+        }
+        cur_mask = ((cur_mask | ignore_mask) + 1) & ~ignore_mask;
+        if (cur_mask == 0) {
+            /* Extension walk: advance to the next half-space */
+            ext = ((ext | ~ext_mask) + 1) & ext_mask;
+            vec_xor = walk_xor ^ ext;
+        }
+    } while (sample ? (count < ws->ws_expected) :
+                      ((cur_mask != 0) || (ext != 0)));
+
+    ws->ws_touched      = touched;
+    ws->ws_output       = output;
+    ws->ws_always_low   = always_low;
+    ws->ws_always_high  = always_high;
+    ws->ws_always_input = always_input;
+    ws->ws_only_high    = only_high;
+    ws->ws_only_low     = only_low;
+    ws->ws_digest       = hash;
+    ws->ws_count        = count;
+    return (rc);
+}
+
+typedef rc_t (*walk_variant_t)(walk_state_t *ws);
+
+#define WALK_VARIANT(name, out, analyze, digest) \
+    static rc_t \
+    name(walk_state_t *ws) \
+    { \
+        return (pld_walk_loop(ws, out, analyze, digest, 0, 0, 0)); \
+    }
+
+WALK_VARIANT(pld_walk_analyze_only,  WALK_OUT_NONE,   1, 0)
+WALK_VARIANT(pld_walk_raw,           WALK_OUT_RAW,    0, 0)
+WALK_VARIANT(pld_walk_raw_analyze,   WALK_OUT_RAW,    1, 0)
+WALK_VARIANT(pld_walk_hex,           WALK_OUT_HEX,    0, 0)
+WALK_VARIANT(pld_walk_hex_analyze,   WALK_OUT_HEX,    1, 0)
+WALK_VARIANT(pld_walk_bin,           WALK_OUT_BINARY, 0, 0)
+WALK_VARIANT(pld_walk_bin_analyze,   WALK_OUT_BINARY, 1, 0)
+WALK_VARIANT(pld_walk_digest,        WALK_OUT_NONE,   0, 1)
+
+/*
+ * pld_walk_generic
+ * ----------------
+ * Walk loop for the less common power, profile, and sample options, and
+ * digest combined with other output, testing all flags at run time.
+ */
+static rc_t
+pld_walk_generic(walk_state_t *ws)
+{
+    return (pld_walk_loop(ws, ws->ws_out, ws->ws_analyze, ws->ws_digest_on,
+                          ws->ws_power, ws->ws_profile, ws->ws_sample));
+}
+
+/* Specialized walk loops, indexed by [WALK_OUT_*][analyze] */
+static const walk_variant_t pld_walk_variants[4][2] = {
+    { NULL,          pld_walk_analyze_only },
+    { pld_walk_raw,  pld_walk_raw_analyze },
+    { pld_walk_hex,  pld_walk_hex_analyze },
+    { pld_walk_bin,  pld_walk_bin_analyze },
+};
+
+/*
+ * pld_walk_select
+ * ---------------
+ * Choose the walk loop variant for the walk state.
+ */
+static walk_variant_t
+pld_walk_select(const walk_state_t *ws)
+{
+    walk_variant_t func = pld_walk_variants[ws->ws_out][!!ws->ws_analyze];
+
+    if (ws->ws_digest_on) {
+        func = ((ws->ws_out == WALK_OUT_NONE) && !ws->ws_analyze) ?
+               pld_walk_digest : NULL;
+    }
+    if (ws->ws_power || ws->ws_profile || ws->ws_sample || (func == NULL))
+        func = pld_walk_generic;
+    return (func);
+}
+
+/*
+ * pld_walk_classify
+ * -----------------
+ * Pre-pass which finds the walked pins that the PLD drives. A short
+ * sampled walk of pseudo-random vectors is run through the walk loop
+ * analysis, and pins which did not always follow their drive (the
+ * analysis "output" pins) are returned, as walking them would only
+ * double the walk time. This includes a tri-state output which was
+ * enabled for any of the vectors. The pins which always followed their
+ * drive are provided in *inputs.
+ */
+static rc_t
+pld_walk_classify(uint32_t ignore_mask, uint flags, uint32_t *inputs,
+                  uint32_t *outputs)
+{
+    uint32_t     walked = ~ignore_mask & 0x0fffffff;
+    walk_state_t ws;
+    rc_t         rc;
+
+    memset(&ws, 0, sizeof (ws));
+    ws.ws_ignore_mask  = ignore_mask;
+    ws.ws_lfsr         = WALK_CLASSIFY_SEED;
+    ws.ws_sample       = 1;
+    ws.ws_expected     = WALK_CLASSIFY_VECTORS;
+    ws.ws_analyze      = 1;
+    ws.ws_out          = WALK_OUT_NONE;
+    ws.ws_or           = (flags & WALK_FLAG_INVERT_IGNORE) ? ignore_mask : 0;
+    ws.ws_or           = (ws.ws_or & ~walk_hold_mask) | walk_hold_value;
+    ws.ws_always_low   = 0xffffffff;
+    ws.ws_always_high  = 0xffffffff;
+    ws.ws_always_input = 0xffffffff;
+    ws.ws_only_high    = 0xffffffff;
+    ws.ws_only_low     = 0xffffffff;
+
+    rc = pld_walk_generic(&ws);
+    if (ws.ws_printed)
+        putchar('\r');
+    *inputs  = ws.ws_always_input & walked;
+    *outputs = ws.ws_output & walked;
+    return (rc);
+}
+
+/*
+ * cmd_pld_walk
+ * ------------
+ * Run through all binary combinations of inputs to the PLD, analyzing
+ * or reporting the resulting output. This function is path through
+ * which a user will request analysis of the inserted part.
+ */
+static rc_t
+cmd_pld_walk(int argc, char * const *argv)
+{
+    uint32_t     ignore_mask = 0;
+    uint32_t     ext_mask = 0;
+    uint32_t     walk_inputs = 0;
+    uint32_t     walk_outputs = 0;
+    uint32_t     pins_affected_by[32];
+    uint         expected_count;
+    uint         flags = 0;
+    uint         printed;
+    int          bit;
+    rc_t         rc = RC_SUCCESS;
+    walk_state_t ws;
+
+    if (argc < 1) {
+        printf("%s", cmd_pld_walk_help);
+        return (RC_FAILURE);
+    }
+
+    memset(pins_affected_by, 0, sizeof (pins_affected_by));
+
+    rc = cmd_pld_get_ignore_mask(argc, argv, &ignore_mask, &flags);
+    if (rc != RC_SUCCESS)
+        return (rc);
+
+    if ((flags & (WALK_FLAG_ANALYZE | WALK_FLAG_VALUES | WALK_FLAG_HAZARD |
+                  WALK_FLAG_CLOCKED | WALK_FLAG_DIGEST)) == 0) {
+        printf("walk requires one of: analyze, deep, hazard, values, raw, "
+               "clock, digest\n");
+        return (RC_FAILURE);
+    }
+    if ((flags & WALK_FLAG_DIGEST) &&
+        (flags & (WALK_FLAG_HAZARD | WALK_FLAG_CLOCKED))) {
+        printf("digest may not be combined with hazard or clock\n");
+        return (RC_FAILURE);
+    }
+    if ((flags & WALK_FLAG_CLOCKED) &&
+        (flags & (WALK_FLAG_ANALYZE | WALK_FLAG_HAZARD | WALK_FLAG_POWER))) {
+        printf("clock may not be combined with analyze, hazard, or power\n");
+        return (RC_FAILURE);
+    }
+    if ((flags & WALK_FLAG_EXTEND) && (flags & WALK_FLAG_CLASSIFY)) {
+        printf("extend may not be combined with classify\n");
+        return (RC_FAILURE);
+    }
+    if (flags & WALK_FLAG_EXTEND) {
+        /* Invert would have held the new pins high in the previous walk */
+        if (((flags & WALK_FLAG_VALUES) == 0) ||
+            (flags & (WALK_FLAG_ANALYZE | WALK_FLAG_HAZARD |
+                      WALK_FLAG_CLOCKED | WALK_FLAG_DIGEST)) ||
+            ((flags & WALK_FLAG_WALK_ZERO) == WALK_FLAG_INVERT_IGNORE)) {
+            printf("extend requires values or raw, and may not be combined "
+                   "with analyze, hazard, clock, digest, or invert\n");
+            return (RC_FAILURE);
+        }
+        ext_mask = walk_extend_mask & ~ignore_mask & 0x0fffffff;
+        if ((~walk_extend_mask & ignore_mask & 0x0fffffff) != 0) {
+            printf("extend mask %08x walked pins which are now ignored\n",
+                   walk_extend_mask);
+            return (RC_FAILURE);
+        }
+        if (ext_mask == 0) {
+            printf("extend mask %08x adds no pins to the walk\n",
+                   walk_extend_mask);
+            return (RC_FAILURE);
+        }
+    }
+    if (flags & WALK_FLAG_SAMPLE) {
+        if (((flags & WALK_FLAG_VALUES) == 0) ||
+            (flags & (WALK_FLAG_ANALYZE | WALK_FLAG_HAZARD |
+                      WALK_FLAG_CLOCKED | WALK_FLAG_DIGEST |
+                      WALK_FLAG_EXTEND))) {
+            printf("sample requires values or raw, and may not be combined "
+                   "with analyze, hazard, clock, digest, or extend\n");
+            return (RC_FAILURE);
+        }
+        if (walk_sample_seed == 0)
+            walk_sample_seed = (uint32_t) timer_tick_get() | 1;
+    }
+
+    if (flags & (WALK_FLAG_SHOW_BINARY | WALK_FLAG_ANALYZE)) {
+        print_binary(ignore_mask);
+        printf(" ignoring\n");
+        if (walk_hold_mask != 0) {
+            print_binary(walk_hold_value);
+            printf(" held of %07lx\n", walk_hold_mask);
+        }
+    }
+
+    /*
+     * GAL22V10-25 empirical power-on time is ~500usec
+     */
+    pld_enable();
+    timer_delay_msec(2);
+
+    if (flags & WALK_FLAG_CLASSIFY) {
+        rc = pld_walk_classify(ignore_mask, flags, &walk_inputs,
+                               &walk_outputs);
+        if (rc != RC_SUCCESS)
+            goto walk_abort;
+        ignore_mask |= walk_outputs;
+        print_binary(walk_outputs);
+        printf(" output, not walked\n");
+    }
+
+    /* Checked after classify, which may shrink the walk */
+    if (flags & WALK_FLAG_SAMPLE) {
+        uint walked = 32 - bit_count(ignore_mask);
+        if ((walked < 32) && (walk_sample_count >= (1U << walked))) {
+            printf("sample count %x is not less than the full walk of %x "
+                   "vectors\n", walk_sample_count, 1U << walked);
+            rc = RC_FAILURE;
+            goto walk_abort;
+        }
+    }
+
+    uint walk_analyze = flags & WALK_FLAG_ANALYZE;
+    uint raw_binary = (flags & WALK_FLAG_RAW_BINARY);
+    uint values = (flags & WALK_FLAG_VALUES);
+    uint walk_power = (flags & WALK_FLAG_POWER);
+    uint rec_size = walk_power ? 12 : 8;
+
+    if (flags & WALK_FLAG_HAZARD) {
+        rc = cmd_pld_walk_hazard(flags, ignore_mask);
+        goto walk_abort;
+    }
+    if (flags & WALK_FLAG_CLOCKED) {
+        rc = cmd_pld_walk_clocked(flags, ignore_mask);
+        goto walk_abort;
+    }
+
+    /* An extension walks each new half-space of the previous walk */
+    expected_count = (1 << (32 - bit_count(ignore_mask | ext_mask))) *
+                     ((1 << bit_count(ext_mask)) - 1 + (ext_mask == 0));
+    if (flags & WALK_FLAG_SAMPLE)
+        expected_count = walk_sample_count;
+    if (raw_binary || values) {
+        printf("---- %s=0x%x %s", raw_binary ? "BYTES" : "LINES",
+               raw_binary ? expected_count * rec_size : expected_count,
+               walk_power ? "POWER " : "");
+        if (ext_mask != 0)
+            printf("EXTEND=%08x ", walk_extend_mask);
+        if (flags & WALK_FLAG_SAMPLE)
+            printf("SAMPLE=%08x:%08x ", walk_sample_seed, (uint) ignore_mask);
+        if (flags & WALK_FLAG_CLASSIFY)
+            printf("CLASSIFY=%07lx:%07lx ", walk_inputs, walk_outputs);
+        pld_walk_print_hold();
+        printf("----\n");
+    }
+
+    memset(&ws, 0, sizeof (ws));
+    ws.ws_ignore_mask  = ignore_mask | ext_mask;
+    ws.ws_ext_mask     = ext_mask;
+    ws.ws_lfsr         = walk_sample_seed;
+    ws.ws_sample       = flags & WALK_FLAG_SAMPLE;
+    ws.ws_xor          = (flags & WALK_FLAG_WALK_ZERO) ? 0xffffffff : 0;
+    ws.ws_or           = (flags & WALK_FLAG_INVERT_IGNORE) ? ignore_mask : 0;
+    ws.ws_xor         &= ~walk_hold_mask;
+    ws.ws_or           = (ws.ws_or & ~walk_hold_mask) | walk_hold_value;
+    ws.ws_always_low   = 0xffffffff;
+    ws.ws_always_high  = 0xffffffff;
+    ws.ws_always_input = 0xffffffff;
+    ws.ws_only_high    = 0xffffffff;
+    ws.ws_only_low     = 0xffffffff;
+    ws.ws_expected     = expected_count;
+    ws.ws_analyze      = walk_analyze;
+    ws.ws_power        = walk_power;
+    ws.ws_digest_on    = flags & WALK_FLAG_DIGEST;
+    ws.ws_digest       = SIGSTORE_HASH_INIT ^ (flags & WALK_FLAG_WALK_ZERO);
+    if (raw_binary)
+        ws.ws_out = WALK_OUT_RAW;
+    else if (!values)
+        ws.ws_out = WALK_OUT_NONE;
+    else if (flags & WALK_FLAG_SHOW_BINARY)
+        ws.ws_out = WALK_OUT_BINARY;
+    else
+        ws.ws_out = WALK_OUT_HEX;
+
+    power_stale = 0;
+    ws.ws_profile = walk_prof_start(0, raw_binary ? "raw" : values ? "values" :
+                                       "walk", flags);
+    rc = pld_walk_select(&ws)(&ws);
+    if (rc != RC_SUCCESS)
+        goto walk_abort;
+    pld_fmt_flush();
+    walk_prof_stop(ws.ws_count, 0);
+
+    if (ws.ws_printed) {
+        if (raw_binary)
+            uart_putchar('\r');
+        else
+            putchar('\r');
+    }
+
+    if (values)
+        printf("---- END ----\n");
+
+    if (ws.ws_digest_on) {
+        printf("Digest %08x over %u vectors\n", ws.ws_digest, ws.ws_count);
+        sigstore_note_walk(ws.ws_digest, ignore_mask,
+                           (device_inserted >= 0) ?
+                           installed_types[device_inserted].name : "unknown");
+    }
+
+    if (walk_analyze) {
+        int pin;
+        printed = 0;
+
+        ws.ws_touched &= ~ignore_mask;
+        ws.ws_only_low  &= ~(ws.ws_always_low | ws.ws_always_input);
+        ws.ws_only_high &= ~(ws.ws_always_high | ws.ws_always_input);
+        print_binary(ws.ws_always_input & ws.ws_touched);
+        printf(" input\n");
+        print_binary(ws.ws_output & ws.ws_touched);
+        printf(" output\n");
+        print_binary(ws.ws_always_low & ws.ws_touched);
+        printf(" output always low\n");
+        print_binary(ws.ws_always_high);
+        printf(" output always high\n");
+        print_binary(ws.ws_only_low & ws.ws_touched);
+        printf(" open drain: only drives low\n");
+        print_binary(ws.ws_only_high & ws.ws_touched);
+        printf(" open drain: only drives high\n");
+
+        /* Run an analysis pass */
+        rc = cmd_pld_walk_analyze(pins_affected_by, flags, ignore_mask);
+        if (rc != RC_SUCCESS)
+            goto walk_abort;
+
+        for (bit = 0; bit < 28; bit++) {
+            uint32_t mask = BIT(bit);
+            uint32_t pins_affecting = 0;
+
+            for (pin = 0; pin < 28; pin++) {
+                if (pins_affected_by[pin] & mask)
+                    pins_affecting |= BIT(pin);
+            }
+            if ((pins_affected_by[bit] != 0) || (pins_affecting != 0)) {
+                if (printed == 0) {
+                    printed = 1;
+                    printf("\n        %-40sPins affected\n", "Pins affecting");
+                }
+                if (pins_affecting != 0) {
+                    print_binary(pins_affecting);
+                    printf(" ->");
+                } else {
+                    printf("%34s", "");
+                }
+                printf(" Pin%-2u", bit + 1);
+                if (pins_affected_by[bit] != 0) {
+                    printf(" -> ");
+                    print_binary(pins_affected_by[bit]);
+                }
+                printf("\n");
+            }
+        }
+    }
+walk_abort:
+    pld_disable();
+    return (rc);
+}
+
+
+
+/*
+ * PLD Pins        GPIO Pins
+ * -------------   ---------
+ * PLD1-PLD16    = PE0-PE15
+ * PLD17-PLD28   = PC0-PC11
+ * PLDD1-PLDD16  = PD0-PD15
+ * PLDD17-PLDD24 = PA0-PA7
  * PLDD25-PLDD28 = PB12-PB15
  *
  * Trigger pins
@@ -1908,8 +3343,104 @@ const char cmd_pld_measure_help[] =
 "  count    - show current counters\n"
 "  diagnose - diagnose PLD with broken clock\n"
 "  keep     - keep PLD powered after measurement\n"
+"  quick    - skip statistical measurement and speed grade\n"
 "  same     - do not set up PLD (use with previous keep)\n"
-"  verbose  - verbose output\n";
+"  verbose  - verbose output (includes histogram)\n";
+
+#define MEASURE_SAMPLES     2048   // Input capture samples for statistics
+#define MEASURE_DMA         DMA1
+#define MEASURE_DMA_CHANNEL DMA_CHANNEL6  // TIM3_CH1 request
+#define MEASURE_TIMEOUT_MS  100
+
+static uint16_t measure_samples[MEASURE_SAMPLES];
+
+/*
+ * pld_measure_stats
+ * -----------------
+ * Collect many consecutive TIM3 CH1 input capture values by DMA, then
+ * report statistics on the clock loop period and classify the speed
+ * grade of the part. Each capture is taken every 8 external clocks
+ * (input capture prescaler), so each difference between consecutive
+ * captures spans 8 periods of the PLD clock loop.
+ */
+static rc_t
+pld_measure_stats(uint flag_verbose)
+{
+    uint        cur;
+    uint        ps_per_tick;
+    uint        mean_ps;
+    uint        stddev_ps;
+    uint        min_ps;
+    uint        max_ps;
+    uint64_t    timeout;
+    const char *grade;
+    pld_stats_t stats;
+    const pld_speed_ref_t *ref;
+
+    rcc_periph_clock_enable(RCC_DMA1);
+    dma_disable_channel(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    dma_channel_reset(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    dma_set_peripheral_address(MEASURE_DMA, MEASURE_DMA_CHANNEL,
+                               (uintptr_t)&TIM_CCR1(TIM3));
+    dma_set_memory_address(MEASURE_DMA, MEASURE_DMA_CHANNEL,
+                           (uintptr_t)measure_samples);
+    dma_set_read_from_peripheral(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    dma_set_number_of_data(MEASURE_DMA, MEASURE_DMA_CHANNEL, MEASURE_SAMPLES);
+    dma_disable_peripheral_increment_mode(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    dma_set_peripheral_size(MEASURE_DMA, MEASURE_DMA_CHANNEL,
+                            DMA_CCR_PSIZE_16BIT);
+    dma_set_memory_size(MEASURE_DMA, MEASURE_DMA_CHANNEL, DMA_CCR_MSIZE_16BIT);
+    dma_set_priority(MEASURE_DMA, MEASURE_DMA_CHANNEL, DMA_CCR_PL_VERY_HIGH);
+    dma_enable_channel(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+
+    (void) TIM_CCR1(TIM3);  // Clear any stale capture
+    TIM_DIER(TIM3) |= TIM_DIER_CC1DE;
+
+    timeout = timer_tick_plus_msec(MEASURE_TIMEOUT_MS);
+    while (!dma_get_interrupt_flag(MEASURE_DMA, MEASURE_DMA_CHANNEL,
+                                   DMA_TCIF)) {
+        if (timer_tick_has_elapsed(timeout))
+            break;
+    }
+    TIM_DIER(TIM3) &= ~TIM_DIER_CC1DE;
+    dma_disable_channel(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+
+    cur = MEASURE_SAMPLES -
+          dma_get_number_of_data(MEASURE_DMA, MEASURE_DMA_CHANNEL);
+    if (cur < MEASURE_SAMPLES) {
+        printf("Timeout: only captured %u of %u samples\n",
+               cur, MEASURE_SAMPLES);
+        return (RC_TIMEOUT);
+    }
+
+    /* Convert capture values to loop periods in place */
+    for (cur = 0; cur < MEASURE_SAMPLES - 1; cur++)
+        measure_samples[cur] = measure_samples[cur + 1] - measure_samples[cur];
+    pld_stats_compute(measure_samples, MEASURE_SAMPLES - 1, &stats);
+
+    /* TIM3 runs at the APB1 timer clock (2x APB1); 8 periods per capture */
+    ps_per_tick = 1000000000 / (clock_get_apb1() * 2 / 1000) / 8;
+    mean_ps     = (uint64_t) stats.ps_mean_x256 * ps_per_tick / 256;
+    stddev_ps   = (uint64_t) stats.ps_stddev_x256 * ps_per_tick / 256;
+    min_ps      = stats.ps_min * ps_per_tick;
+    max_ps      = stats.ps_max * ps_per_tick;
+
+    printf("   %u samples  mean %u.%u ns  stddev %u.%02u ns  "
+           "min %u.%u ns  max %u.%u ns\n", (uint) stats.ps_count,
+           mean_ps / 1000, (mean_ps % 1000) / 100,
+           stddev_ps / 1000, (stddev_ps % 1000) / 10,
+           min_ps / 1000, (min_ps % 1000) / 100,
+           max_ps / 1000, (max_ps % 1000) / 100);
+    if (flag_verbose)
+        pld_stats_show_histogram(&stats, ps_per_tick);
+
+    grade = pld_speed_classify(mean_ps, &ref);
+    printf("   Speed grade %s  (closest reference %s %u.%u ns)\n",
+           grade, ref->psr_part, ref->psr_loop_ns_x10 / 10,
+           ref->psr_loop_ns_x10 % 10);
+    return (RC_SUCCESS);
+}
 
 /*
  * pld_measure
@@ -1932,9 +3463,11 @@ pld_measure(int argc, char * const *argv)
     uint timeout;
     uint flag_diagnose = 0;
     uint flag_keep = 0;
+    uint flag_quick = 0;
     uint flag_same = 0;
     uint flag_verbose = 0;
     int arg;
+    rc_t rc = RC_SUCCESS;
 
     for (arg = 2; arg < argc; arg++) {
         const char *ptr = argv[arg];
@@ -1959,6 +3492,9 @@ pld_measure(int argc, char * const *argv)
             case 'k':
                 flag_keep++;
                 break;
+            case 'q':
+                flag_quick++;
+                break;
             case 'v':
                 flag_verbose++;
                 break;
@@ -2025,12 +3561,15 @@ pld_measure(int argc, char * const *argv)
            psec_per_tick / 1000, (psec_per_tick % 1000) / 100,
            psec_silicon / 1000, (psec_silicon % 1000) / 100);
 
+    if ((timeout != 0) && (flag_quick == 0))
+        rc = pld_measure_stats(flag_verbose);
+
     if (flag_keep == 0)
         pld_disable();
 
     if (timeout == 0)
         return (pld_measure_diagnose(flag_keep, flag_verbose));
-    return (RC_SUCCESS);
+    return (rc);
 }
 
 /*
@@ -2046,6 +3585,814 @@ pld_measure(int argc, char * const *argv)
  *     GAL22V10C-25LJ  132ns   7.499 134.5   7.434
  */
 
+/*
+ * PLD propagation delay (tpd) measurement
+ *
+ * For each input which affects an output, a sensitizing vector is found
+ * during a walk of the selected pins. The input is then toggled with all
+ * other pins held at that vector, and the time until the output changes
+ * is measured. Both edges (toggle and toggle back) are measured for
+ * each trial.
+ *
+ * PLD23-PLD26 (PC6-PC9) are timed by TIM3 input capture at the APB1
+ * timer clock (72 MHz, ~13.9 ns resolution). Other PLD_* pins are timed
+ * by a DMA2 memory-to-memory burst which samples GPIO_IDR of the output
+ * pin's port as fast as the bus allows. That rate is calibrated against
+ * the DWT cycle counter before measurement; its resolution is several
+ * CPU cycles.
+ *
+ * All times include the PLDD_* 1K series resistor driving the PLD input
+ * pin capacitance, so they are slightly longer than datasheet tpd.
+ */
+#define TIMING_DEFAULT_TRIALS 16
+#define TIMING_MAX_TRIALS     1000
+#define TIMING_DMA_SAMPLES    256
+#define TIMING_DMA_PRESAMPLES 16     // Samples before driving transition
+#define TIMING_SPIN_TIMEOUT   10000
+#define TIMING_FAIL           0xffffffff
+
+#define TIMING_DMA            DMA2
+#define TIMING_DMA_CHANNEL    DMA_CHANNEL1
+
+static uint32_t timing_vec[28][28];     // Sensitizing vector [input][output]
+static uint32_t timing_found[28];       // Outputs sensitized by [input]
+static uint16_t timing_dma_buf[TIMING_DMA_SAMPLES];
+
+/*
+ * pld_timing_find_vectors
+ * -----------------------
+ * Walk all combinations of the non-ignored pins, flipping each one in
+ * turn, and record the first vector which causes each output to follow
+ * a given input.
+ */
+static rc_t
+pld_timing_find_vectors(uint32_t ignore_mask)
+{
+    int      bit;
+    uint     count = 0;
+    uint32_t cur_mask = 0;
+    uint32_t read_before;
+    uint32_t read_after;
+    uint32_t rdiff_mask;
+    uint32_t new_mask;
+    uint32_t vec;
+    uint     out;
+
+    memset(timing_found, 0, sizeof (timing_found));
+    do {
+        vec = cur_mask | walk_hold_value;
+        for (bit = 0; bit < 28; bit++) {
+            if (ignore_mask & BIT(bit))
+                continue;
+            read_before = pldd_output_pld_input(vec);
+            read_after  = pldd_output_pld_input(vec ^ BIT(bit));
+            rdiff_mask  = (read_before ^ read_after) & ~BIT(bit) & 0x0fffffff;
+            new_mask    = rdiff_mask & ~timing_found[bit];
+            if (new_mask == 0)
+                continue;
+            timing_found[bit] |= new_mask;
+            for (out = 0; out < 28; out++)
+                if (new_mask & BIT(out))
+                    timing_vec[bit][out] = vec;
+        }
+        if ((count++ & 0x1f) == 0) {
+            if (is_abort_button_pressed() || input_break_pending()) {
+                printf("^C Abort\n");
+                return (RC_USR_ABORT);
+            }
+        }
+        cur_mask = ((cur_mask | ignore_mask) + 1) & ~ignore_mask;
+    } while (cur_mask != 0);
+
+    return (RC_SUCCESS);
+}
+
+/*
+ * pld_timing_capture_setup
+ * ------------------------
+ * Configure TIM3 to free-run at the timer clock with input capture on
+ * PLD23-PLD26, and DMA2 channel 1 for memory-to-memory GPIO sampling.
+ */
+static void
+pld_timing_capture_setup(void)
+{
+    /* Remap PC6 PC7 PC8 PC9 to TIM3 CH1 CH2 CH3 CH4 */
+    AFIO_MAPR |= AFIO_MAPR_TIM3_REMAP_FULL_REMAP;
+
+    rcc_periph_clock_enable(RCC_TIM3);
+    rcc_periph_reset_pulse(RST_TIM3);
+    TIM_CR1(TIM3) &= ~(TIM_CR1_CKD_CK_INT_MASK | TIM_CR1_CMS_MASK |
+                       TIM_CR1_DIR_DOWN);
+    timer_set_prescaler(TIM3, 0);
+    timer_set_period(TIM3, 0xffff);  // Rollover at 2^16
+
+    timer_ic_set_input(TIM3, TIM_IC1, TIM_IC_IN_TI1);
+    timer_ic_set_input(TIM3, TIM_IC2, TIM_IC_IN_TI2);
+    timer_ic_set_input(TIM3, TIM_IC3, TIM_IC_IN_TI1);  // TI3
+    timer_ic_set_input(TIM3, TIM_IC4, TIM_IC_IN_TI2);  // TI4
+    timer_continuous_mode(TIM3);
+    timer_enable_counter(TIM3);
+
+    rcc_periph_clock_enable(RCC_DMA2);
+    dma_disable_channel(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_channel_reset(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_set_memory_address(TIMING_DMA, TIMING_DMA_CHANNEL,
+                           (uintptr_t)timing_dma_buf);
+    dma_set_read_from_peripheral(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_enable_mem2mem_mode(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_disable_peripheral_increment_mode(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_set_peripheral_size(TIMING_DMA, TIMING_DMA_CHANNEL,
+                            DMA_CCR_PSIZE_16BIT);
+    dma_set_memory_size(TIMING_DMA, TIMING_DMA_CHANNEL, DMA_CCR_MSIZE_16BIT);
+    dma_set_priority(TIMING_DMA, TIMING_DMA_CHANNEL, DMA_CCR_PL_VERY_HIGH);
+}
+
+/*
+ * pld_timing_capture_shutdown
+ * ---------------------------
+ * Release the resources used for propagation delay capture.
+ */
+static void
+pld_timing_capture_shutdown(void)
+{
+    dma_disable_channel(TIMING_DMA, TIMING_DMA_CHANNEL);
+    timer_disable_counter(TIM3);
+    AFIO_MAPR &= ~AFIO_MAPR_TIM3_REMAP_FULL_REMAP;
+}
+
+/*
+ * pld_timing_dma_start
+ * --------------------
+ * Start a DMA burst sampling the GPIO_IDR of the specified port.
+ */
+static void
+pld_timing_dma_start(uint32_t port)
+{
+    dma_disable_channel(TIMING_DMA, TIMING_DMA_CHANNEL);
+    dma_clear_interrupt_flags(TIMING_DMA, TIMING_DMA_CHANNEL, DMA_TCIF);
+    dma_set_peripheral_address(TIMING_DMA, TIMING_DMA_CHANNEL,
+                               (uintptr_t)&GPIO_IDR(port));
+    dma_set_number_of_data(TIMING_DMA, TIMING_DMA_CHANNEL,
+                           TIMING_DMA_SAMPLES);
+    dma_enable_channel(TIMING_DMA, TIMING_DMA_CHANNEL);
+}
+
+/*
+ * pld_timing_dma_wait
+ * -------------------
+ * Wait for a DMA sampling burst to complete.
+ */
+static rc_t
+pld_timing_dma_wait(void)
+{
+    uint timeout;
+
+    for (timeout = TIMING_SPIN_TIMEOUT; timeout > 0; timeout--)
+        if (dma_get_interrupt_flag(TIMING_DMA, TIMING_DMA_CHANNEL, DMA_TCIF))
+            return (RC_SUCCESS);
+    return (RC_TIMEOUT);
+}
+
+/*
+ * pld_timing_dma_calibrate
+ * ------------------------
+ * Measure the DMA GPIO sample period in CPU cycles, scaled by 256.
+ */
+static uint32_t
+pld_timing_dma_calibrate(void)
+{
+    uint32_t start;
+    uint32_t cycles;
+
+    disable_irq();
+    start = dwt_read_cycle_counter();
+    pld_timing_dma_start(PLD1_PORT);
+    (void) pld_timing_dma_wait();
+    cycles = dwt_read_cycle_counter() - start;
+    enable_irq();
+
+    return (cycles * 256 / TIMING_DMA_SAMPLES);
+}
+
+/*
+ * pld_timing_measure_edge
+ * -----------------------
+ * Drive from_mask, wait for it to settle, then drive to_mask and measure
+ * the number of CPU cycles until the specified output changes. Returns
+ * TIMING_FAIL if the output did not change as expected.
+ */
+static uint32_t
+pld_timing_measure_edge(uint32_t from_mask, uint32_t to_mask, uint out,
+                        uint32_t dma_period)
+{
+    uint32_t before;
+    uint32_t cycles;
+    uint     timeout;
+
+    before = pldd_output_pld_input(from_mask) & BIT(out);
+    timer_delay_usec(1);
+
+    if ((out >= 22) && (out <= 25)) {
+        /* PLD23-PLD26: TIM3 input capture */
+        uint     ch = out - 22;
+        uint16_t tstart;
+        uint16_t tend;
+        uint32_t ccif = TIM_SR_CC1IF << ch;
+        static const enum tim_ic_id ics[] = {
+            TIM_IC1, TIM_IC2, TIM_IC3, TIM_IC4
+        };
+        static volatile uint32_t *const ccrs[] = {
+            &TIM_CCR1(TIM3), &TIM_CCR2(TIM3), &TIM_CCR3(TIM3), &TIM_CCR4(TIM3)
+        };
+
+        timer_ic_disable(TIM3, ics[ch]);
+        timer_ic_set_polarity(TIM3, ics[ch],
+                              before ? TIM_IC_FALLING : TIM_IC_RISING);
+        timer_ic_enable(TIM3, ics[ch]);
+        (void) *ccrs[ch];  // Reading CCR clears CCxIF
+        TIM_SR(TIM3) = ~(ccif | (TIM_SR_CC1OF << ch));
+
+        disable_irq();
+        tstart = TIM_CNT(TIM3);
+        pldd_output(to_mask);
+        for (timeout = TIMING_SPIN_TIMEOUT; timeout > 0; timeout--)
+            if (TIM_SR(TIM3) & ccif)
+                break;
+        tend = *ccrs[ch];
+        enable_irq();
+        timer_ic_disable(TIM3, ics[ch]);
+
+        if (timeout == 0)
+            return (TIMING_FAIL);
+
+        /* Convert timer ticks to CPU cycles */
+        cycles = (uint16_t) (tend - tstart);
+        return ((uint64_t) cycles * clock_get_hclk() / (clock_get_apb1() * 2));
+    } else {
+        /* Other pins: DMA sampling of the port's GPIO_IDR */
+        uint32_t port = (out < 16) ? PLD1_PORT : PLD17_PORT;
+        uint16_t pmask = BIT((out < 16) ? out : (out - 16));
+        uint16_t pbefore = before ? pmask : 0;
+        uint32_t dstart;
+        uint32_t twrite;
+        uint     pos;
+
+        disable_irq();
+        dstart = dwt_read_cycle_counter();
+        pld_timing_dma_start(port);
+        while (dwt_read_cycle_counter() - dstart <
+               dma_period * TIMING_DMA_PRESAMPLES / 256)
+            continue;
+        twrite = dwt_read_cycle_counter();
+        pldd_output(to_mask);
+        (void) pld_timing_dma_wait();
+        enable_irq();
+
+        if ((timing_dma_buf[0] & pmask) != pbefore)
+            return (TIMING_FAIL);
+        for (pos = 1; pos < TIMING_DMA_SAMPLES; pos++)
+            if ((timing_dma_buf[pos] & pmask) != pbefore)
+                break;
+        if (pos == TIMING_DMA_SAMPLES)
+            return (TIMING_FAIL);
+
+        cycles = dstart + pos * dma_period / 256;
+        if ((int32_t) (cycles - twrite) < 0)
+            return (0);  // Transition happened before the write completed
+        return (cycles - twrite);
+    }
+}
+
+const char cmd_pld_timing_help[] =
+"pld timing <pins> [trials=<n>]\n"
+"  Measure propagation delay of each input to each output it affects.\n"
+"  Pins are specified as with pld walk (dip, plcc, auto, ranges, etc).\n"
+"  Only PLD23-PLD26 have timer capture resolution (~14 ns).\n";
+
+/*
+ * pld_timing
+ * ----------
+ * Measure and report the propagation delay matrix for all sensitized
+ * input to output paths of the inserted part.
+ */
+static rc_t
+pld_timing(int argc, char * const *argv)
+{
+    int      arg;
+    int      nargc = 0;
+    char    *nargv[32];
+    uint     trials = TIMING_DEFAULT_TRIALS;
+    uint     flags = 0;
+    uint     bit;
+    uint     out;
+    uint     trial;
+    uint32_t ignore_mask;
+    uint32_t outputs = 0;
+    uint32_t dma_period;
+    uint32_t cycles;
+    uint32_t cmin;
+    uint32_t cmax;
+    uint     mhz = clock_get_hclk() / 1000000;
+    rc_t     rc;
+
+    /* Separate timing options from pin selection */
+    for (arg = 1; arg < argc; arg++) {
+        if (strncmp(argv[arg], "trials=", 7) == 0) {
+            if ((parse_uint(argv[arg] + 7, &trials) != RC_SUCCESS) ||
+                (trials == 0) || (trials > TIMING_MAX_TRIALS)) {
+                printf("Invalid trials: %s\n", argv[arg] + 7);
+                return (RC_BAD_PARAM);
+            }
+        } else if (strcmp(argv[arg], "?") == 0) {
+            printf("%s", cmd_pld_timing_help);
+            return (RC_SUCCESS);
+        } else if (nargc < (int) ARRAY_SIZE(nargv) - 1) {
+            nargv[++nargc] = argv[arg];
+        }
+    }
+    nargv[0] = argv[0];
+    rc = cmd_pld_get_ignore_mask(nargc + 1, nargv, &ignore_mask, &flags);
+    if (rc != RC_SUCCESS)
+        return (rc);
+    if (flags != 0) {
+        printf("Walk options are not valid for pld timing\n");
+        return (RC_USER_HELP);
+    }
+    if (!dwt_enable_cycle_counter()) {
+        printf("DWT cycle counter is not available\n");
+        return (RC_FAILURE);
+    }
+
+    /*
+     * GAL22V10-25 empirical power-on time is ~500usec
+     */
+    pld_enable();
+    timer_delay_msec(2);
+
+    rc = pld_timing_find_vectors(ignore_mask);
+    if (rc != RC_SUCCESS)
+        goto timing_fail;
+
+    for (bit = 0; bit < 28; bit++)
+        outputs |= timing_found[bit];
+    if (outputs == 0) {
+        printf("No inputs were found to affect any outputs\n");
+        rc = RC_FAILURE;
+        goto timing_fail;
+    }
+
+    pld_timing_capture_setup();
+    dma_period = pld_timing_dma_calibrate();
+    printf("tpd min-max ns over %u trials (both edges); "
+           "IDR sample period %lu.%lu ns\n", trials,
+           dma_period * 1000 / 256 / mhz,
+           (dma_period * 1000 / 256 * 10 / mhz) % 10);
+
+    printf("In\\Out");
+    for (out = 0; out < 28; out++)
+        if (outputs & BIT(out))
+            printf("   Pin%-2u ", out + 1);
+    printf("\n");
+
+    for (bit = 0; bit < 28; bit++) {
+        if (timing_found[bit] == 0)
+            continue;
+        printf("Pin%-2u ", bit + 1);
+        for (out = 0; out < 28; out++) {
+            if ((outputs & BIT(out)) == 0)
+                continue;
+            if ((timing_found[bit] & BIT(out)) == 0) {
+                printf("    -    ");
+                continue;
+            }
+            cmin = TIMING_FAIL;
+            cmax = 0;
+            for (trial = 0; trial < trials; trial++) {
+                uint32_t vec = timing_vec[bit][out];
+                uint     edge;
+                for (edge = 0; edge < 2; edge++) {
+                    cycles = pld_timing_measure_edge(vec, vec ^ BIT(bit), out,
+                                                     dma_period);
+                    vec ^= BIT(bit);
+                    if (cycles == TIMING_FAIL)
+                        continue;
+                    if (cmin > cycles)
+                        cmin = cycles;
+                    if (cmax < cycles)
+                        cmax = cycles;
+                }
+            }
+            if (cmin == TIMING_FAIL)
+                printf("   fail  ");
+            else
+                printf(" %3lu-%-4lu", cmin * 1000 / mhz, cmax * 1000 / mhz);
+            if (is_abort_button_pressed() || input_break_pending()) {
+                printf("^C Abort\n");
+                rc = RC_USR_ABORT;
+                goto timing_abort;
+            }
+        }
+        printf("\n");
+    }
+
+timing_abort:
+    pld_timing_capture_shutdown();
+timing_fail:
+    pld_disable();
+    return (rc);
+}
+
+/*
+ * In-circuit logic analyzer ("pld watch").
+ *
+ * With Brutus power and all drivers off, PLD1-PLD28 are sampled from
+ * GPIO_IDR of both PLD ports by timer-paced DMA: each TIM5 update
+ * requests a DMA2 channel 2 transfer of PLD1-PLD16 (PE), and the TIM5
+ * CH1 compare at count zero requests a DMA2 channel 5 transfer of
+ * PLD17-PLD28 (PC), so both halves of a sample are taken a few bus
+ * cycles apart. Both channels run in circular mode, and the CPU follows
+ * behind the DMA, encoding only the samples at which some pin changed.
+ *
+ * After a "---- WATCH RATE=<hz> ----" header line, the binary stream
+ * is the 32-bit little-endian pin state at the trigger sample, then
+ * one record per change: the number of sample periods since the
+ * previous record followed by the mask of pins which changed, each as
+ * a LEB128 variable-length integer. A record with a zero change mask
+ * ends the stream; its period count runs to the last sample taken.
+ * sw/pldwatch decodes the stream.
+ */
+#define WATCH_DMA_SAMPLES   2048   // Samples per circular buffer (2^n)
+#define WATCH_DMA_MARGIN    64     // Samples of slack for overrun check
+#define WATCH_DMA           DMA2
+#define WATCH_DMA_CH_LO     DMA_CHANNEL2  // TIM5_UP request: PLD1-PLD16
+#define WATCH_DMA_CH_HI     DMA_CHANNEL5  // TIM5_CH1 request: PLD17-PLD28
+#define WATCH_DEFAULT_KHZ   2000
+#define WATCH_MIN_KHZ       2      // TIM5 period is limited to 16 bits
+#define WATCH_MAX_KHZ       6000
+#define WATCH_DEFAULT_MSEC  1000
+#define WATCH_MAX_MSEC      600000
+#define WATCH_OUT_SIZE      256
+
+#define WATCH_EDGE_NONE     0
+#define WATCH_EDGE_RISE     1
+#define WATCH_EDGE_FALL     2
+#define WATCH_EDGE_ANY      3
+
+static uint16_t watch_buf_lo[WATCH_DMA_SAMPLES];
+static uint16_t watch_buf_hi[WATCH_DMA_SAMPLES];
+static uint8_t  watch_out[WATCH_OUT_SIZE];
+static uint     watch_out_len;
+static uint     watch_out_total;
+
+const char cmd_pld_watch_help[] =
+"pld watch [rate=<khz>] [time=<msec>] [trigger=<mask>:<value>]\n"
+"          [rise=<pin>|fall=<pin>|edge=<pin>]\n"
+"  Passively record PLD1-PLD28 of a part in a live target board.\n"
+"  Only changes are sent, timestamped in sample periods, for decoding\n"
+"  by sw/pldwatch. Brutus power and all Brutus drivers remain off.\n"
+"  rate    - sample rate in KHz (default 2000, range 2-6000)\n"
+"  time    - capture time after the trigger (default 1000; 0 until ^C)\n"
+"  trigger - start when pins in hex <mask> match <value>\n"
+"  rise    - start on a rising edge of <pin> (also fall, edge)\n";
+
+/*
+ * pld_watch_dma_setup
+ * -------------------
+ * Configure a DMA2 channel to copy the GPIO_IDR of the specified port
+ * to a circular sample buffer at each request from TIM5.
+ */
+static void
+pld_watch_dma_setup(uint8_t channel, uint32_t port, uint16_t *buf)
+{
+    dma_disable_channel(WATCH_DMA, channel);
+    dma_channel_reset(WATCH_DMA, channel);
+    dma_set_peripheral_address(WATCH_DMA, channel, (uintptr_t)&GPIO_IDR(port));
+    dma_set_memory_address(WATCH_DMA, channel, (uintptr_t)buf);
+    dma_set_read_from_peripheral(WATCH_DMA, channel);
+    dma_set_number_of_data(WATCH_DMA, channel, WATCH_DMA_SAMPLES);
+    dma_disable_peripheral_increment_mode(WATCH_DMA, channel);
+    dma_enable_memory_increment_mode(WATCH_DMA, channel);
+    dma_enable_circular_mode(WATCH_DMA, channel);
+    dma_set_peripheral_size(WATCH_DMA, channel, DMA_CCR_PSIZE_16BIT);
+    dma_set_memory_size(WATCH_DMA, channel, DMA_CCR_MSIZE_16BIT);
+    dma_set_priority(WATCH_DMA, channel, DMA_CCR_PL_VERY_HIGH);
+    dma_enable_channel(WATCH_DMA, channel);
+}
+
+/*
+ * pld_watch_capture_start
+ * -----------------------
+ * Start TIM5 with the specified period in timer clocks, with its update
+ * and CH1 compare events each requesting a sample by DMA.
+ */
+static void
+pld_watch_capture_start(uint32_t period)
+{
+    rcc_periph_clock_enable(RCC_DMA2);
+    pld_watch_dma_setup(WATCH_DMA_CH_LO, PLD1_PORT, watch_buf_lo);
+    pld_watch_dma_setup(WATCH_DMA_CH_HI, PLD17_PORT, watch_buf_hi);
+
+    rcc_periph_clock_enable(RCC_TIM5);
+    rcc_periph_reset_pulse(RST_TIM5);
+    timer_set_prescaler(TIM5, 0);
+    timer_set_period(TIM5, period - 1);
+    timer_set_oc_value(TIM5, TIM_OC1, 0);
+    timer_continuous_mode(TIM5);
+    TIM_DIER(TIM5) |= TIM_DIER_UDE | TIM_DIER_CC1DE;
+    timer_enable_counter(TIM5);
+#ifdef HOST_SIM
+    sim_port_sample_start(period);
+#endif
+}
+
+/*
+ * pld_watch_capture_stop
+ * ----------------------
+ * Release the resources used for in-circuit sampling.
+ */
+static void
+pld_watch_capture_stop(void)
+{
+    timer_disable_counter(TIM5);
+    TIM_DIER(TIM5) &= ~(TIM_DIER_UDE | TIM_DIER_CC1DE);
+    dma_disable_channel(WATCH_DMA, WATCH_DMA_CH_LO);
+    dma_disable_channel(WATCH_DMA, WATCH_DMA_CH_HI);
+}
+
+/*
+ * pld_watch_dma_pos
+ * -----------------
+ * Return the index of the next sample to be written. The PLD17-PLD28
+ * channel is serviced second, so the sample before this index is
+ * complete in both buffers.
+ */
+static uint
+pld_watch_dma_pos(void)
+{
+#ifdef HOST_SIM
+    return (sim_port_sample_pos(watch_buf_lo, watch_buf_hi,
+                                WATCH_DMA_SAMPLES));
+#else
+    return ((WATCH_DMA_SAMPLES -
+             dma_get_number_of_data(WATCH_DMA, WATCH_DMA_CH_HI)) &
+            (WATCH_DMA_SAMPLES - 1));
+#endif
+}
+
+/*
+ * pld_watch_flush
+ * ---------------
+ * Send encoded change records to the host.
+ */
+static void
+pld_watch_flush(void)
+{
+    if (watch_out_len == 0)
+        return;
+    (void) puts_binary_stream(watch_out, watch_out_len);
+    watch_out_total += watch_out_len;
+    watch_out_len = 0;
+}
+
+/*
+ * pld_watch_put
+ * -------------
+ * Append a LEB128-encoded value to the change record output buffer.
+ */
+static void
+pld_watch_put(uint32_t value)
+{
+    if (watch_out_len > WATCH_OUT_SIZE - 5)
+        pld_watch_flush();
+    while (value >= 0x80) {
+        watch_out[watch_out_len++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    watch_out[watch_out_len++] = value;
+}
+
+/*
+ * pld_watch_parse_pin
+ * -------------------
+ * Parse a PLD pin number (1-28), returning the bit number.
+ */
+static rc_t
+pld_watch_parse_pin(const char *str, uint *bit)
+{
+    uint pin;
+    int  pos = 0;
+
+    if ((sscanf(str, "%u%n", &pin, &pos) != 1) || (str[pos] != '\0') ||
+        (pin < 1) || (pin > 28)) {
+        printf("Invalid pin '%s'; range 1-28\n", str);
+        return (RC_BAD_PARAM);
+    }
+    *bit = pin - 1;
+    return (RC_SUCCESS);
+}
+
+/*
+ * pld_watch
+ * ---------
+ * Record pin changes of a part in a live target board until the time
+ * limit, ^C, or a sampling overrun.
+ */
+static rc_t
+pld_watch(int argc, char * const *argv)
+{
+    int      arg;
+    uint     khz = WATCH_DEFAULT_KHZ;
+    uint     msec = WATCH_DEFAULT_MSEC;
+    uint     edge = WATCH_EDGE_NONE;
+    uint     edge_bit = 0;
+    uint     timer_clk = clock_get_apb1() * 2;
+    uint     hclk = clock_get_hclk();
+    uint     period;
+    uint     hz;
+    uint     pos;
+    uint     cons = 0;
+    uint     polls = 0;
+    uint     changes = 0;
+    uint     triggered = 0;
+    uint     have_prev = 0;
+    uint     aborted = 0;
+    uint     overrun = 0;
+    uint     trig_mask = 0;
+    uint     trig_value = 0;
+    uint32_t stop_count;
+    uint32_t count = 0;
+    uint32_t last_change = 0;
+    uint32_t sample;
+    uint32_t prev = 0;
+    uint32_t period_cycles;
+    uint32_t last_poll;
+    uint32_t now;
+    uint32_t unread = 0;
+
+    for (arg = 1; arg < argc; arg++) {
+        const char *ptr = argv[arg];
+        const char *eq = strchr(ptr, '=');
+        int         pos_end = 0;
+
+        if (strcmp(ptr, "?") == 0) {
+            printf("%s", cmd_pld_watch_help);
+            return (RC_SUCCESS);
+        }
+        if (eq == NULL) {
+            printf("Invalid argument '%s'\n", ptr);
+            return (RC_USER_HELP);
+        }
+        eq++;
+        if (strncmp(ptr, "rate=", 5) == 0) {
+            if ((sscanf(eq, "%u%n", &khz, &pos_end) != 1) ||
+                (eq[pos_end] != '\0') || (khz < WATCH_MIN_KHZ) ||
+                (khz > WATCH_MAX_KHZ)) {
+                printf("Invalid rate '%s'; range %u-%u KHz\n",
+                       eq, WATCH_MIN_KHZ, WATCH_MAX_KHZ);
+                return (RC_BAD_PARAM);
+            }
+        } else if (strncmp(ptr, "time=", 5) == 0) {
+            if ((sscanf(eq, "%u%n", &msec, &pos_end) != 1) ||
+                (eq[pos_end] != '\0') || (msec > WATCH_MAX_MSEC)) {
+                printf("Invalid time '%s'; range 0-%u msec\n",
+                       eq, WATCH_MAX_MSEC);
+                return (RC_BAD_PARAM);
+            }
+        } else if (strncmp(ptr, "trigger=", 8) == 0) {
+            if ((sscanf(eq, "%x:%x%n", &trig_mask, &trig_value,
+                        &pos_end) != 2) || (eq[pos_end] != '\0')) {
+                printf("Invalid trigger '%s'; use <mask>:<value>\n", eq);
+                return (RC_BAD_PARAM);
+            }
+            trig_mask &= 0x0fffffff;
+            trig_value &= trig_mask;
+        } else if ((strncmp(ptr, "rise=", 5) == 0) ||
+                   (strncmp(ptr, "fall=", 5) == 0) ||
+                   (strncmp(ptr, "edge=", 5) == 0)) {
+            if (pld_watch_parse_pin(eq, &edge_bit) != RC_SUCCESS)
+                return (RC_BAD_PARAM);
+            edge = (*ptr == 'r') ? WATCH_EDGE_RISE :
+                   (*ptr == 'f') ? WATCH_EDGE_FALL : WATCH_EDGE_ANY;
+        } else {
+            printf("Invalid argument '%s'\n", ptr);
+            return (RC_USER_HELP);
+        }
+    }
+    if (!dwt_enable_cycle_counter()) {
+        printf("DWT cycle counter is not available\n");
+        return (RC_FAILURE);
+    }
+
+    period = timer_clk / (khz * 1000);
+    hz = timer_clk / period;
+    stop_count = (uint64_t) hz * msec / 1000;
+    if (stop_count == 0)
+        stop_count = 0xffffffff;  // Until ^C
+    period_cycles = (uint64_t) period * hclk / timer_clk;
+
+    printf("Watching PLD1-PLD28 at %u Hz", hz);
+    if (trig_mask != 0)
+        printf(", trigger %07x:%07x", trig_mask, trig_value);
+    if (edge != WATCH_EDGE_NONE)
+        printf(", %s of pin %u", (edge == WATCH_EDGE_RISE) ? "rise" :
+               (edge == WATCH_EDGE_FALL) ? "fall" : "edge", edge_bit + 1);
+    printf("\n");
+
+    /* Brutus must neither power nor drive the target circuit */
+    pld_disable();
+    pldd_gpio_setmode(0x0fffffff, GPIO_SETMODE_INPUT);
+
+    watch_out_len = 0;
+    watch_out_total = 0;
+    pld_watch_capture_start(period);
+    last_poll = dwt_read_cycle_counter();
+
+    while (1) {
+        pos = pld_watch_dma_pos();
+        now = dwt_read_cycle_counter();
+
+        /*
+         * Samples which arrived since the last poll began overwriting
+         * those which were unread at that time once there were more
+         * than the free space of the buffer.
+         */
+        if ((unread >= WATCH_DMA_SAMPLES - WATCH_DMA_MARGIN) ||
+            (now - last_poll >= (WATCH_DMA_SAMPLES - WATCH_DMA_MARGIN -
+                                 unread) * period_cycles)) {
+            if (triggered) {
+                overrun = 1;
+                break;
+            }
+            cons = pos;  // Resynchronize while waiting for the trigger
+            have_prev = 0;
+        }
+        last_poll = now;
+        unread = (pos - cons) & (WATCH_DMA_SAMPLES - 1);
+
+        for (; cons != pos; cons = (cons + 1) & (WATCH_DMA_SAMPLES - 1)) {
+            sample = watch_buf_lo[cons] |
+                     ((watch_buf_hi[cons] & 0x0fff) << 16);
+            if (triggered) {
+                count++;
+                if (sample != prev) {
+                    pld_watch_put(count - last_change);
+                    pld_watch_put(sample ^ prev);
+                    last_change = count;
+                    changes++;
+                    prev = sample;
+                }
+                if (count == stop_count)
+                    goto watch_done;
+                continue;
+            }
+            if (((sample & trig_mask) == trig_value) &&
+                ((edge == WATCH_EDGE_NONE) ||
+                 (have_prev && ((sample ^ prev) & BIT(edge_bit)) &&
+                  ((edge == WATCH_EDGE_ANY) ||
+                   (((sample >> edge_bit) & 1) ==
+                    (edge == WATCH_EDGE_RISE)))))) {
+                triggered = 1;
+                printf("---- WATCH RATE=%u ----\n", hz);
+                memcpy(watch_out, &sample, sizeof (sample));
+                watch_out_len = sizeof (sample);
+            }
+            prev = sample;
+            have_prev = 1;
+        }
+        unread = 0;
+
+        if ((++polls & 0x3f) == 0) {
+            if (is_abort_button_pressed() || input_break_pending()) {
+                aborted = 1;
+                break;
+            }
+        }
+    }
+watch_done:
+    pld_watch_capture_stop();
+    pld_disable();
+
+    if (triggered) {
+        pld_watch_put(count - last_change);
+        pld_watch_put(0);
+        pld_watch_flush();
+        printf("---- END ----\n");
+        printf("%u changes in %lu samples (%lu usec), %u bytes\n",
+               changes, count, (uint32_t) ((uint64_t) count * 1000000 / hz),
+               watch_out_total);
+    }
+    if (overrun) {
+        printf("Sampling overrun; try a lower rate\n");
+        return (RC_FAILURE);
+    }
+    if (aborted) {
+        printf("^C Abort\n");
+        return ((triggered && (msec == 0)) ? RC_SUCCESS : RC_USR_ABORT);
+    }
+    return (RC_SUCCESS);
+}
+
 static const char *
 pld_get_pin_drive_state_str(uint pin, uint output_dd, uint output_d)
 {
@@ -2293,14 +4640,18 @@ pld_show(int argc, char * const *argv)
 }
 
 const char cmd_pld_help[] =
-"pld check          - check GPIOs without PLD attached\n"
+"pld check [all]    - check GPIOs without PLD attached\n"
 "pld disable        - disable PLD power\n"
 "pld enable         - enable PLD power\n"
 "pld measure        - measure PLD speed (requires custom programming)\n"
 "pld output <value> - drive PLDD pins (resistor-protected GPIOs)\n"
 "pld show [20]      - show current PLD pin values\n"
+"pld sig [?|cmd]    - manage stored design signatures\n"
+"pld stats          - show profile of the last walk\n"
+"pld timing <pins>  - measure input to output propagation delays\n"
 "pld voltage        - show sensor readings\n"
-"pld walk [?|opt]   - walk GPIO bits (use 'walk ?' for more help)\n";
+"pld walk [?|opt]   - walk GPIO bits (use 'walk ?' for more help)\n"
+"pld watch [?|opt]  - record pin changes in a live target board\n";
 
 /*
  * cmd_pld
@@ -2317,7 +4668,7 @@ cmd_pld(int argc, char * const *argv)
 
     switch (*argv[1]) {
         case 'c':  // check
-            return (pld_check());
+            return (pld_check(argc - 1, argv + 1));
         case 'e':  // enable
             pld_enable();
             break;
@@ -2336,16 +4687,27 @@ cmd_pld(int argc, char * const *argv)
             pldd_output(data);
             pldd_output_enable();
             break;
+        case 's':  // show value, signatures, or stats
+            if (strcmp(argv[1], "sig") == 0)
+                return (cmd_pld_sig(argc - 1, argv + 1));
+            if ((strlen(argv[1]) > 1) &&
+                (strncmp(argv[1], "stats", strlen(argv[1])) == 0))
+                return (pld_walk_stats());
+            /* FALLTHROUGH */
         case 'i':  // input
-        case 's':  // show value
             argc--;
             argv++;
             pld_show(argc, argv);
             break;
+        case 't':  // timing
+            return (pld_timing(argc - 1, argv + 1));
         case 'v':  // show value
             adc_show_sensors();
             break;
-        case 'w':  // show walk
+        case 'w':  // walk or watch
+            if ((strlen(argv[1]) > 2) &&
+                (strncmp(argv[1], "watch", strlen(argv[1])) == 0))
+                return (pld_watch(argc - 1, argv + 1));
             return (cmd_pld_walk(argc - 1, argv + 1));
         default:
             printf("Unknown argument %s\n", argv[1]);
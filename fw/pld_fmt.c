@@ -0,0 +1,100 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Fixed-format value formatting for high-rate walk output.
+ *
+ * The walk emits one line per vector, so general-purpose sprintf()
+ * format parsing would otherwise cost more than the GPIO access itself.
+ * These formatters produce output byte-identical to the "%0<n>lx" and
+ * print_binary() formats they replace. Output is accumulated in a block
+ * which is handed to puts_binary() only when full or explicitly flushed.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+#include "uart.h"
+#include "pld_fmt.h"
+
+char pld_fmt_block[PLD_FMT_BLOCK_SIZE];
+uint pld_fmt_block_len;
+
+static const char pld_fmt_hex_digits[16] = "0123456789abcdef";
+
+/* ASCII binary digits for each byte value, built at init in RAM */
+static char pld_fmt_bin_digits[256][8];
+
+/*
+ * pld_fmt_init
+ * ------------
+ * Builds the byte to binary digits conversion table.
+ */
+void
+pld_fmt_init(void)
+{
+    uint value;
+    uint bit;
+
+    for (value = 0; value < 256; value++)
+        for (bit = 0; bit < 8; bit++)
+            pld_fmt_bin_digits[value][bit] = '0' + ((value >> (7 - bit)) & 1);
+}
+
+/*
+ * pld_fmt_hex
+ * -----------
+ * Writes value to buf in lowercase hex, zero-padded to at least the
+ * specified number of digits, as sprintf("%0<digits>lx") would. The
+ * string is not NIL-terminated. Returns the number of characters written.
+ */
+uint
+pld_fmt_hex(char *buf, uint32_t value, uint digits)
+{
+    uint len = digits;
+    uint pos;
+
+    while ((len < 8) && ((value >> (4 * len)) != 0))
+        len++;
+    for (pos = len; pos > 0; value >>= 4)
+        buf[--pos] = pld_fmt_hex_digits[value & 0xf];
+    return (len);
+}
+
+/*
+ * pld_fmt_binary
+ * --------------
+ * Writes the low 28 bits of value to buf in the colon-separated binary
+ * form of print_binary(): "xxxx:xxxxxxxx:xxxxxxxx:xxxxxxxx". The string
+ * is not NIL-terminated. Returns the number of characters written (31).
+ */
+uint
+pld_fmt_binary(char *buf, uint32_t value)
+{
+    memcpy(buf, &pld_fmt_bin_digits[(value >> 24) & 0x0f][4], 4);
+    buf[4] = ':';
+    memcpy(buf + 5, pld_fmt_bin_digits[(value >> 16) & 0xff], 8);
+    buf[13] = ':';
+    memcpy(buf + 14, pld_fmt_bin_digits[(value >> 8) & 0xff], 8);
+    buf[22] = ':';
+    memcpy(buf + 23, pld_fmt_bin_digits[value & 0xff], 8);
+    return (31);
+}
+
+/*
+ * pld_fmt_flush
+ * -------------
+ * Sends any accumulated output block content to the console.
+ */
+void
+pld_fmt_flush(void)
+{
+    if (pld_fmt_block_len != 0) {
+        puts_binary(pld_fmt_block, pld_fmt_block_len);
+        pld_fmt_block_len = 0;
+    }
+}
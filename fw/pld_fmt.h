@@ -0,0 +1,52 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Fixed-format value formatting for high-rate walk output.
+ */
+
+#ifndef _PLD_FMT_H
+#define _PLD_FMT_H
+
+#define PLD_FMT_BLOCK_SIZE 512  // Output accumulated before puts_binary()
+#define PLD_FMT_LINE_MAX   96   // Largest single reservation
+
+extern char pld_fmt_block[PLD_FMT_BLOCK_SIZE];
+extern uint pld_fmt_block_len;
+
+void pld_fmt_init(void);
+uint pld_fmt_hex(char *buf, uint32_t value, uint digits);
+uint pld_fmt_binary(char *buf, uint32_t value);
+void pld_fmt_flush(void);
+
+/*
+ * pld_fmt_reserve
+ * ---------------
+ * Returns a pointer to at least len bytes of space in the output block,
+ * first flushing the block if it does not have room.
+ */
+static inline char *
+pld_fmt_reserve(uint len)
+{
+    if (pld_fmt_block_len + len > PLD_FMT_BLOCK_SIZE)
+        pld_fmt_flush();
+    return (pld_fmt_block + pld_fmt_block_len);
+}
+
+/*
+ * pld_fmt_commit
+ * --------------
+ * Adds len bytes, previously written at the reserved position, to the
+ * output block.
+ */
+static inline void
+pld_fmt_commit(uint len)
+{
+    pld_fmt_block_len += len;
+}
+
+#endif /* _PLD_FMT_H */
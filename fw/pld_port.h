@@ -0,0 +1,41 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * PLD GPIO port access.
+ *
+ * All register access to the PLD_* and PLDD_* GPIO ports by the pld
+ * engine goes through these macros. On the target they resolve to the
+ * STM32 GPIO registers. In the host simulator build (HOST_SIM), they
+ * call the simulated PLD socket instead; see host/sim.c. The simulator
+ * also stands in for the timer-paced DMA sampling of "pld watch".
+ */
+
+#ifndef _PLD_PORT_H
+#define _PLD_PORT_H
+
+#ifdef HOST_SIM
+uint32_t sim_port_idr(uint32_t port);
+uint32_t sim_port_odr(uint32_t port);
+void     sim_port_odr_write(uint32_t port, uint32_t value);
+void     sim_port_bsrr_write(uint32_t port, uint32_t value);
+void     sim_port_sample_start(uint32_t period);
+uint32_t sim_port_sample_pos(uint16_t *buf_lo, uint16_t *buf_hi,
+                             uint32_t samples);
+
+#define pld_port_in(port)              sim_port_idr(port)
+#define pld_port_out_value(port)       sim_port_odr(port)
+#define pld_port_out(port, value)      sim_port_odr_write(port, value)
+#define pld_port_set_reset(port, bits) sim_port_bsrr_write(port, bits)
+#else
+#define pld_port_in(port)              GPIO_IDR(port)
+#define pld_port_out_value(port)       GPIO_ODR(port)
+#define pld_port_out(port, value)      (GPIO_ODR(port) = (value))
+#define pld_port_set_reset(port, bits) (GPIO_BSRR(port) = (bits))
+#endif
+
+#endif /* _PLD_PORT_H */
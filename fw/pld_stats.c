@@ -0,0 +1,191 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * PLD speed measurement statistics and speed grade classification.
+ *
+ * This code has no hardware dependencies, so it may also be compiled
+ * on a host and fed synthetic samples.
+ */
+
+#ifdef EMBEDDED_CMD
+#include "printf.h"
+#else
+#include <stdio.h>
+#endif
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+#include "utils.h"
+#include "pld_stats.h"
+
+/*
+ * Empirical loop periods measured by "pld measure" with the clock loop
+ * programmed by pld/SPEED22V10.jed. The loop passes through ten gates
+ * of the part plus pin I/O, so these are not datasheet tpd values.
+ */
+static const pld_speed_ref_t pld_speed_refs[] = {
+    { "GAL22V10D-5LJ",   455 },
+    { "GAL22V10C-6LJ",   780 },
+    { "GAL22V10B-10LJ", 1080 },
+    { "ATF22V10C-10JC", 1123 },
+    { "GAL22V10B-15LJ", 1143 },
+    { "GAL22V10B-7LJ",  1183 },
+    { "GAL22V10C-25LJ", 1345 },
+    { "GAL22V10B-15LJ", 1663 },
+};
+
+/*
+ * Speed grade bands, bounded at the midpoints between distinct clusters
+ * of the reference measurements above. The -7 through -25 parts overlap
+ * too much to be separated by this measurement alone, so everything
+ * slower than the -6 cluster is a single band.
+ */
+static const struct {
+    uint16_t    max_ns_x10;
+    const char *grade;
+} pld_speed_grades[] = {
+    {  617, "-5" },
+    {  930, "-6" },
+    { 0xffff, "-7 or slower" },
+};
+
+/*
+ * isqrt64
+ * -------
+ * Integer square root.
+ */
+static uint32_t
+isqrt64(uint64_t value)
+{
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t) 1 << 62;
+
+    while (bit > value)
+        bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return ((uint32_t) result);
+}
+
+/*
+ * pld_stats_compute
+ * -----------------
+ * Compute count, min, max, mean, standard deviation, and a histogram
+ * spanning min to max for the specified samples.
+ */
+void
+pld_stats_compute(const uint16_t *samples, uint count, pld_stats_t *stats)
+{
+    uint     cur;
+    uint     bin;
+    uint64_t sum = 0;
+    uint64_t sumsq = 0;
+    uint64_t mean_sq_x65536;
+    uint64_t sumsq_x65536;
+
+    memset(stats, 0, sizeof (*stats));
+    stats->ps_count = count;
+    if (count == 0)
+        return;
+
+    stats->ps_min = 0xffffffff;
+    for (cur = 0; cur < count; cur++) {
+        uint32_t value = samples[cur];
+        sum   += value;
+        sumsq += (uint64_t) value * value;
+        if (stats->ps_min > value)
+            stats->ps_min = value;
+        if (stats->ps_max < value)
+            stats->ps_max = value;
+    }
+    stats->ps_mean_x256 = sum * 256 / count;
+
+    mean_sq_x65536 = (uint64_t) stats->ps_mean_x256 * stats->ps_mean_x256;
+    sumsq_x65536   = sumsq * 65536 / count;
+    if (sumsq_x65536 > mean_sq_x65536)
+        stats->ps_stddev_x256 = isqrt64(sumsq_x65536 - mean_sq_x65536);
+
+    stats->ps_hist_base  = stats->ps_min;
+    stats->ps_hist_width = (stats->ps_max - stats->ps_min) /
+                           PLD_STATS_HIST_BINS + 1;
+    for (cur = 0; cur < count; cur++) {
+        bin = (samples[cur] - stats->ps_hist_base) / stats->ps_hist_width;
+        stats->ps_hist[bin]++;
+    }
+}
+
+/*
+ * pld_stats_show_histogram
+ * ------------------------
+ * Display the histogram of a sample set, converting sample units to
+ * picoseconds using the specified scale.
+ */
+void
+pld_stats_show_histogram(const pld_stats_t *stats, uint ps_per_unit)
+{
+    uint bin;
+    uint peak = 0;
+    uint width;
+
+    for (bin = 0; bin < PLD_STATS_HIST_BINS; bin++)
+        if (peak < stats->ps_hist[bin])
+            peak = stats->ps_hist[bin];
+    if (peak == 0)
+        return;
+
+    for (bin = 0; bin < PLD_STATS_HIST_BINS; bin++) {
+        uint ps = (stats->ps_hist_base + bin * stats->ps_hist_width) *
+                  ps_per_unit;
+        if (ps > stats->ps_max * ps_per_unit)
+            break;
+        printf("   %4u.%u ns %6u ", ps / 1000, (ps % 1000) / 100,
+               (uint) stats->ps_hist[bin]);
+        for (width = stats->ps_hist[bin] * 40 / peak; width > 0; width--)
+            printf("*");
+        printf("\n");
+    }
+}
+
+/*
+ * pld_speed_classify
+ * ------------------
+ * Return the speed grade band for the specified loop period, and
+ * optionally the closest reference part measurement.
+ */
+const char *
+pld_speed_classify(uint loop_ps, const pld_speed_ref_t **ref)
+{
+    uint ns_x10 = loop_ps / 100;
+    uint cur;
+    uint best = 0;
+    uint best_diff = 0xffffffff;
+
+    for (cur = 0; cur < ARRAY_SIZE(pld_speed_refs); cur++) {
+        uint diff = (ns_x10 > pld_speed_refs[cur].psr_loop_ns_x10) ?
+                    ns_x10 - pld_speed_refs[cur].psr_loop_ns_x10 :
+                    pld_speed_refs[cur].psr_loop_ns_x10 - ns_x10;
+        if (best_diff > diff) {
+            best_diff = diff;
+            best = cur;
+        }
+    }
+    if (ref != NULL)
+        *ref = &pld_speed_refs[best];
+
+    for (cur = 0; cur < ARRAY_SIZE(pld_speed_grades) - 1; cur++)
+        if (ns_x10 <= pld_speed_grades[cur].max_ns_x10)
+            break;
+    return (pld_speed_grades[cur].grade);
+}
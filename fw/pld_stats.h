@@ -0,0 +1,38 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * PLD speed measurement statistics and speed grade classification.
+ */
+
+#ifndef _PLD_STATS_H
+#define _PLD_STATS_H
+
+#define PLD_STATS_HIST_BINS 16
+
+typedef struct {
+    uint32_t ps_count;          // Number of samples
+    uint32_t ps_min;            // Smallest sample
+    uint32_t ps_max;            // Largest sample
+    uint32_t ps_mean_x256;      // Mean, scaled by 256
+    uint32_t ps_stddev_x256;    // Standard deviation, scaled by 256
+    uint32_t ps_hist_base;      // Value at start of first histogram bin
+    uint32_t ps_hist_width;     // Width of each histogram bin
+    uint32_t ps_hist[PLD_STATS_HIST_BINS];  // Sample counts per bin
+} pld_stats_t;
+
+typedef struct {
+    const char *psr_part;       // Reference part name
+    uint16_t    psr_loop_ns_x10;  // Measured loop period, ns * 10
+} pld_speed_ref_t;
+
+void pld_stats_compute(const uint16_t *samples, uint count,
+                       pld_stats_t *stats);
+void pld_stats_show_histogram(const pld_stats_t *stats, uint ps_per_unit);
+const char *pld_speed_classify(uint loop_ps, const pld_speed_ref_t **ref);
+
+#endif /* _PLD_STATS_H */
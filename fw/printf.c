@@ -55,6 +55,18 @@
 #define UINTMAX_T     uint64_t // Unsigned largest integer
 #define PTRDIFF_T     int32_t  // Signed difference between two pointers
 
+/*
+ * Firmware passes uint32_t (which is long on the target) for %l. The
+ * host simulator build has 64-bit long, so fetch %l arguments as 32-bit.
+ */
+#ifdef HOST_SIM
+#define LONG_T        int32_t
+#define ULONG_T       uint32_t
+#else
+#define LONG_T        long
+#define ULONG_T       unsigned long
+#endif
+
 /* Output formatting flags */
 #define FMT_LONG       0x0001   // Value is a 32-bit long integer
 #define FMT_LLONG      0x0002   // Value is a 64-bit long long integer
@@ -73,8 +85,11 @@ uint32_t debug_flags = 0;
 typedef struct {
     char *buf_cur;
     char *buf_end;
+    char *buf_start;    // Console output: chunk start, else NULL
 } buf_t;
 
+#define CONSOLE_CHUNK 64  // printf() output is sent to console in chunks
+
 /**
  * put() sends the specified character either to a buffer to the console.
  *
@@ -101,6 +116,11 @@ put(int ch, buf_t *desc)
         putchar((uint) ch);
     } else if (desc->buf_cur < desc->buf_end) {
         *(desc->buf_cur)++ = (char) ch;
+    } else if (desc->buf_start != NULL) {
+        /* Console chunk is full */
+        console_write(desc->buf_start, desc->buf_cur - desc->buf_start);
+        desc->buf_cur = desc->buf_start;
+        *(desc->buf_cur)++ = (char) ch;
     }
 }
 
@@ -372,7 +392,7 @@ reswitch:
                 break;
             case 'd':
                 ul = (flags & FMT_LLONG) ? va_arg(ap, int64_t) :
-                     (flags & FMT_LONG)  ? va_arg(ap, long)    :
+                     (flags & FMT_LONG)  ? va_arg(ap, LONG_T)  :
                                            va_arg(ap, int);
                 if ((INTMAX_T)ul < 0) {
                     ul = (UINTMAX_T) -(INTMAX_T)ul;
@@ -383,13 +403,13 @@ reswitch:
                 break;
             case 'o':
                 ul = (flags & FMT_LLONG) ? va_arg(ap, uint64_t)      :
-                     (flags & FMT_LONG)  ? va_arg(ap, unsigned long) :
+                     (flags & FMT_LONG)  ? va_arg(ap, ULONG_T)       :
                                            va_arg(ap, unsigned int);
                 ret += kprintn(desc, ul, 8, flags, width, 0);
                 break;
             case 'u':
                 ul = (flags & FMT_LLONG) ? va_arg(ap, uint64_t)      :
-                     (flags & FMT_LONG)  ? va_arg(ap, unsigned long) :
+                     (flags & FMT_LONG)  ? va_arg(ap, ULONG_T)       :
                                            va_arg(ap, unsigned int);
                 ret += kprintn(desc, ul, 10, flags, width,
                                flags & FMT_DOT ? mwidth : 0);
@@ -403,7 +423,7 @@ reswitch:
             case 'x':
 do_hex:
                 ul = (flags & FMT_LLONG) ? va_arg(ap, uint64_t)      :
-                     (flags & FMT_LONG)  ? va_arg(ap, unsigned long) :
+                     (flags & FMT_LONG)  ? va_arg(ap, ULONG_T)       :
                                            va_arg(ap, unsigned int);
                 ret += kprintn(desc, ul, 16, flags, width, 0);
                 break;
@@ -440,6 +460,7 @@ int vsnprintf(char *buf, size_t size, const char *fmt, va_list ap)
     buf_t desc;
     desc.buf_cur = buf;
     desc.buf_end = (buf != NULL) ? buf + size - 1 : buf;
+    desc.buf_start = NULL;
 
     ret = kdoprnt(&desc, fmt, ap);
     if (buf != NULL)
@@ -522,7 +543,16 @@ int sprintf(char *buf, const char *fmt, ...)
 __attribute__((format(__printf__, 1, 0)))
 int vprintf(const char *fmt, va_list ap)
 {
-    return (kdoprnt(NULL, fmt, ap));
+    int   rc;
+    char  buf[CONSOLE_CHUNK];
+    buf_t desc;
+
+    desc.buf_cur = buf;
+    desc.buf_end = buf + sizeof (buf);
+    desc.buf_start = buf;
+    rc = kdoprnt(&desc, fmt, ap);
+    console_write(buf, desc.buf_cur - buf);
+    return (rc);
 }
 
 /**
@@ -0,0 +1,575 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * On-board store of known PLD design signatures.
+ *
+ * A "pld walk digest" folds every vector read from the part into a 32-bit
+ * signature. Signatures saved with "pld sig save" are kept in a log at the
+ * end of internal flash, so that a re-inserted part can be identified by
+ * a quick digest walk rather than by a full capture and host analysis.
+ *
+ * The log occupies SIGSTORE_PAGES flash pages used round-robin. Slot 0 of
+ * each page is a header holding a sequence number and the erase count of
+ * the page; the remaining slots hold fixed size records, appended in
+ * order. Records are only ever written once, except that forgetting a
+ * record programs its sr_live field to zero, which flash permits without
+ * an erase. When the active page fills, the next page is erased and
+ * becomes active, and the live records of the oldest page (the one after
+ * that) are copied into it. The oldest page is then marked obsolete, so
+ * one page is always free, and each page is erased once per pass of the
+ * log, which spreads wear evenly.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "printf.h"
+#include "main.h"
+#include "cmdline.h"
+#include "cmds.h"
+#include "stm32flash.h"
+#include "sigstore.h"
+
+#define SIGSTORE_PAGE_MAGIC 0x31475342  // "BSG1"
+#define SIGSTORE_REC_MAGIC  0x5347      // "SG"
+#define SIGSTORE_SLOTS      (SIGSTORE_PAGE_SIZE / sizeof (sig_rec_t))
+#define SIGSTORE_CAPACITY   ((SIGSTORE_PAGES - 1) * (SIGSTORE_SLOTS - 1))
+
+typedef struct {
+    uint16_t sr_magic;      // SIGSTORE_REC_MAGIC once written
+    uint16_t sr_live;       // 0xffff until forgotten, then 0
+    uint32_t sr_digest;     // Walk digest
+    uint32_t sr_ignore;     // Walk ignore mask
+    uint32_t sr_check;      // Hash of the fields which follow sr_check
+    char     sr_device[SIGSTORE_DEVICE_LEN];
+    char     sr_label[SIGSTORE_LABEL_LEN];
+} sig_rec_t;
+
+typedef struct {
+    uint32_t sp_magic;      // SIGSTORE_PAGE_MAGIC, or 0 when obsolete
+    uint32_t sp_seq;        // Incremented for each page put into use
+    uint32_t sp_erases;     // Times this page has been erased
+} sig_page_t;
+
+typedef struct {
+    int      ss_active;     // Page receiving records (-1 if none)
+    uint32_t ss_seq;        // Sequence number of the active page
+    uint     ss_next_slot;  // First free slot of the active page
+    uint     ss_live;       // Live records in all pages
+} sig_scan_t;
+
+static uint     sig_last_valid;     // A digest walk has completed
+static uint32_t sig_last_digest;
+static uint32_t sig_last_ignore;
+static char     sig_last_device[SIGSTORE_DEVICE_LEN];
+
+static uint32_t
+sigstore_addr(uint page, uint slot)
+{
+    return (SIGSTORE_BASE + page * SIGSTORE_PAGE_SIZE +
+            slot * sizeof (sig_rec_t));
+}
+
+/*
+ * sigstore_check
+ * --------------
+ * Returns the check value of a record, covering the device and label.
+ */
+static uint32_t
+sigstore_check(const sig_rec_t *rec)
+{
+    const uint8_t *ptr = (const uint8_t *) rec->sr_device;
+    uint32_t       hash = SIGSTORE_HASH_INIT ^ rec->sr_digest;
+    uint           pos;
+
+    hash = (hash ^ rec->sr_ignore) * SIGSTORE_HASH_MULT;
+    for (pos = 0; pos < SIGSTORE_DEVICE_LEN + SIGSTORE_LABEL_LEN; pos++)
+        hash = (hash ^ ptr[pos]) * SIGSTORE_HASH_MULT;
+    return (hash);
+}
+
+/*
+ * sigstore_page_hdr
+ * -----------------
+ * Reads a page header, returning non-zero if the page is in use.
+ */
+static uint
+sigstore_page_hdr(uint page, sig_page_t *hdr)
+{
+    if (stm32flash_read(sigstore_addr(page, 0), sizeof (*hdr), hdr) != 0)
+        return (0);
+    return (hdr->sp_magic == SIGSTORE_PAGE_MAGIC);
+}
+
+/*
+ * sigstore_read_rec
+ * -----------------
+ * Reads a record slot, returning 1 if it holds a live record, 0 if it
+ * holds a dead or damaged record, and -1 if it has never been written.
+ */
+static int
+sigstore_read_rec(uint page, uint slot, sig_rec_t *rec)
+{
+    if (stm32flash_read(sigstore_addr(page, slot), sizeof (*rec), rec) != 0)
+        return (0);
+    if (rec->sr_magic == 0xffff)
+        return (-1);
+    return ((rec->sr_magic == SIGSTORE_REC_MAGIC) && (rec->sr_live != 0) &&
+            (rec->sr_check == sigstore_check(rec)));
+}
+
+/*
+ * sigstore_scan
+ * -------------
+ * Locates the active page and its first free slot, and counts live
+ * records.
+ */
+static void
+sigstore_scan(sig_scan_t *scan)
+{
+    sig_page_t hdr;
+    sig_rec_t  rec;
+    uint       page;
+    uint       slot;
+    int        state;
+
+    scan->ss_active = -1;
+    scan->ss_seq = 0;
+    scan->ss_next_slot = SIGSTORE_SLOTS;
+    scan->ss_live = 0;
+    for (page = 0; page < SIGSTORE_PAGES; page++) {
+        if (sigstore_page_hdr(page, &hdr) == 0)
+            continue;
+        if ((scan->ss_active < 0) ||
+            ((int32_t) (hdr.sp_seq - scan->ss_seq) > 0)) {
+            scan->ss_active = page;
+            scan->ss_seq = hdr.sp_seq;
+        }
+        for (slot = 1; slot < SIGSTORE_SLOTS; slot++) {
+            state = sigstore_read_rec(page, slot, &rec);
+            if (state < 0)
+                break;
+            scan->ss_live += state;
+        }
+    }
+    if (scan->ss_active < 0)
+        return;
+    for (slot = 1; slot < SIGSTORE_SLOTS; slot++)
+        if (sigstore_read_rec(scan->ss_active, slot, &rec) < 0)
+            break;
+    scan->ss_next_slot = slot;
+}
+
+/*
+ * sigstore_write_rec
+ * ------------------
+ * Writes a record to a free slot, verifying it. A slot which fails to
+ * program is marked dead so that it will be skipped.
+ */
+static rc_t
+sigstore_write_rec(uint page, uint slot, const sig_rec_t *rec)
+{
+    uint32_t  addr = sigstore_addr(page, slot);
+    sig_rec_t check;
+    uint16_t  zero = 0;
+
+    if ((stm32flash_write(addr, sizeof (*rec), (void *) rec, 0) == 0) &&
+        (stm32flash_read(addr, sizeof (check), &check) == 0) &&
+        (memcmp(&check, rec, sizeof (check)) == 0)) {
+        return (RC_SUCCESS);
+    }
+    (void) stm32flash_write(addr, sizeof (zero), &zero, 0);
+    return (RC_FAILURE);
+}
+
+/*
+ * sigstore_in_page
+ * ----------------
+ * Returns non-zero if a page holds a live copy of the record.
+ */
+static uint
+sigstore_in_page(uint page, const sig_rec_t *rec)
+{
+    sig_rec_t cur;
+    uint      slot;
+    int       state;
+
+    for (slot = 1; slot < SIGSTORE_SLOTS; slot++) {
+        state = sigstore_read_rec(page, slot, &cur);
+        if (state < 0)
+            break;
+        if ((state > 0) && (memcmp(&cur, rec, sizeof (cur)) == 0))
+            return (1);
+    }
+    return (0);
+}
+
+/*
+ * sigstore_migrate
+ * ----------------
+ * Copies the live records of the oldest page into the active page, then
+ * marks the oldest page obsolete. Records already copied by a previous,
+ * interrupted migration are skipped.
+ */
+static rc_t
+sigstore_migrate(sig_scan_t *scan, uint victim)
+{
+    sig_rec_t rec;
+    uint32_t  zero = 0;
+    uint      slot;
+    int       state;
+
+    for (slot = 1; slot < SIGSTORE_SLOTS; slot++) {
+        state = sigstore_read_rec(victim, slot, &rec);
+        if (state < 0)
+            break;
+        if ((state == 0) || sigstore_in_page(scan->ss_active, &rec))
+            continue;
+        do {
+            if (scan->ss_next_slot >= SIGSTORE_SLOTS) {
+                printf("Signature store page %u overflow\n", victim);
+                return (RC_FAILURE);
+            }
+        } while (sigstore_write_rec(scan->ss_active, scan->ss_next_slot++,
+                                    &rec) != RC_SUCCESS);
+    }
+    if (stm32flash_write(sigstore_addr(victim, 0), sizeof (zero), &zero, 0))
+        return (RC_FAILURE);
+    return (RC_SUCCESS);
+}
+
+/*
+ * sigstore_blank
+ * --------------
+ * Returns non-zero if a flash page is fully erased.
+ */
+static uint
+sigstore_blank(uint page)
+{
+    uint32_t buf[16];
+    uint     pos;
+    uint     word;
+
+    for (pos = 0; pos < SIGSTORE_PAGE_SIZE; pos += sizeof (buf)) {
+        if (stm32flash_read(sigstore_addr(page, 0) + pos, sizeof (buf), buf))
+            return (0);
+        for (word = 0; word < ARRAY_SIZE(buf); word++)
+            if (buf[word] != 0xffffffff)
+                return (0);
+    }
+    return (1);
+}
+
+/*
+ * sigstore_rotate
+ * ---------------
+ * Erases the next page and makes it active, then migrates the live
+ * records of the oldest page into it.
+ */
+static rc_t
+sigstore_rotate(sig_scan_t *scan)
+{
+    sig_page_t hdr;
+    uint       page;
+    uint       victim;
+
+    page = (scan->ss_active < 0) ? 0 : (scan->ss_active + 1) % SIGSTORE_PAGES;
+    victim = (page + 1) % SIGSTORE_PAGES;
+
+    if (stm32flash_read(sigstore_addr(page, 0), sizeof (hdr), &hdr) != 0)
+        return (RC_FAILURE);
+    if (hdr.sp_erases == 0xffffffff)
+        hdr.sp_erases = 0;  // Never used
+    if (sigstore_blank(page) == 0) {
+        if (stm32flash_erase(sigstore_addr(page, 0), SIGSTORE_PAGE_SIZE) != 0)
+            return (RC_FAILURE);
+        hdr.sp_erases++;
+    }
+    hdr.sp_magic = SIGSTORE_PAGE_MAGIC;
+    hdr.sp_seq = scan->ss_seq + 1;
+    if (stm32flash_write(sigstore_addr(page, 0), sizeof (hdr), &hdr, 0) != 0) {
+        printf("Signature store page %u write failed\n", page);
+        return (RC_FAILURE);
+    }
+    scan->ss_active = page;
+    scan->ss_seq = hdr.sp_seq;
+    scan->ss_next_slot = 1;
+
+    if ((victim != page) && sigstore_page_hdr(victim, &hdr))
+        return (sigstore_migrate(scan, victim));
+    return (RC_SUCCESS);
+}
+
+/*
+ * sigstore_append
+ * ---------------
+ * Adds a record to the log, returning the flash address of its slot.
+ */
+static rc_t
+sigstore_append(sig_rec_t *rec, uint32_t *addr)
+{
+    sig_scan_t scan;
+    sig_page_t hdr;
+    uint       victim;
+    uint       rotations = 0;
+    rc_t       rc;
+
+    rec->sr_magic = SIGSTORE_REC_MAGIC;
+    rec->sr_live = 0xffff;
+    rec->sr_check = sigstore_check(rec);
+
+    sigstore_scan(&scan);
+    if (scan.ss_live >= SIGSTORE_CAPACITY) {
+        printf("Signature store is full (%u records)\n", scan.ss_live);
+        return (RC_FAILURE);
+    }
+    if (scan.ss_active >= 0) {
+        /* Complete a migration which was interrupted by power loss */
+        victim = (scan.ss_active + 1) % SIGSTORE_PAGES;
+        if (sigstore_page_hdr(victim, &hdr) &&
+            (sigstore_migrate(&scan, victim) != RC_SUCCESS)) {
+            return (RC_FAILURE);
+        }
+    }
+
+    while (1) {
+        if (scan.ss_next_slot >= SIGSTORE_SLOTS) {
+            if (rotations++ >= SIGSTORE_PAGES)
+                return (RC_FAILURE);
+            rc = sigstore_rotate(&scan);
+            if (rc != RC_SUCCESS)
+                return (rc);
+            continue;
+        }
+        *addr = sigstore_addr(scan.ss_active, scan.ss_next_slot);
+        if (sigstore_write_rec(scan.ss_active, scan.ss_next_slot++, rec) ==
+            RC_SUCCESS) {
+            return (RC_SUCCESS);
+        }
+    }
+}
+
+/*
+ * sigstore_forget
+ * ---------------
+ * Marks dead all live records matching either the label (if not NULL)
+ * or the digest and ignore mask, except the record at keep_addr (if not
+ * zero). Returns the number of records marked.
+ */
+static uint
+sigstore_forget(const char *label, uint32_t digest, uint32_t ignore,
+                uint32_t keep_addr)
+{
+    sig_page_t hdr;
+    sig_rec_t  rec;
+    uint16_t   zero = 0;
+    uint       page;
+    uint       slot;
+    uint       count = 0;
+    int        state;
+
+    for (page = 0; page < SIGSTORE_PAGES; page++) {
+        if (sigstore_page_hdr(page, &hdr) == 0)
+            continue;
+        for (slot = 1; slot < SIGSTORE_SLOTS; slot++) {
+            state = sigstore_read_rec(page, slot, &rec);
+            if (state < 0)
+                break;
+            if ((state == 0) || (sigstore_addr(page, slot) == keep_addr))
+                continue;
+            if ((label != NULL) ?
+                (strncmp(rec.sr_label, label, SIGSTORE_LABEL_LEN) != 0) :
+                ((rec.sr_digest != digest) || (rec.sr_ignore != ignore))) {
+                continue;
+            }
+            (void) stm32flash_write(sigstore_addr(page, slot) + 2,
+                                    sizeof (zero), &zero, 0);
+            count++;
+        }
+    }
+    return (count);
+}
+
+/*
+ * sigstore_show
+ * -------------
+ * Displays all live records, or only those matching the digest and
+ * ignore mask if match is set. Returns the number of records displayed.
+ */
+static uint
+sigstore_show(uint match, uint32_t digest, uint32_t ignore)
+{
+    sig_page_t hdr;
+    sig_rec_t  rec;
+    uint       page;
+    uint       slot;
+    uint       count = 0;
+    int        state;
+
+    for (page = 0; page < SIGSTORE_PAGES; page++) {
+        if (sigstore_page_hdr(page, &hdr) == 0)
+            continue;
+        for (slot = 1; slot < SIGSTORE_SLOTS; slot++) {
+            state = sigstore_read_rec(page, slot, &rec);
+            if (state < 0)
+                break;
+            if ((state == 0) ||
+                (match && ((rec.sr_digest != digest) ||
+                           (rec.sr_ignore != ignore)))) {
+                continue;
+            }
+            if (count++ == 0)
+                printf("Digest   Ignore   Device   Label\n");
+            printf("%08x %08x %-8.8s %.*s\n", rec.sr_digest, rec.sr_ignore,
+                   rec.sr_device, SIGSTORE_LABEL_LEN, rec.sr_label);
+        }
+    }
+    return (count);
+}
+
+/*
+ * sigstore_stats
+ * --------------
+ * Displays the state and wear of each page of the store.
+ */
+static void
+sigstore_stats(void)
+{
+    sig_scan_t scan;
+    sig_page_t hdr;
+    sig_rec_t  rec;
+    uint       page;
+    uint       slot;
+    uint       live;
+    int        state;
+
+    sigstore_scan(&scan);
+    printf("Page Offset     Seq  Erases Used Live\n");
+    for (page = 0; page < SIGSTORE_PAGES; page++) {
+        uint in_use = sigstore_page_hdr(page, &hdr);
+        live = 0;
+        for (slot = 1; in_use && (slot < SIGSTORE_SLOTS); slot++) {
+            state = sigstore_read_rec(page, slot, &rec);
+            if (state < 0)
+                break;
+            live += state;
+        }
+        printf("%4u %05x ", page, sigstore_addr(page, 0));
+        if (hdr.sp_erases == 0xffffffff)
+            hdr.sp_erases = 0;
+        if (in_use) {
+            printf("%7u %7u %4u %4u%s\n", hdr.sp_seq, hdr.sp_erases,
+                   slot - 1, live,
+                   ((int) page == scan.ss_active) ? " active" : "");
+        } else {
+            printf("%7s %7u %4s %4s %s\n", "-", hdr.sp_erases, "-", "-",
+                   (hdr.sp_magic == 0) ? "obsolete" : "free");
+        }
+    }
+    printf("%u of %u records live\n", scan.ss_live, SIGSTORE_CAPACITY);
+}
+
+/*
+ * sigstore_note_walk
+ * ------------------
+ * Records the result of a digest walk for "pld sig save", and reports
+ * any stored signatures which it matches.
+ */
+void
+sigstore_note_walk(uint32_t digest, uint32_t ignore_mask, const char *device)
+{
+    sig_last_valid = 1;
+    sig_last_digest = digest;
+    sig_last_ignore = ignore_mask;
+    strncpy(sig_last_device, device, sizeof (sig_last_device) - 1);
+
+    if (sigstore_show(1, digest, ignore_mask) == 0)
+        printf("No stored signature matches\n");
+}
+
+const char cmd_pld_sig_help[] =
+"pld sig erase                  - erase all stored signatures\n"
+"pld sig forget <label>         - remove signatures with label\n"
+"pld sig list                   - show stored signatures\n"
+"pld sig save <label> [<digest> <ignore>] - store last digest walk\n"
+"pld sig stats                  - show store page use and wear\n";
+
+/*
+ * cmd_pld_sig
+ * -----------
+ * Implements the "pld sig" command. The argument vector starts at "sig".
+ */
+rc_t
+cmd_pld_sig(int argc, char * const *argv)
+{
+    sig_rec_t rec;
+    uint32_t  addr;
+    uint      count;
+    rc_t      rc;
+
+    if ((argc < 2) || (strcmp(argv[1], "list") == 0)) {
+        if (sigstore_show(0, 0, 0) == 0)
+            printf("No signatures stored\n");
+        return (RC_SUCCESS);
+    }
+    if (strcmp(argv[1], "stats") == 0) {
+        sigstore_stats();
+        return (RC_SUCCESS);
+    }
+    if (strcmp(argv[1], "erase") == 0) {
+        if (stm32flash_erase(SIGSTORE_BASE,
+                             SIGSTORE_PAGES * SIGSTORE_PAGE_SIZE) != 0)
+            return (RC_FAILURE);
+        sig_last_valid = 0;
+        return (RC_SUCCESS);
+    }
+    if ((strcmp(argv[1], "forget") == 0) && (argc == 3)) {
+        count = sigstore_forget(argv[2], 0, 0, 0);
+        printf("Forgot %u record%s\n", count, (count == 1) ? "" : "s");
+        return ((count == 0) ? RC_FAILURE : RC_SUCCESS);
+    }
+    if ((strcmp(argv[1], "save") == 0) && ((argc == 3) || (argc == 5))) {
+        memset(&rec, 0, sizeof (rec));
+        if (strlen(argv[2]) >= SIGSTORE_LABEL_LEN) {
+            printf("Label may be at most %u characters\n",
+                   SIGSTORE_LABEL_LEN - 1);
+            return (RC_BAD_PARAM);
+        }
+        if (argc == 5) {
+            if ((parse_uint(argv[3], (uint *) &rec.sr_digest) !=
+                 RC_SUCCESS) ||
+                (parse_uint(argv[4], (uint *) &rec.sr_ignore) !=
+                 RC_SUCCESS)) {
+                return (RC_BAD_PARAM);
+            }
+            strcpy(rec.sr_device, "manual");
+        } else if (sig_last_valid) {
+            rec.sr_digest = sig_last_digest;
+            rec.sr_ignore = sig_last_ignore;
+            memcpy(rec.sr_device, sig_last_device, sizeof (rec.sr_device));
+        } else {
+            printf("No digest walk to save; use \"pld walk <pins> digest\"\n");
+            return (RC_FAILURE);
+        }
+        strncpy(rec.sr_label, argv[2], sizeof (rec.sr_label) - 1);
+
+        rc = sigstore_append(&rec, &addr);
+        if (rc != RC_SUCCESS) {
+            printf("Failed to save signature\n");
+            return (rc);
+        }
+
+        /*
+         * A design re-saved under a new label replaces the old record,
+         * which is only forgotten once the new one is safely written.
+         */
+        (void) sigstore_forget(NULL, rec.sr_digest, rec.sr_ignore, addr);
+        return (RC_SUCCESS);
+    }
+    printf("%s", cmd_pld_sig_help);
+    return (RC_FAILURE);
+}
@@ -0,0 +1,28 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * On-board store of known PLD design signatures in internal flash.
+ */
+
+#ifndef _SIGSTORE_H
+#define _SIGSTORE_H
+
+#define SIGSTORE_BASE       0x3e000  // Flash offset: last 8 KB of 256 KB
+#define SIGSTORE_PAGES      4        // Flash pages used round-robin
+#define SIGSTORE_PAGE_SIZE  2048
+#define SIGSTORE_DEVICE_LEN 8
+#define SIGSTORE_LABEL_LEN  24
+
+#define SIGSTORE_HASH_INIT  0x811c9dc5  // FNV-1a offset basis
+#define SIGSTORE_HASH_MULT  0x01000193  // FNV-1a prime
+
+void sigstore_note_walk(uint32_t digest, uint32_t ignore_mask,
+                        const char *device);
+rc_t cmd_pld_sig(int argc, char * const *argv);
+
+#endif /* _SIGSTORE_H */
@@ -0,0 +1,126 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Transmit ring buffer with contiguous-chunk drain for DMA.
+ *
+ * There is a single producer (the console writer) and a single consumer
+ * (the transmit interrupt or DMA completion). The consumer takes the
+ * data in contiguous chunks of at most tr_chunk_max bytes: it peeks a
+ * chunk, sends it, and only then consumes it. With tr_chunk_max set to
+ * half the ring, one half is being sent by DMA while the producer fills
+ * the other, so the ring behaves as a double buffer.
+ *
+ * This code has no hardware dependencies, so it is also compiled on a
+ * host by the simulator build.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+#include "utils.h"
+#include "tx_ring.h"
+
+/*
+ * tx_ring_init
+ * ------------
+ * Initializes an empty ring using the specified storage. One byte of
+ * storage is reserved to distinguish a full ring from an empty ring.
+ */
+void
+tx_ring_init(tx_ring_t *ring, uint8_t *buf, uint size, uint chunk_max)
+{
+    ring->tr_buf       = buf;
+    ring->tr_size      = size;
+    ring->tr_chunk_max = chunk_max;
+    ring->tr_producer  = 0;
+    ring->tr_consumer  = 0;
+}
+
+/*
+ * tx_ring_used
+ * ------------
+ * Returns the number of bytes waiting to be sent (including any chunk
+ * currently being sent).
+ */
+uint
+tx_ring_used(const tx_ring_t *ring)
+{
+    return ((ring->tr_producer + ring->tr_size - ring->tr_consumer) %
+            ring->tr_size);
+}
+
+/*
+ * tx_ring_space
+ * -------------
+ * Returns the number of bytes which may be added to the ring.
+ */
+uint
+tx_ring_space(const tx_ring_t *ring)
+{
+    return (ring->tr_size - 1 - tx_ring_used(ring));
+}
+
+/*
+ * tx_ring_put
+ * -----------
+ * Adds up to len bytes to the ring. Returns the number of bytes added,
+ * which is less than len if the ring became full.
+ */
+uint
+tx_ring_put(tx_ring_t *ring, const void *buf, uint len)
+{
+    const uint8_t *ptr  = buf;
+    uint           prod = ring->tr_producer;
+    uint           total;
+    uint           count;
+
+    total = MIN(len, tx_ring_space(ring));
+    len = total;
+    while (len > 0) {
+        count = MIN(len, ring->tr_size - prod);
+        memcpy(ring->tr_buf + prod, ptr, count);
+        prod = (prod + count) % ring->tr_size;
+        ptr += count;
+        len -= count;
+    }
+    ring->tr_producer = prod;
+    return (total);
+}
+
+/*
+ * tx_ring_peek
+ * ------------
+ * Returns the length and position of the next contiguous chunk of data
+ * to be sent, without removing it from the ring. Returns 0 if the ring
+ * is empty.
+ */
+uint
+tx_ring_peek(const tx_ring_t *ring, const uint8_t **ptr)
+{
+    uint prod = ring->tr_producer;
+    uint cons = ring->tr_consumer;
+    uint len;
+
+    if (prod >= cons)
+        len = prod - cons;
+    else
+        len = ring->tr_size - cons;  // Up to the end of storage
+    *ptr = ring->tr_buf + cons;
+    return (MIN(len, ring->tr_chunk_max));
+}
+
+/*
+ * tx_ring_consume
+ * ---------------
+ * Removes len bytes, previously returned by tx_ring_peek(), from the ring.
+ */
+void
+tx_ring_consume(tx_ring_t *ring, uint len)
+{
+    ring->tr_consumer = (ring->tr_consumer + len) % ring->tr_size;
+}
@@ -0,0 +1,30 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Transmit ring buffer with contiguous-chunk drain for DMA.
+ */
+
+#ifndef _TX_RING_H
+#define _TX_RING_H
+
+typedef struct {
+    uint8_t           *tr_buf;       // Ring storage
+    uint16_t           tr_size;      // Ring storage size in bytes
+    uint16_t           tr_chunk_max; // Largest chunk returned by peek
+    volatile uint16_t  tr_producer;  // Next position to be written
+    volatile uint16_t  tr_consumer;  // Next position to be sent
+} tx_ring_t;
+
+void tx_ring_init(tx_ring_t *ring, uint8_t *buf, uint size, uint chunk_max);
+uint tx_ring_used(const tx_ring_t *ring);
+uint tx_ring_space(const tx_ring_t *ring);
+uint tx_ring_put(tx_ring_t *ring, const void *buf, uint len);
+uint tx_ring_peek(const tx_ring_t *ring, const uint8_t **ptr);
+void tx_ring_consume(tx_ring_t *ring, uint len);
+
+#endif /* _TX_RING_H */
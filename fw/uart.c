@@ -7,6 +7,15 @@
  * ---------------------------------------------------------------------
  *
  * STM32 USART and basic input / output handling.
+ *
+ * Console output is buffered per transport. Text has CRLF expansion
+ * applied a segment at a time and is then copied to a UART output ring,
+ * which is drained in the background by DMA (or by the USART TXE
+ * interrupt where no DMA channel is configured), and to a USB output
+ * buffer, which is sent in packet-sized chunks. USB output is sent when
+ * a line ends with at least a full packet pending or with output older
+ * than USB_OUT_MAX_MSEC, when input is polled (the prompt boundary), and
+ * on explicit uart_flush().
  */
 
 #include "printf.h"
@@ -19,6 +28,7 @@
 #include "irq.h"
 #include "gpio.h"
 #include "usb.h"
+#include "utils.h"
 
 #if defined(STM32F1)
 #include <libopencm3/stm32/f1/nvic.h>
@@ -28,6 +38,8 @@
 #include <libopencm3/stm32/usart.h>
 #include <libopencm3/stm32/rcc.h>
 #include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/dma.h>
+#include "tx_ring.h"
 typedef uint32_t USART_TypeDef_P;
 
 
@@ -37,6 +49,11 @@ typedef uint32_t USART_TypeDef_P;
 #define CONSOLE_USART       USART1
 #define CONSOLE_IRQn        NVIC_USART1_IRQ
 #define CONSOLE_IRQHandler  usart1_isr
+#define CONSOLE_TX_DMA
+#define CONSOLE_DMA         DMA1
+#define CONSOLE_DMA_CHANNEL DMA_CHANNEL4  // USART1_TX request
+#define CONSOLE_DMA_IRQn    NVIC_DMA1_CHANNEL4_IRQ
+#define CONSOLE_DMA_IRQHandler dma1_channel4_isr
 #elif defined(STM32F4)
 /* STM32F407 Discovery on Rev1 uses PA10 for CONS_TX and PA11 for CONS_RX */
 #define CONSOLE_USART       USART3
@@ -44,15 +61,37 @@ typedef uint32_t USART_TypeDef_P;
 #define CONSOLE_IRQHandler  usart3_isr
 #endif
 
+#ifndef CONSOLE_BAUD
+#define CONSOLE_BAUD        115200
+#endif
+#if CONSOLE_BAUD > 4500000
+#error CONSOLE_BAUD exceeds the USART maximum of APB clock / 16
+#endif
+
 static volatile uint cons_in_rb_producer; // Console input current writer pos
 static uint          cons_in_rb_consumer; // Console input current reader pos
 static uint8_t       cons_in_rb[1024];    // Console input ring buffer (FIFO)
 static uint8_t       usb_out_buf[2048];   // USB output buffer
 static uint16_t      usb_out_bufpos = 0;  // USB output buffer position
+static uint64_t      usb_out_deadline;    // Time by which to send USB output
+static uint8_t       uart_out_buf[1024];  // UART output ring storage
+static tx_ring_t     uart_out_ring = {    // UART output ring (FIFO)
+    uart_out_buf, sizeof (uart_out_buf), sizeof (uart_out_buf) / 2, 0, 0
+};
+#ifdef CONSOLE_TX_DMA
+static volatile uint uart_out_dma_len;    // Length of DMA chunk in progress
+#endif
 static bool          uart_console_active = false;
+uint                 cons_in_drops = 0;   // Input bytes lost to a full ring
+static int           cons_last_putc = 0;  // For CRLF expansion
+
+#define USB_OUT_PACKET    64  // Send at end of line if a packet is pending
+#define USB_OUT_MAX_MSEC  5   // Send at end of line if output is this old
 
 uint8_t last_input_source = 0;
 
+static void usb_putchar_flush(void);
+
 static void uart_wait_send_ready(USART_TypeDef_P usart)
 {
     /* Wait until the data has been transferred into the shift register. */
@@ -68,16 +107,216 @@ static void uart_send(USART_TypeDef_P usart, uint16_t data)
     USART_DR(usart) = (data & USART_DR_MASK);
 }
 
-static void uart_send_blocking(USART_TypeDef_P usart, uint16_t data)
+#ifdef CONSOLE_TX_DMA
+/*
+ * uart_out_dma_start
+ * ------------------
+ * If the DMA channel is idle, starts a transfer of the next chunk of
+ * the UART output ring. The chunk is consumed from the ring only when
+ * the transfer completes. This must be called either from the DMA
+ * interrupt or with the DMA interrupt masked.
+ */
+static void
+uart_out_dma_start(void)
+{
+    const uint8_t *ptr;
+    uint           len;
+
+    if (uart_out_dma_len != 0)
+        return;  // Transfer already in progress
+    len = tx_ring_peek(&uart_out_ring, &ptr);
+    if (len == 0)
+        return;
+    uart_out_dma_len = len;
+    dma_set_memory_address(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, (uintptr_t) ptr);
+    dma_set_number_of_data(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, len);
+    dma_enable_channel(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+}
+
+/*
+ * uart_out_dma_done
+ * -----------------
+ * Completes the current DMA transfer, consuming the sent chunk from the
+ * UART output ring and starting the next chunk.
+ */
+static void
+uart_out_dma_done(void)
+{
+    dma_clear_interrupt_flags(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, DMA_TCIF);
+    dma_disable_channel(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+    tx_ring_consume(&uart_out_ring, uart_out_dma_len);
+    uart_out_dma_len = 0;
+    uart_out_dma_start();
+}
+
+void
+CONSOLE_DMA_IRQHandler(void)
+{
+    if (dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, DMA_TCIF))
+        uart_out_dma_done();
+}
+
+/*
+ * uart_out_start
+ * --------------
+ * Begins transmission of queued UART output.
+ */
+static void
+uart_out_start(void)
+{
+    nvic_disable_irq(CONSOLE_DMA_IRQn);
+    uart_out_dma_start();
+    nvic_enable_irq(CONSOLE_DMA_IRQn);
+}
+
+/*
+ * uart_out_poll
+ * -------------
+ * Advances UART output by polling for DMA completion rather than waiting
+ * for the interrupt. This allows output to progress when interrupts are
+ * not being taken, such as from a fault handler.
+ */
+static void
+uart_out_poll(void)
+{
+    uint count = 0;
+
+    nvic_disable_irq(CONSOLE_DMA_IRQn);
+    uart_out_dma_start();
+    if (uart_out_dma_len == 0) {
+        nvic_enable_irq(CONSOLE_DMA_IRQn);
+        return;  // Nothing to send
+    }
+    while (!dma_get_interrupt_flag(CONSOLE_DMA, CONSOLE_DMA_CHANNEL,
+                                   DMA_TCIF)) {
+        if (count++ == 1000000)
+            break;  // Misconfigured hardware?
+    }
+    uart_out_dma_done();
+    nvic_enable_irq(CONSOLE_DMA_IRQn);
+}
+
+/*
+ * uart_out_init
+ * -------------
+ * Configures the DMA channel which feeds the console USART transmitter.
+ */
+static void
+uart_out_init(void)
+{
+    rcc_periph_clock_enable(RCC_DMA1);
+    dma_channel_reset(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+    dma_set_peripheral_address(CONSOLE_DMA, CONSOLE_DMA_CHANNEL,
+                               (uintptr_t) &USART_DR(CONSOLE_USART));
+    dma_set_read_from_memory(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+    dma_disable_peripheral_increment_mode(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+    dma_enable_memory_increment_mode(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+    dma_set_peripheral_size(CONSOLE_DMA, CONSOLE_DMA_CHANNEL,
+                            DMA_CCR_PSIZE_8BIT);
+    dma_set_memory_size(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, DMA_CCR_MSIZE_8BIT);
+    dma_set_priority(CONSOLE_DMA, CONSOLE_DMA_CHANNEL, DMA_CCR_PL_LOW);
+    dma_enable_transfer_complete_interrupt(CONSOLE_DMA, CONSOLE_DMA_CHANNEL);
+
+    nvic_set_priority(CONSOLE_DMA_IRQn, 0x40);
+    nvic_enable_irq(CONSOLE_DMA_IRQn);
+    usart_enable_tx_dma(CONSOLE_USART);
+}
+
+#else /* !CONSOLE_TX_DMA */
+
+/*
+ * uart_out_drain
+ * --------------
+ * Moves as much UART output ring content to the USART as it will
+ * currently accept, disabling the TXE interrupt once the ring is empty.
+ * This must be called either from the USART interrupt or with the
+ * USART interrupt masked.
+ */
+static void
+uart_out_drain(void)
+{
+    const uint8_t *ptr;
+
+    while (tx_ring_peek(&uart_out_ring, &ptr) != 0) {
+        if ((USART_SR(CONSOLE_USART) & USART_SR_TXE) == 0)
+            return;
+        uart_send(CONSOLE_USART, *ptr);
+        tx_ring_consume(&uart_out_ring, 1);
+    }
+    USART_CR1(CONSOLE_USART) &= ~USART_CR1_TXEIE;
+}
+
+/*
+ * uart_out_start
+ * --------------
+ * Enables the TXE interrupt so that queued UART output will be sent.
+ */
+static inline void
+uart_out_start(void)
+{
+    USART_CR1(CONSOLE_USART) |= USART_CR1_TXEIE;
+}
+
+/*
+ * uart_out_poll
+ * -------------
+ * Drains UART output by polling rather than waiting for the interrupt.
+ * This allows output to progress when interrupts are not being taken,
+ * such as from a fault handler.
+ */
+static void
+uart_out_poll(void)
+{
+    uint count = 0;
+
+    nvic_disable_irq(CONSOLE_IRQn);
+    while ((USART_SR(CONSOLE_USART) & USART_SR_TXE) == 0) {
+        if (count++ == 100000) {
+            /* Misconfigured hardware? Discard a character to make progress */
+            tx_ring_consume(&uart_out_ring, 1);
+            break;
+        }
+    }
+    uart_out_drain();
+    nvic_enable_irq(CONSOLE_IRQn);
+}
+
+static void
+uart_out_init(void)
+{
+}
+#endif /* !CONSOLE_TX_DMA */
+
+/*
+ * uart_out_write
+ * --------------
+ * Copies data to the UART output ring, waiting for space if necessary.
+ * The caller must use uart_out_start() to begin transmission.
+ */
+static void
+uart_out_write(const void *buf, uint len)
 {
-    uart_wait_send_ready(usart);
-    uart_send(usart, data);
+    const uint8_t *ptr = buf;
+
+    while (len > 0) {
+        uint count = tx_ring_put(&uart_out_ring, ptr, len);
+        if (count == 0) {
+            uart_out_start();
+            uart_out_poll();
+            continue;
+        }
+        ptr += count;
+        len -= count;
+    }
 }
 
 int
 uart_putchar(int ch)
 {
-    uart_send_blocking(CONSOLE_USART, (uint16_t) ch);
+    uint8_t byte = ch;
+
+    uart_out_write(&byte, 1);
+    uart_out_start();
     return (0);
 }
 
@@ -87,11 +326,6 @@ uart_recv(USART_TypeDef_P usart)
     return (USART_DR(usart) & USART_DR_MASK);
 }
 
-void
-uart_flush(void)
-{
-    uart_wait_send_ready(CONSOLE_USART);
-}
 
 /*
  * cons_rb_put() stores a character in the UART input ring buffer.
@@ -106,8 +340,9 @@ cons_rb_put(uint ch)
     uint new_prod = ((cons_in_rb_producer + 1) % sizeof (cons_in_rb));
 
     if (new_prod == cons_in_rb_consumer) {
-        uart_putchar('%');
-        return;  // Would cause ring buffer overflow
+        /* Would overflow; count it, as interrupts must not print */
+        cons_in_drops++;
+        return;
     }
 
     disable_irq();
@@ -116,6 +351,23 @@ cons_rb_put(uint ch)
     enable_irq();
 }
 
+/*
+ * cons_rb_space() returns a count of the number of characters remaining
+ *                 in the UART input ring buffer before the buffer is
+ *                 completely full.  A value of 0 means the buffer is
+ *                 already full.
+ *
+ * This function requires no arguments.
+ *
+ * @return      The number of characters of available space in cons_in_rb.
+ */
+static uint
+cons_rb_space(void)
+{
+    uint diff = cons_in_rb_consumer - cons_in_rb_producer;
+    return (diff + sizeof (cons_in_rb) - 1) % sizeof (cons_in_rb);
+}
+
 /*
  * cons_rb_get() returns the next character in the UART input ring buffer.
  *               A value of -1 is returned if there are no characters waiting
@@ -135,27 +387,15 @@ cons_rb_get(void)
 
     ch = cons_in_rb[cons_in_rb_consumer];
     cons_in_rb_consumer = (cons_in_rb_consumer + 1) % sizeof (cons_in_rb);
+    usb_console_consume(cons_rb_space());
     return (ch);
 }
 
-#if 0
-/*
- * cons_rb_space() returns a count of the number of characters remaining
- *                 in the UART input ring buffer before the buffer is
- *                 completely full.  A value of 0 means the buffer is
- *                 already full.
- *
- * This function requires no arguments.
- *
- * @return      The number of characters of available space in cons_in_rb.
- */
-static uint
-cons_rb_space(void)
+uint
+usb_rb_space(void)
 {
-    uint diff = cons_in_rb_consumer - cons_in_rb_producer;
-    return (diff + sizeof (cons_in_rb) - 1) % sizeof (cons_in_rb);
+    return (cons_rb_space());
 }
-#endif
 
 /*
  * input_break_pending() returns true if a ^C is pending in the input buffer.
@@ -171,10 +411,15 @@ input_break_pending(void)
     uint cur;
     uint next;
 
+    /* Long-running commands poll here, so send any aged USB output */
+    if ((usb_out_bufpos != 0) && timer_tick_has_elapsed(usb_out_deadline))
+        usb_putchar_flush();
+
     for (cur = cons_in_rb_consumer; cur != cons_in_rb_producer; cur = next) {
         next = (cur + 1) % sizeof (cons_in_rb);
         if (cons_in_rb[cur] == 0x03) {  /* ^C is abort key */
             cons_in_rb_consumer = next;
+            usb_console_consume(cons_rb_space());
             return (1);
         }
     }
@@ -207,55 +452,95 @@ usb_putchar_flush(void)
         usb_out_bufpos = 0;  // Flush was successful
 }
 
+/*
+ * usb_out_write
+ * -------------
+ * Copies data to the USB output buffer, sending the buffer first if it
+ * is full.
+ */
 static void
-usb_putchar(int ch)
+usb_out_write(const void *buf, uint len)
 {
-    if (usb_out_bufpos < sizeof (usb_out_buf))
-        usb_out_buf[usb_out_bufpos++] = ch;
-    usb_putchar_flush();
+    const uint8_t *ptr = buf;
+
+    while ((len > 0) && usb_console_active) {
+        uint count = sizeof (usb_out_buf) - usb_out_bufpos;
+        if (count == 0) {
+            /* Buffer is full; need to first force a flush */
+            uint64_t timeout = timer_tick_plus_msec(10);
+            usb_send_stalls++;
+            while (usb_out_bufpos >= sizeof (usb_out_buf)) {
+                usb_putchar_flush();
+                if (timer_tick_has_elapsed(timeout)) {
+                    usb_console_active = false;
+                    usb_send_timeouts++;
+                    return;
+                }
+            }
+            continue;
+        }
+        if (usb_out_bufpos == 0)
+            usb_out_deadline = timer_tick_plus_msec(USB_OUT_MAX_MSEC);
+        count = MIN(count, len);
+        memcpy(usb_out_buf + usb_out_bufpos, ptr, count);
+        usb_out_bufpos += count;
+        ptr += count;
+        len -= count;
+    }
 }
 
+/*
+ * usb_out_line_end
+ * ----------------
+ * Sends USB output at the end of a line if at least a full packet is
+ * pending or if pending output has waited long enough.
+ */
 static void
-usb_putchar_wait(int ch)
+usb_out_line_end(void)
 {
-    if ((usb_console_active == true) &&
-        (usb_out_bufpos >= sizeof (usb_out_buf))) {
-        /* Buffer is full; need to first force a flush */
-        uint64_t timeout = timer_tick_plus_msec(10);
-        while (usb_out_bufpos >= sizeof (usb_out_buf)) {
-            usb_putchar_flush();
-            if (timer_tick_has_elapsed(timeout)) {
-                usb_console_active = false;
-                return;
-            }
-        }
-    }
-    usb_putchar(ch);
+    if ((usb_out_bufpos >= USB_OUT_PACKET) ||
+        ((usb_out_bufpos != 0) && timer_tick_has_elapsed(usb_out_deadline)))
+        usb_putchar_flush();
 }
 
+/*
+ * usb_out_drain_wait
+ * ------------------
+ * Waits for buffered USB text to be sent, so that binary data which
+ * follows is not interleaved with it.
+ */
 static int
-usb_puts_wait(uint8_t *buf, uint32_t len)
+usb_out_drain_wait(void)
 {
-    if (usb_console_active == 0)
-        return (1);
     if (usb_out_bufpos != 0) {
-        /* First flush outstanding text */
         uint64_t timeout = timer_tick_plus_msec(50);
         usb_putchar_flush();
         while (usb_out_bufpos != 0) {
             if (timer_tick_has_elapsed(timeout)) {
                 printf("Host Timeout on USB flush\n");
+                usb_send_timeouts++;
                 return (1);
             }
             usb_putchar_flush();
         }
     }
+    return (0);
+}
+
+static int
+usb_puts_wait(uint8_t *buf, uint32_t len)
+{
+    if (usb_console_active == 0)
+        return (1);
+    if (usb_out_drain_wait())
+        return (1);  // First flush outstanding text
     // XXX: Simplify below loop if both STM32 HAL and opencm3 libraries
     //      support transmitting more than 64 bytes at a time.
     while (len > 0) {
         uint32_t tlen = len;
         if (CDC_Transmit_FS(buf, tlen) != USBD_OK) {
             uint64_t timeout = timer_tick_plus_msec(50);
+            usb_send_stalls++;
             while (CDC_Transmit_FS(buf, tlen) != USBD_OK) {
                 if (timer_tick_has_elapsed(timeout)) {
                     printf("Host Timeout on USB send\n");
@@ -276,37 +561,99 @@ puts_binary(const void *buf, uint32_t len)
 {
     uint8_t *ptr = (uint8_t *) buf;
     if (last_input_source == SOURCE_UART) {
-        while (len-- > 0)
-            uart_putchar(*(ptr++));
+        uart_out_write(ptr, len);
+        uart_out_start();
         return (0);
     } else {
         return (usb_puts_wait(ptr, len));
     }
 }
 
+/*
+ * puts_binary_stream
+ * ------------------
+ * Sends a large binary block to the console as fast as the transport
+ * allows. On USB, full packets are written directly to the endpoint;
+ * the stream must be followed by a short write (such as text).
+ */
 int
-putchar(int ch)
+puts_binary_stream(const void *buf, uint32_t len)
+{
+    if (last_input_source == SOURCE_UART)
+        return (puts_binary(buf, len));
+    if ((usb_console_active == 0) || usb_out_drain_wait())
+        return (1);
+    return (usb_send_packets(buf, len) != 0);
+}
+
+/*
+ * cons_out
+ * --------
+ * Sends already CRLF-expanded text to the active console transports.
+ */
+static void
+cons_out(const char *buf, uint len, bool to_uart)
 {
-    static int last_putc = 0;
-    if ((ch == '\n') && (last_putc != '\r') && (last_putc != '\n')) {
-        uart_putchar('\r');  // Always do CRLF
-        usb_putchar_wait('\r');
+    usb_out_write(buf, len);
+    if (to_uart)
+        uart_out_write(buf, len);
+}
+
+void
+console_write(const char *buf, uint len)
+{
+    const char *end = buf + len;
+    bool        to_uart = !usb_console_active || uart_console_active;
+
+    while (buf < end) {
+        const char *nl = memchr(buf, '\n', end - buf);
+        uint        seg = ((nl == NULL) ? end : nl) - buf;
+
+        if (seg > 0) {
+            cons_out(buf, seg, to_uart);
+            cons_last_putc = buf[seg - 1];
+            buf += seg;
+        }
+        if (nl == NULL)
+            break;
+
+        if ((cons_last_putc != '\r') && (cons_last_putc != '\n'))
+            cons_out("\r\n", 2, to_uart);  // Always do CRLF
+        else
+            cons_out("\n", 1, to_uart);
+        cons_last_putc = '\n';
+        buf++;
+        usb_out_line_end();
     }
-    last_putc = ch;
+    if (to_uart)
+        uart_out_start();
+}
 
-    usb_putchar_wait(ch);
-    if (usb_console_active && !uart_console_active)
-        return (0);
-    return (uart_putchar(ch));
+int
+putchar(int ch)
+{
+    char c = ch;
+
+    console_write(&c, 1);
+    return (0);
 }
 
 int
 puts(const char *str)
 {
-    while (*str != '\0')
-        if (putchar((uint8_t) *(str++)))
-            return (1);
-    return (putchar('\n'));
+    console_write(str, strlen(str));
+    console_write("\n", 1);
+    return (0);
+}
+
+void
+uart_flush(void)
+{
+    usb_putchar_flush();
+    uart_out_start();
+    while (tx_ring_used(&uart_out_ring) != 0)
+        uart_out_poll();
+    uart_wait_send_ready(CONSOLE_USART);
 }
 
 int
@@ -318,6 +665,12 @@ getchar(void)
     return (cons_rb_get());
 }
 
+int
+getchar_queued(void)
+{
+    return (cons_rb_get());
+}
+
 void
 CONSOLE_IRQHandler(void)
 {
@@ -325,6 +678,10 @@ CONSOLE_IRQHandler(void)
         uart_console_active = true;
     while (USART_SR(CONSOLE_USART) & (USART_SR_RXNE | USART_SR_ORE))
         uart_rb_put(uart_recv(CONSOLE_USART));
+#ifndef CONSOLE_TX_DMA
+    if (USART_CR1(CONSOLE_USART) & USART_CR1_TXEIE)
+        uart_out_drain();
+#endif
 }
 
 static void
@@ -375,7 +732,7 @@ uart_init(void)
 #endif
 
     /* Setup UART parameters. */
-    usart_set_baudrate(CONSOLE_USART, 115200);
+    usart_set_baudrate(CONSOLE_USART, CONSOLE_BAUD);
     usart_set_databits(CONSOLE_USART, 8);
     usart_set_stopbits(CONSOLE_USART, USART_STOPBITS_1);
     usart_set_mode(CONSOLE_USART, USART_MODE_TX_RX);
@@ -383,6 +740,8 @@ uart_init(void)
     usart_set_flow_control(CONSOLE_USART, USART_FLOWCONTROL_NONE);
     usart_enable(CONSOLE_USART);
 
+    uart_out_init();
+
 #undef UART_DEBUG
 #ifdef UART_DEBUG
     for (int y = 0; y < 10; y++) {
@@ -48,6 +48,14 @@ int puts(const char *str);
  */
 int getchar(void);
 
+/*
+ * getchar_queued() returns the next character already received, or -1 if
+ *                  none is waiting. Unlike getchar(), pending output is
+ *                  not flushed, so that responses to queued commands may
+ *                  share a USB packet.
+ */
+int getchar_queued(void);
+
 /*
  * uart_init() initializes the serial console uart.
  */
@@ -55,6 +63,12 @@ void uart_init(void);
 
 void usb_rb_put(uint ch);
 
+/*
+ * usb_rb_space() returns the number of characters which may be added to
+ *                the console input ring buffer before it is full.
+ */
+uint usb_rb_space(void);
+
 /*
  * input_break_pending() returns true if a ^C is pending in the input buffer.
  *
@@ -65,13 +79,30 @@ void usb_rb_put(uint ch);
  */
 int input_break_pending(void);
 
+/*
+ * console_write() sends a buffer of text to the console, converting
+ * each LF to CRLF.
+ *
+ * @param [in]  buf - The text to output.
+ * @param [in]  len - The number of characters to output.
+ *
+ * @return      None.
+ */
+void console_write(const char *buf, uint len);
+
 int uart_putchar(int ch);
+
+/*
+ * uart_flush() waits for all buffered console output to be sent.
+ */
 void uart_flush(void);
 int puts_binary(const void *buf, uint32_t len);
+int puts_binary_stream(const void *buf, uint32_t len);
 
 #define SOURCE_UART 0  // Last input source was serial UART
 #define SOURCE_USB  1  // Last input source was USB virtual serial port
 
 extern uint8_t last_input_source;
+extern uint cons_in_drops;
 
 #endif /* _UART_H */
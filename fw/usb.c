@@ -104,6 +104,24 @@ uint8_t usb_console_active = false;
 uint  usb_drop_packets = 0;
 uint  usb_drop_bytes = 0;
 uint  usb_send_timeouts = 0;
+uint  usb_send_stalls = 0;
+uint  usb_upload_naks = 0;
+uint  usb_console_naks = 0;
+
+/*
+ * Upload receive buffer. While an upload is active, data OUT packets are
+ * read directly into this buffer rather than the console input ring. The
+ * USB_MAX_EP2_SIZE slack past the end allows a whole packet to always be
+ * read at the producer position; any part landing in the slack is then
+ * moved to the start. Positions are free-running, masked on access.
+ */
+__attribute__((aligned(4)))
+static uint8_t usb_upload_buf[USB_UPLOAD_SIZE + USB_MAX_EP2_SIZE];
+static volatile uint32_t usb_upload_producer;
+static volatile uint32_t usb_upload_consumer;
+static volatile bool     usb_upload_active = false;
+static volatile bool     usb_upload_nak = false;
+static volatile bool     usb_console_nak = false;
 
 
 /**
@@ -351,6 +369,146 @@ transmit_success:
     return (USBD_OK);
 }
 
+/*
+ * usb_send_packets() streams a buffer to the host as full size packets on
+ *                    the data IN endpoint, waiting for each packet buffer
+ *                    to become free. Unlike CDC_Transmit_FS(), a final full
+ *                    packet is not split, so the caller must terminate the
+ *                    stream with a short packet (such as following text).
+ *
+ * @param [in]  buf - The data to send.
+ * @param [in]  len - The number of bytes to send.
+ *
+ * @return      0 = Success.
+ * @return      -1 = USB console not active, or the host timed out.
+ */
+int
+usb_send_packets(const void *buf, uint32_t len)
+{
+#ifndef DEBUG_NO_USB
+    const uint8_t *ptr = buf;
+    uint64_t       timeout = 0;
+
+    if (usb_console_active == false)
+        return (-1);
+
+    while (len != 0) {
+        uint tlen = (len > USB_MAX_EP2_SIZE) ? USB_MAX_EP2_SIZE : len;
+        uint count;
+
+        usb_poll();
+        usb_mask_interrupts();
+        count = usbd_ep_write_packet(usbd_gdev, 0x82, ptr, tlen);
+        usb_unmask_interrupts();
+        if (count != 0) {
+            ptr += count;
+            len -= count;
+            timeout = 0;
+        } else if (timeout == 0) {
+            usb_send_stalls++;
+            timeout = timer_tick_plus_msec(50);
+        } else if (timer_tick_has_elapsed(timeout)) {
+            usb_send_timeouts++;
+            usb_drop_bytes += len;
+            return (-1);
+        }
+    }
+#endif
+    return (0);
+}
+
+/*
+ * usb_upload_start() directs data OUT packets from the host to the upload
+ *                    buffer instead of the console input ring. Packets are
+ *                    NAKed while the buffer is full, so the host is paced
+ *                    by the consumer and no data is lost. Console output
+ *                    is unaffected.
+ *
+ * @return      0 = Upload started.
+ * @return      -1 = USB console not active.
+ */
+int
+usb_upload_start(void)
+{
+#ifndef DEBUG_NO_USB
+    if (usb_console_active == false)
+        return (-1);
+
+    usb_mask_interrupts();
+    usb_upload_producer = 0;
+    usb_upload_consumer = 0;
+    usb_upload_nak = false;
+    usb_upload_active = true;
+    usb_unmask_interrupts();
+    return (0);
+#else
+    return (-1);
+#endif
+}
+
+/*
+ * usb_upload_stop() returns data OUT packets to the console input ring.
+ *                   Any unconsumed upload data is discarded.
+ */
+void
+usb_upload_stop(void)
+{
+#ifndef DEBUG_NO_USB
+    usb_mask_interrupts();
+    usb_upload_active = false;
+    if (usb_upload_nak) {
+        usb_upload_nak = false;
+        usbd_ep_nak_set(usbd_gdev, 0x01, 0);
+    }
+    usb_unmask_interrupts();
+#endif
+}
+
+/*
+ * usb_upload_peek() provides the next contiguous block of uploaded data.
+ *                   USB is polled first when no data is waiting.
+ *
+ * @param [out] ptr - Set to the start of the block.
+ *
+ * @return      The number of bytes in the block (0 if none available).
+ */
+uint32_t
+usb_upload_peek(const uint8_t **ptr)
+{
+    uint32_t consumer = usb_upload_consumer;
+    uint32_t pos = consumer & (USB_UPLOAD_SIZE - 1);
+    uint     len;
+
+    if (usb_upload_producer == consumer)
+        usb_poll();
+    len = usb_upload_producer - consumer;
+    if (len > USB_UPLOAD_SIZE - pos)
+        len = USB_UPLOAD_SIZE - pos;
+    *ptr = usb_upload_buf + pos;
+    return (len);
+}
+
+/*
+ * usb_upload_consume() releases uploaded data which has been processed,
+ *                      resuming the data OUT endpoint if it was NAKed and
+ *                      there is now space for another packet.
+ *
+ * @param [in]  len - The number of bytes processed.
+ */
+void
+usb_upload_consume(uint32_t len)
+{
+    usb_upload_consumer += len;
+    if (usb_upload_nak &&
+        (USB_UPLOAD_SIZE - (usb_upload_producer - usb_upload_consumer) >=
+         USB_MAX_EP2_SIZE)) {
+        usb_mask_interrupts();
+        usb_upload_nak = false;
+        usbd_ep_nak_set(usbd_gdev, 0x01, 0);
+        usb_unmask_interrupts();
+    }
+}
+
 /*
  * This notification endpoint isn't implemented. According to CDC spec its
  * optional, but its absence causes a NULL pointer dereference in Linux
@@ -529,6 +687,50 @@ cdcacm_control_request(usbd_device *usbd_dev, struct usb_setup_data *req,
     return (USBD_REQ_NOTSUPP);
 }
 
+/*
+ * usb_upload_rx() reads a data OUT packet into the upload buffer. When
+ *                 there is no longer space for another full packet, the
+ *                 endpoint is set to NAK further packets until the buffer
+ *                 has been drained by usb_upload_consume().
+ */
+static void usb_upload_rx(usbd_device *usbd_dev)
+{
+    uint32_t pos = usb_upload_producer & (USB_UPLOAD_SIZE - 1);
+    uint     len;
+
+    len = usbd_ep_read_packet(usbd_dev, 0x01, usb_upload_buf + pos,
+                              USB_MAX_EP2_SIZE);
+    if (pos + len > USB_UPLOAD_SIZE) {
+        memcpy(usb_upload_buf, usb_upload_buf + USB_UPLOAD_SIZE,
+               pos + len - USB_UPLOAD_SIZE);
+    }
+    usb_upload_producer += len;
+
+    if (USB_UPLOAD_SIZE - (usb_upload_producer - usb_upload_consumer) <
+        USB_MAX_EP2_SIZE) {
+        usbd_ep_nak_set(usbd_dev, 0x01, 1);
+        usb_upload_nak = true;
+        usb_upload_naks++;
+    }
+}
+
+/*
+ * usb_console_consume() is called as characters are taken from the console
+ *                       input ring. If data OUT packets were being NAKed
+ *                       because the ring was full, they are accepted again
+ *                       once there is space for another full packet.
+ */
+void
+usb_console_consume(uint space)
+{
+    if (usb_console_nak && (space >= USB_MAX_EP2_SIZE)) {
+        usb_mask_interrupts();
+        usb_console_nak = false;
+        usbd_ep_nak_set(usbd_gdev, 0x01, 0);
+        usb_unmask_interrupts();
+    }
+}
+
 /*
  * cdcacm_rx_cb() gets called when the USB hardware has received data from
  *                the host on the data OUT endpoint (0x01).
@@ -536,7 +738,14 @@ cdcacm_control_request(usbd_device *usbd_dev, struct usb_setup_data *req,
 static void cdcacm_rx_cb(usbd_device *usbd_dev, uint8_t ep)
 {
     char buf[64];
-    int len = usbd_ep_read_packet(usbd_dev, 0x01, buf, sizeof (buf));
+    int len;
+
+    if (usb_upload_active) {
+        usb_upload_rx(usbd_dev);
+        return;
+    }
+
+    len = usbd_ep_read_packet(usbd_dev, 0x01, buf, sizeof (buf));
 
     if (len > 0) {
         int pos;
@@ -544,6 +753,16 @@ static void cdcacm_rx_cb(usbd_device *usbd_dev, uint8_t ep)
         for (pos = 0; pos < len; pos++)
             usb_rb_put(buf[pos]);
     }
+
+    /*
+     * Hold off the host rather than drop input when another packet might
+     * not fit, as queued machine mode commands can fill the ring.
+     */
+    if (usb_rb_space() < USB_MAX_EP2_SIZE) {
+        usbd_ep_nak_set(usbd_dev, 0x01, 1);
+        usb_console_nak = true;
+        usb_console_naks++;
+    }
 }
 
 /*
@@ -858,5 +1077,9 @@ usb_show_stats(void)
     printf("console_active=%s\n", usb_console_active ? "true" : "false");
     printf("packet drops=%u\n", usb_drop_packets);
     printf("byte drops=%u\n", usb_drop_bytes);
+    printf("send stalls=%u\n", usb_send_stalls);
     printf("send timeouts=%u\n", usb_send_timeouts);
+    printf("upload naks=%u\n", usb_upload_naks);
+    printf("console naks=%u\n", usb_console_naks);
+    printf("console input drops=%u\n", cons_in_drops);
 }
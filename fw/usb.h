@@ -26,9 +26,19 @@ void usb_show_regs(void);
 void usb_show_stats(void);
 
 uint8_t CDC_Transmit_FS(uint8_t *buf, uint16_t len);
+int usb_send_packets(const void *buf, uint32_t len);
+
+#define USB_UPLOAD_SIZE 4096  // Upload buffer size (power of 2)
+
+int usb_upload_start(void);
+void usb_upload_stop(void);
+uint32_t usb_upload_peek(const uint8_t **ptr);
+void usb_upload_consume(uint32_t len);
+void usb_console_consume(uint space);
 
 extern uint8_t usb_console_active;
 extern unsigned int usb_send_timeouts;
+extern unsigned int usb_send_stalls;
 
 /* libopencm3 */
 // #include <libopencm3/stm32/memorymap.h>
@@ -0,0 +1,193 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Console link throughput benchmark.
+ *
+ * "usb bench send" streams a generated pattern to the host, either by
+ * puts_binary() (the path used by "pld walk raw") or by the faster
+ * puts_binary_stream(). "usb bench recv" consumes and verifies the same
+ * pattern sent by the host, by way of the USB upload buffer. The pattern
+ * is a sequence of little-endian 32-bit words counting up from zero, so
+ * the receiver can detect any lost, duplicated or corrupted byte.
+ * sw/usbbench drives both ends.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "printf.h"
+#include "main.h"
+#include "cmdline.h"
+#include "cmds.h"
+#include "timer.h"
+#include "uart.h"
+#include "usb.h"
+#include "usb_bench.h"
+
+static uint32_t usb_bench_buf[USB_BENCH_CHUNK / 4];
+
+/*
+ * usb_bench_kbps
+ * --------------
+ * Returns the transfer rate in KB/sec.
+ */
+static uint
+usb_bench_kbps(uint bytes, uint64_t usec)
+{
+    if (usec == 0)
+        usec = 1;
+    return ((uint) ((uint64_t) bytes * 1000000 / 1024 / usec));
+}
+
+/*
+ * usb_bench_send
+ * --------------
+ * Streams len bytes of the pattern to the host.
+ */
+static rc_t
+usb_bench_send(uint len, uint fast)
+{
+    uint     stalls = usb_send_stalls;
+    uint     timeouts = usb_send_timeouts;
+    uint     pos;
+    uint     word;
+    uint     sent = 0;
+    uint64_t start;
+    uint64_t usec;
+    rc_t     rc = RC_SUCCESS;
+
+    printf("---- USBBENCH BYTES=0x%x %s ----\n", len, fast ? "FAST" : "WAIT");
+    uart_flush();
+
+    start = timer_tick_get();
+    for (pos = 0; pos < len; pos += USB_BENCH_CHUNK) {
+        uint tlen = len - pos;
+        uint first = pos / 4;
+        if (tlen > USB_BENCH_CHUNK)
+            tlen = USB_BENCH_CHUNK;
+        for (word = 0; word < USB_BENCH_CHUNK / 4; word++)
+            usb_bench_buf[word] = first + word;
+        if ((fast ? puts_binary_stream(usb_bench_buf, tlen) :
+                    puts_binary(usb_bench_buf, tlen)) != 0) {
+            rc = RC_FAILURE;
+            break;
+        }
+        sent += tlen;
+    }
+    usec = timer_tick_to_usec(timer_tick_get() - start);
+
+    printf("\n---- END ----\n");
+    printf("Sent %u bytes in %llu us = %u KB/s; stalls=%u timeouts=%u\n",
+           sent, usec, usb_bench_kbps(sent, usec),
+           usb_send_stalls - stalls, usb_send_timeouts - timeouts);
+    return (rc);
+}
+
+/*
+ * usb_bench_recv
+ * --------------
+ * Consumes and verifies len bytes of the pattern sent by the host. When
+ * the command arrived by USB, the data is taken from the USB upload
+ * buffer; otherwise it is read from the console input ring.
+ */
+static rc_t
+usb_bench_recv(uint len)
+{
+    const uint8_t *ptr;
+    uint           pos = 0;
+    uint           count;
+    uint           cur;
+    uint           errors = 0;
+    uint           first_error = 0;
+    uint           upload;
+    uint64_t       start = 0;
+    uint64_t       idle = timer_tick_plus_msec(USB_BENCH_IDLE_MSEC);
+    uint64_t       usec = 0;
+    uint8_t        ch;
+    int            getch;
+
+    upload = (last_input_source == SOURCE_USB) && (usb_upload_start() == 0);
+    printf("---- USBBENCH RECV BYTES=0x%x %s ----\n",
+           len, upload ? "UPLOAD" : "CONSOLE");
+    uart_flush();
+
+    while (pos < len) {
+        if (upload) {
+            count = usb_upload_peek(&ptr);
+        } else {
+            getch = getchar();
+            ch = (uint8_t) getch;
+            ptr = &ch;
+            count = (getch >= 0);
+        }
+        if (count == 0) {
+            if (timer_tick_has_elapsed(idle))
+                break;
+            continue;
+        }
+        if (pos == 0)
+            start = timer_tick_get();
+        if (count > len - pos)
+            count = len - pos;
+        for (cur = 0; cur < count; cur++, pos++) {
+            uint expect = ((pos >> 2) >> ((pos & 3) * 8)) & 0xff;
+            if (ptr[cur] != expect) {
+                if (errors++ == 0)
+                    first_error = pos;
+            }
+        }
+        if (upload)
+            usb_upload_consume(count);
+        idle = timer_tick_plus_msec(USB_BENCH_IDLE_MSEC);
+    }
+    if (pos != 0)
+        usec = timer_tick_to_usec(timer_tick_get() - start);
+    if (upload)
+        usb_upload_stop();
+
+    printf("Received %u of %u bytes in %llu us = %u KB/s; errors=%u",
+           pos, len, usec, usb_bench_kbps(pos, usec), errors);
+    if (errors != 0)
+        printf(" first at 0x%x", first_error);
+    printf("\n");
+    return (((pos == len) && (errors == 0)) ? RC_SUCCESS : RC_FAILURE);
+}
+
+/*
+ * usb_bench
+ * ---------
+ * Implements "usb bench send <bytes> [fast]" and "usb bench recv <bytes>".
+ * The argument vector starts at "bench".
+ */
+rc_t
+usb_bench(int argc, char * const *argv)
+{
+    uint len;
+    uint fast = 0;
+
+    if ((argc < 3) || (argc > 4))
+        return (RC_USER_HELP);
+    if (parse_uint(argv[2], &len) != RC_SUCCESS)
+        return (RC_BAD_PARAM);
+    len &= ~3;  // Whole pattern words
+    if (argc == 4) {
+        if (strcmp(argv[3], "fast") != 0) {
+            printf("Unknown argument %s\n", argv[3]);
+            return (RC_USER_HELP);
+        }
+        fast = 1;
+    }
+
+    if (strcmp(argv[1], "send") == 0)
+        return (usb_bench_send(len, fast));
+    if ((strcmp(argv[1], "recv") == 0) && (fast == 0))
+        return (usb_bench_recv(len));
+
+    printf("Unknown argument %s\n", argv[1]);
+    return (RC_USER_HELP);
+}
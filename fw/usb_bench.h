@@ -0,0 +1,20 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Console link throughput benchmark.
+ */
+
+#ifndef _USB_BENCH_H
+#define _USB_BENCH_H
+
+#define USB_BENCH_CHUNK     1024  // Bytes generated per transmit call
+#define USB_BENCH_IDLE_MSEC 2000  // Receive gives up after this idle time
+
+rc_t usb_bench(int argc, char * const *argv);
+
+#endif /* _USB_BENCH_H */
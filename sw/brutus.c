@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <string.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -38,49 +39,107 @@
 #define CONTENT_ASCII_UNKNOWN 2  // Unknown ASCII (hex or binary)
 #define CONTENT_ASCII_BINARY  3  // ASCII binary
 #define CONTENT_ASCII_HEX     4  // ASCII hex
+#define CONTENT_HAZARD        5  // Hazard capture (walk hazard)
+
+#define HAZARD_MAX_SAMPLES 16    // Maximum post-transition samples
+
+#define RAW_RESYNC_CONFIRM 4     // Records which must follow the walk to resync
+#define RAW_RESYNC_REPORTS 8     // Most misalignments reported individually
+
+#define SAMPLE_LFSR_TAPS   0x80200003  // Must match firmware WALK_LFSR_TAPS
+#define SAMPLE_MAX_SUPPORT 12    // Most inputs inferred for one output
+#define SAMPLE_SIGNIFICANCE 8    // Impurity reduction required over chance
 
 #define KEYWORD_UNKNOWN 0
 #define KEYWORD_END     1 // No more content
 #define KEYWORD_DEVICE  2 // DEVICE <name>
 #define KEYWORD_PIN     3 // PIN <num> = <name>
 
+/*
+ * Analysis masks hold one bit per signal. The default build covers the
+ * 28 pins of one board in 32-bit masks. Building with PLD_BITS=64 (make
+ * brutus64) analyzes combined captures of up to 64 signals, such as
+ * from two chained boards.
+ */
+#ifndef PLD_BITS
+#define PLD_BITS 32
+#endif
+
+#if PLD_BITS == 32
+typedef uint32_t pmask_t;
+#define PLD_SIGNALS 28          // Signals shown and analyzed
+#define PM_X        "x"         // printf() conversion of a pmask_t
+#define PM_SCAN     "%08x"      // scanf() of a hex record field
+#define PM_DIGITS   8           // Most hex digits in a record field
+#elif PLD_BITS == 64
+typedef uint64_t pmask_t;
+#define PLD_SIGNALS 64
+#define PM_X        PRIx64
+#define PM_SCAN     "%16" SCNx64
+#define PM_DIGITS   16
+#else
+#error "PLD_BITS must be 32 or 64"
+#endif
+
 #define ARRAY_SIZE(x) ((sizeof (x) / sizeof ((x)[0])))
-#define BIT(x)      (1 << (x))
+#define BIT(x)      ((pmask_t) 1 << (x))
+#define PM_ALL      (~(pmask_t) 0)
+#define LINE_LOST(line) ((pld_lost != NULL) && pld_lost[line])
 
 typedef unsigned int uint;
 
 static uint      total_lines = 0;    // Number of lines expected
 static uint      read_lines  = 0;    // Number of lines read
-static uint32_t *pld_in;             // Pin input to the PLD
-static uint32_t *pld_out;            // Pin output from the PLD
-static uint8_t   bit_flip_pos[32];   // Bit flip offsets into pld_in[] records
-static uint32_t  pins_affecting_pin[32];  // Mask of other pins affecting this
-static uint32_t  pins_always_input     = 0xffffffff;  // Pins which are inputs
-static uint32_t  pins_output           = 0x00000000;  // Pins which are outputs
-static uint32_t  pins_only_output_high = 0xffffffff;  // Open drain, drive high
-static uint32_t  pins_only_output_low  = 0xffffffff;  // Open drain, drive low
-static uint32_t  ignore_mask           = 0x00000000;  // Pins to ignore
+static pmask_t  *pld_in;             // Pin input to the PLD
+static pmask_t  *pld_out;            // Pin output from the PLD
+static uint32_t *pld_pwr = NULL;     // PLD VCC (bits 0-15), GND (16-31) ADC
+static uint8_t  *pld_lost = NULL;    // Records lost in a raw capture transfer
+static uint8_t   bit_flip_pos[PLD_BITS];  // Bit flip offsets into pld_in[]
+static pmask_t   pins_affecting_pin[PLD_BITS];  // Other pins affecting this
+static pmask_t   pins_always_input     = PM_ALL;      // Pins which are inputs
+static pmask_t   pins_output           = 0;           // Pins which are outputs
+static pmask_t   pins_only_output_high = PM_ALL;      // Open drain, drive high
+static pmask_t   pins_only_output_low  = PM_ALL;      // Open drain, drive low
+static pmask_t   ignore_mask           = 0;           // Pins to ignore
+static pmask_t   hold_mask             = 0;           // Pins held fixed
+static pmask_t   hold_value            = 0;           // Level of held pins
+static uint      sampled               = 0;           // Sampled walk capture
+static uint32_t  sample_seed           = 0x00000000;  // LFSR starting state
+static uint32_t  sample_ignore         = 0x00000000;  // Pins not sampled
+static pmask_t   walk_outputs          = 0;           // Classified, not walked
 static const char *cfg_filename        = NULL;        // config filename
 static const char *cfg_file_map        = NULL;        // memory-mapped config
 static const char *cfg_file_end        = NULL;        // end of mapped config
 
+typedef struct {
+    uint32_t hz_write_before;  // PLD input before the transition
+    uint32_t hz_write_after;   // PLD input after the transition
+    uint32_t hz_mask;          // Pins which changed more than once
+    uint32_t hz_read[HAZARD_MAX_SAMPLES + 2];  // before, samples, after
+} hazard_t;
+
+static hazard_t *hazards          = NULL;  // Captured hazard transitions
+static uint      hazard_count     = 0;     // Number of hazards[] entries
+static uint      hazard_capture   = 0;     // Capture is a hazard capture
+static uint      hazard_samples   = 0;     // Samples per transition
+static uint      hazard_delays[HAZARD_MAX_SAMPLES];  // Sample delays (ns)
 
 typedef struct {
     uint     pie_line;
     uint8_t  pie_result_bit;      // whether pin should be set to 1 or 0
-    uint32_t pie_affecting_bits;  // pins which affect this pin
-    uint32_t pie_input_bits;      // pin states which affect this pin
+    pmask_t  pie_affecting_bits;  // pins which affect this pin
+    pmask_t  pie_input_bits;      // pin states which affect this pin
 } pi_ent_t;
 
 static struct {
-    uint        pi_affecting_bits;
+    pmask_t     pi_affecting_bits;
     uint        pi_count;
     uint        pi_count_max;
     uint8_t     pi_invert;  // Pin is inverted at input/output
     uint8_t     pi_num;     // Pin number at input/output
     const char *pi_name;    // Pin virtual name
     pi_ent_t   *pi_ent;
-} pinfo[32];
+} pinfo[PLD_BITS];
 
 static const uint8_t bit_to_pin_plcc20[] =
 {
@@ -302,6 +361,91 @@ static const uint8_t bit_to_pin_dip4[] =
 
 static const uint8_t *bit_to_pin = NULL;
 
+/*
+ * A permutation of the 32 bits of a record, such as from the socket
+ * layout of one capture to device pin order. Each source byte value
+ * indexes a table of the destination bits it sets, so remapping a
+ * record costs four table loads and three ORs rather than a loop over
+ * its bits.
+ */
+typedef struct {
+    uint32_t bp_lut[4][256];
+} bit_perm_t;
+
+static bit_perm_t        socket_perm;       // Socket layout to pin order
+static const bit_perm_t *cap_perm = NULL;  // Remap records as they are read
+
+/*
+ * bit_perm_build
+ * --------------
+ * Build the permutation which moves each bit of the specified socket
+ * layout to the bit of its device pin (pin 1 at bit 0). Bits which are
+ * not connected to a device pin are discarded.
+ */
+static void
+bit_perm_build(bit_perm_t *perm, const uint8_t *layout)
+{
+    uint32_t map[32];
+    uint     bit;
+    uint     byte;
+    uint     value;
+
+    for (bit = 0; bit < 32; bit++) {
+        uint pin = (bit >= 28) ? 0 : (layout == NULL) ? bit + 1 : layout[bit];
+        map[bit] = (pin == 0) ? 0 : BIT(pin - 1);
+    }
+
+    /* Each entry is the entry without its lowest set bit, plus that bit */
+    for (byte = 0; byte < 4; byte++) {
+        perm->bp_lut[byte][0] = 0;
+        for (value = 1; value < 256; value++) {
+            perm->bp_lut[byte][value] =
+                perm->bp_lut[byte][value & (value - 1)] |
+                map[byte * 8 + __builtin_ctz(value)];
+        }
+    }
+}
+
+/*
+ * bit_perm_word
+ * -------------
+ * Returns the specified value with its bits permuted.
+ */
+static inline pmask_t
+bit_perm_word(const bit_perm_t *perm, pmask_t value)
+{
+    return (perm->bp_lut[0][value & 0xff] |
+            perm->bp_lut[1][(value >> 8) & 0xff] |
+            perm->bp_lut[2][(value >> 16) & 0xff] |
+            perm->bp_lut[3][(value >> 24) & 0xff]);
+}
+
+/*
+ * bit_perm_ignore
+ * ---------------
+ * Returns the specified mask of pins to ignore with its bits permuted.
+ * Bits which no socket bit maps to are also ignored.
+ */
+static pmask_t
+bit_perm_ignore(const bit_perm_t *perm, pmask_t mask)
+{
+    return (bit_perm_word(perm, mask) | ~bit_perm_word(perm, 0xffffffff));
+}
+
+/*
+ * bit_perm_array
+ * --------------
+ * Permute the bits of each of count records in place.
+ */
+static void
+bit_perm_array(const bit_perm_t *perm, pmask_t *data, uint count)
+{
+    uint pos;
+
+    for (pos = 0; pos < count; pos++)
+        data[pos] = bit_perm_word(perm, data[pos]);
+}
+
 /*
  * pin_name
  * --------
@@ -318,13 +462,13 @@ pin_name(uint pin, uint invert)
     invert ^= pinfo[pin].pi_invert;
     if (pinfo[pin].pi_name != NULL) {
         if (invert) {
-            whichbuf ^= whichbuf;
+            whichbuf ^= 1;
             sprintf(buf[whichbuf], "!%s", pinfo[pin].pi_name);
             return (buf[whichbuf]);
         }
         return (pinfo[pin].pi_name);
     }
-    whichbuf ^= whichbuf;
+    whichbuf ^= 1;
     sprintf(buf[whichbuf], "%sP%u", invert ? "!" : "", pinfo[pin].pi_num);
     return (buf[whichbuf]);
 }
@@ -334,14 +478,17 @@ pin_name(uint pin, uint invert)
  * -------------
  * Process a single incoming data line into the pld_in[] (pins driven to
  * the PLD) and pld_out[] (pins driven by the PLD combined with inputs
- * to the PLD).
+ * to the PLD). If the capture includes supply readings, those are
+ * stored in pld_pwr[].
  */
 void
-incoming_data(uint32_t in, uint32_t out)
+incoming_data(pmask_t in, pmask_t out, uint32_t pwr)
 {
     if (read_lines < total_lines) {
         pld_in[read_lines] = in;
         pld_out[read_lines] = out;
+        if (pld_pwr != NULL)
+            pld_pwr[read_lines] = pwr;
     }
     read_lines++;
 }
@@ -366,16 +513,349 @@ bcdbinary(uint32_t value)
              (value & BIT(0)));
 }
 
+/*
+ * read_hazard_records
+ * -------------------
+ * Read hazard capture records produced by the firmware "walk hazard"
+ * option. Each line holds the PLD input before and after a single-bit
+ * transition, the mask of pins which glitched, the settled reading
+ * before the transition, each post-transition sample, and the settled
+ * reading after the transition.
+ */
+static void
+read_hazard_records(FILE *fp, int line_num)
+{
+    char      line[32 + 9 * (HAZARD_MAX_SAMPLES + 5)];
+    uint      hazard_max = 0;
+    uint      pos;
+    char     *ptr;
+    char     *eptr;
+    hazard_t *hz;
+
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        line_num++;
+        if (strstr(line, "---- END ----") != NULL)
+            break;
+        if (hazard_count >= hazard_max) {
+            hazard_max = (hazard_max == 0) ? 256 : hazard_max * 2;
+            hazards = realloc(hazards, hazard_max * sizeof (*hazards));
+            if (hazards == NULL)
+                err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+                    hazard_max * sizeof (*hazards));
+        }
+        hz = &hazards[hazard_count];
+        if (sscanf(line, "%x %x %x", &hz->hz_write_before,
+                   &hz->hz_write_after, &hz->hz_mask) != 3) {
+            warnx("line %u invalid: %s", line_num, line);
+            continue;
+        }
+        ptr = line;
+        for (pos = 0; (pos < 3) && (ptr != NULL); pos++)
+            ptr = strchr(ptr + 1, ' ');
+        for (pos = 0; (ptr != NULL) && (pos < hazard_samples + 2); pos++) {
+            hz->hz_read[pos] = strtoul(ptr, &eptr, 16);
+            if (eptr == ptr)
+                break;
+            ptr = eptr;
+        }
+        if (pos != hazard_samples + 2) {
+            warnx("line %u has %u of %u samples: %s",
+                  line_num, pos, hazard_samples + 2, line);
+            continue;
+        }
+        hazard_count++;
+    }
+}
+
+/*
+ * raw_word
+ * --------
+ * Returns the 32-bit word at the specified byte offset of raw capture
+ * data, which need not be aligned.
+ */
+static uint32_t
+raw_word(const uint8_t *buf, size_t pos)
+{
+    uint32_t value;
+
+    memcpy(&value, buf + pos, sizeof (value));
+    return (value);
+}
+
+/*
+ * raw_walk_vector
+ * ---------------
+ * Returns the input vector of the specified record of a walk, given the
+ * first vector and the pins walked. The walked pins count in binary from
+ * the first vector, lowest pin fastest.
+ */
+static uint32_t
+raw_walk_vector(uint index, uint32_t ref, uint32_t walked)
+{
+    uint32_t diff = 0;
+
+    while ((index != 0) && (walked != 0)) {
+        uint32_t low = walked & -walked;
+        if (index & 1)
+            diff |= low;
+        walked &= ~low;
+        index >>= 1;
+    }
+    return (ref ^ diff);
+}
+
+/*
+ * raw_walk_index
+ * --------------
+ * Returns the record of a walk which has the specified input vector, or
+ * -1 if pins which are not walked differ from the first vector.
+ */
+static int
+raw_walk_index(uint32_t in, uint32_t ref, uint32_t walked)
+{
+    uint32_t diff  = in ^ ref;
+    int      index = 0;
+    uint     pos   = 0;
+
+    if (diff & ~walked)
+        return (-1);
+    while (walked != 0) {
+        uint32_t low = walked & -walked;
+        if (diff & low)
+            index |= 1 << pos;
+        walked &= ~low;
+        pos++;
+    }
+    return (index);
+}
+
+/*
+ * raw_walk_follows
+ * ----------------
+ * Returns non-zero if the records starting at the specified byte offset
+ * follow the walk from the specified record, for RAW_RESYNC_CONFIRM
+ * records or until the end of the walk or of the data.
+ */
+static uint
+raw_walk_follows(const uint8_t *buf, size_t pos, size_t len, size_t rec_size,
+                 uint line, uint lines, uint32_t ref, uint32_t walked)
+{
+    uint count;
+
+    for (count = 0; (count < RAW_RESYNC_CONFIRM) && (line < lines) &&
+                    (pos + rec_size <= len); count++) {
+        if (raw_word(buf, pos) != raw_walk_vector(line, ref, walked))
+            return (0);
+        pos += rec_size;
+        line++;
+    }
+    return (count != 0);
+}
+
+/*
+ * raw_record_add
+ * --------------
+ * Process the raw record at the specified byte offset.
+ */
+static void
+raw_record_add(const uint8_t *buf, size_t pos, size_t rec_size)
+{
+    incoming_data(raw_word(buf, pos), raw_word(buf, pos + 4),
+                  (rec_size > 8) ? raw_word(buf, pos + 8) : 0);
+}
+
+/*
+ * raw_record_lost
+ * ---------------
+ * Add a placeholder for a walk record which was lost in transfer. It
+ * holds the expected input vector, and is skipped by analysis, other
+ * than taking the output of a neighbouring record when collecting terms.
+ */
+static void
+raw_record_lost(uint32_t in)
+{
+    if (pld_lost == NULL) {
+        pld_lost = calloc(total_lines, 1);
+        if (pld_lost == NULL)
+            err(EXIT_FAILURE, "Unable to allocate %u bytes", total_lines);
+    }
+    if (read_lines < total_lines)
+        pld_lost[read_lines] = 1;
+    incoming_data(in, in, 0);
+}
+
+/*
+ * read_raw_records
+ * ----------------
+ * Read the records of a raw binary capture. A byte which the serial link
+ * drops or inserts misaligns every record which follows, so the records
+ * of a plain walk are checked against its counting sequence. The first
+ * record is the starting vector and the last has every walked pin
+ * flipped, which gives the sequence. On a mismatch, the data is scanned
+ * for the next byte offset where records again follow the walk, and the
+ * records between are marked lost so that analysis skips them.
+ */
+static void
+read_raw_records(FILE *fp, size_t rec_size, uint lines, uint check,
+                 const char *filename)
+{
+    uint8_t *buf     = NULL;
+    size_t   alloc   = 0;
+    size_t   len     = 0;
+    size_t   count;
+    size_t   pos;
+    size_t   next;
+    uint32_t ref     = 0;
+    uint32_t walked  = 0;
+    uint     line    = 0;
+    uint     lost    = 0;
+    uint     resyncs = 0;
+    uint     truncated;
+    int      index;
+
+    do {
+        if (len == alloc) {
+            alloc = (alloc == 0) ? 65536 : alloc * 2;
+            buf = realloc(buf, alloc);
+            if (buf == NULL)
+                err(EXIT_FAILURE, "Unable to allocate %zu bytes", alloc);
+        }
+        count = fread(buf + len, 1, alloc - len, fp);
+        len += count;
+    } while (count != 0);
+
+    /*
+     * The trailer might not be aligned. Records can't contain it: only
+     * the low 28 bits of a word carry pins, so the top nibble of every
+     * record word is 0x0, or 0xF where the walk inverts the upper bits
+     * (walk zero or inverted ignored pins). Any 8 bytes span the top byte
+     * of some word, while every trailer byte has a top nibble of 2 or 4.
+     */
+    for (pos = 0; pos + 8 <= len; pos++) {
+        if (memcmp(buf + pos, "---- END", 8) == 0) {
+            len = pos;
+            break;
+        }
+    }
+
+    if (check && (lines >= 2) && (len >= 2 * rec_size)) {
+        ref = raw_word(buf, 0);
+        walked = ref ^ raw_word(buf, len - rec_size);
+        if ((1U << __builtin_popcount(walked)) != lines) {
+            warnx("%s: last record is not the end of a walk; records "
+                  "are not checked", filename);
+            walked = 0;
+        }
+    }
+    if (walked == 0) {
+        for (pos = 0; pos + rec_size <= len; pos += rec_size)
+            raw_record_add(buf, pos, rec_size);
+        free(buf);
+        return;
+    }
+
+    pos = 0;
+    while ((line < lines) && (pos + rec_size <= len)) {
+        next = pos + rec_size;
+        if ((raw_word(buf, pos) == raw_walk_vector(line, ref, walked)) &&
+            ((line + 1 == lines) || (next + rec_size > len) ||
+             (raw_word(buf, next) ==
+              raw_walk_vector(line + 1, ref, walked)))) {
+            raw_record_add(buf, pos, rec_size);
+            pos = next;
+            line++;
+            continue;
+        }
+
+        /* Misaligned: find where the records again follow the walk */
+        for (next = pos + 1; next + rec_size <= len; next++) {
+            index = raw_walk_index(raw_word(buf, next), ref, walked);
+            if ((index >= (int) line) && (index < (int) lines) &&
+                raw_walk_follows(buf, next, len, rec_size, index, lines,
+                                 ref, walked))
+                break;
+        }
+        if (next + rec_size > len)
+            break;
+        if (resyncs++ < RAW_RESYNC_REPORTS) {
+            warnx("%s: record %u misaligned at data offset %zu, "
+                  "resynchronized at record %d offset %zu",
+                  filename, line, pos, index, next);
+        }
+        for (; line < (uint) index; line++, lost++)
+            raw_record_lost(raw_walk_vector(line, ref, walked));
+        pos = next;
+    }
+    truncated = lines - line;
+    for (; line < lines; line++, lost++)
+        raw_record_lost(raw_walk_vector(line, ref, walked));
+    if (lost != 0) {
+        warnx("%s: %u of %u records lost in %u misalignments%s; analysis "
+              "skips them", filename, lost, lines, resyncs,
+              (truncated != 0) ? " and truncation" : "");
+    }
+    free(buf);
+}
+
+/*
+ * read_header_opts
+ * ----------------
+ * Capture the walk options recorded in the header line: the pins which
+ * the walk held at a fixed level, the LFSR seed of a sampled walk, and
+ * the output pins which a classify pre-pass excluded from the walk.
+ */
+static void
+read_header_opts(const char *header)
+{
+    const char *ptr = strstr(header, " HOLD=");
+    uint32_t    mask;
+    uint32_t    value;
+
+    if (ptr != NULL) {
+        if (sscanf(ptr + 6, "%x:%x", &mask, &value) == 2) {
+            hold_mask = mask;
+            hold_value = value;
+        } else {
+            warnx("Invalid hold in header: %s", header);
+            hold_mask = 0;
+        }
+    }
+    hold_value &= hold_mask;
+    if ((ptr != NULL) && (cap_perm != NULL)) {
+        hold_mask = bit_perm_word(cap_perm, hold_mask);
+        hold_value = bit_perm_word(cap_perm, hold_value);
+    }
+
+    ptr = strstr(header, " SAMPLE=");
+    if (ptr != NULL) {
+        if (sscanf(ptr + 8, "%x:%x", &sample_seed, &sample_ignore) != 2)
+            errx(EXIT_FAILURE, "Invalid sample in header: %s", header);
+        if (cap_perm != NULL)
+            sample_ignore = bit_perm_ignore(cap_perm, sample_ignore);
+        sampled = 1;
+    }
+
+    ptr = strstr(header, " CLASSIFY=");
+    if (ptr != NULL) {
+        if (sscanf(ptr + 10, "%x:%x", &mask, &value) != 2)
+            errx(EXIT_FAILURE, "Invalid classify in header: %s", header);
+        walk_outputs = value;
+        if (cap_perm != NULL)
+            walk_outputs = bit_perm_word(cap_perm, walk_outputs);
+    }
+}
+
 /*
  * read_cap_file
  * -------------
  * Read a capture file from disk and process all records present.
  * The beginning and end of the capture is automatically determined
  * based on expected output text from the Brutus firmware, so it's
- * not necessary to manually trim the input file.
+ * not necessary to manually trim the input file. An extension capture
+ * (walk extend=) is appended to the records previously read.
  */
 void
-read_cap_file(const char *filename)
+read_cap_file(const char *filename, uint extension)
 {
     char line[256];
     FILE *fp;
@@ -383,6 +863,9 @@ read_cap_file(const char *filename)
     int line_num = 0;
     int data_line_num = 0;
     int content_type = CONTENT_UNKNOWN;
+    int has_power = 0;
+    uint lines = 0;
+    uint start;
 
     fp = fopen(filename, "r");
     if (fp == NULL)
@@ -397,14 +880,35 @@ read_cap_file(const char *filename)
             uint32_t bytes;
             content_type = CONTENT_RAW_BINARY;
             sscanf(ptr + 11, "%x", &bytes);
-            total_lines = bytes / 8;
+            has_power = (strstr(ptr, " POWER ") != NULL);
+            read_header_opts(ptr);
+            lines = bytes / (has_power ? 12 : 8);
             break;
         }
         ptr = strstr(line, "---- LINES=");
         if (ptr != NULL) {
             /* Content is either hex or binary data */
             content_type = CONTENT_ASCII_UNKNOWN;
-            sscanf(ptr + 11, "%x", &total_lines);
+            sscanf(ptr + 11, "%x", &lines);
+            has_power = (strstr(ptr, " POWER ") != NULL);
+            read_header_opts(ptr);
+            break;
+        }
+        ptr = strstr(line, "---- HAZARDS DELAYS=");
+        if (ptr != NULL) {
+            /* Content is hazard capture records */
+            content_type = CONTENT_HAZARD;
+            ptr += 20;
+            while (hazard_samples < HAZARD_MAX_SAMPLES) {
+                char *eptr;
+                hazard_delays[hazard_samples] = strtoul(ptr, &eptr, 10);
+                if (eptr == ptr)
+                    break;
+                hazard_samples++;
+                if (*eptr != ',')
+                    break;
+                ptr = eptr + 1;
+            }
             break;
         }
     }
@@ -412,23 +916,54 @@ read_cap_file(const char *filename)
     if (content_type == CONTENT_UNKNOWN)
         errx(EXIT_FAILURE, "Could not find start marker in %s", filename);
 
-    pld_in  = malloc(total_lines * 4);
-    pld_out = malloc(total_lines * 4);
+    if (extension != (strstr(line, " EXTEND=") != NULL)) {
+        errx(EXIT_FAILURE, "%s %s a walk extension capture", filename,
+             extension ? "is not" : "is");
+    }
+
+    if (content_type == CONTENT_HAZARD) {
+        if (cap_perm != NULL)
+            errx(EXIT_FAILURE, "A hazard capture may not be remapped");
+        if (hazard_samples == 0)
+            errx(EXIT_FAILURE, "%s: hazard capture has no sample delays",
+                 filename);
+        hazard_capture = 1;
+        read_hazard_records(fp, line_num);
+        fclose(fp);
+        return;
+    }
+
+    if (extension) {
+        if ((pld_pwr != NULL) != has_power)
+            errx(EXIT_FAILURE, "%s: cannot merge captures with and without "
+                 "power readings", filename);
+        if (read_lines > total_lines)
+            read_lines = total_lines;
+    }
+    start = read_lines;
+    total_lines = read_lines + lines;
+    pld_in  = realloc(pld_in, total_lines * sizeof (*pld_in));
+    pld_out = realloc(pld_out, total_lines * sizeof (*pld_out));
     if ((pld_in == NULL) || (pld_out == NULL))
-        err(EXIT_FAILURE, "Unable to allocate %u bytes", total_lines * 4);
+        err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+            total_lines * sizeof (*pld_in));
+    if (has_power) {
+        pld_pwr = realloc(pld_pwr, total_lines * 4);
+        if (pld_pwr == NULL)
+            err(EXIT_FAILURE, "Unable to allocate %u bytes", total_lines * 4);
+    }
+    if (pld_lost != NULL) {
+        pld_lost = realloc(pld_lost, total_lines);
+        if (pld_lost == NULL)
+            err(EXIT_FAILURE, "Unable to allocate %u bytes", total_lines);
+        memset(pld_lost + start, 0, total_lines - start);
+    }
 
     data_line_num = 1;
     if (content_type == CONTENT_RAW_BINARY) {
-        uint32_t buf[2];
-        while (fread(buf, sizeof (buf), 1, fp) == 1) {
-            if ((buf[0] == 0x2d2d2d2d) && (buf[1] == 0x444e4520)) {
-                /* ---- END */
-                break;
-            }
-            incoming_data(buf[0], buf[1]);
-            line_num++;
-            data_line_num++;
-        }
+        /* Sampled and extension walks do not count in binary */
+        read_raw_records(fp, has_power ? 12 : 8, lines,
+                         !sampled && !extension, filename);
     } else {
         /* ASCII unknown content type */
         while (fgets(line, sizeof (line), fp) != NULL) {
@@ -448,9 +983,15 @@ read_cap_file(const char *filename)
                 case CONTENT_ASCII_BINARY: {
                     uint32_t v1a, v1b, v1c, v1d;
                     uint32_t v2a, v2b, v2c, v2d;
-                    if (sscanf(line, "%04x:%08x:%08x:%08x %04x:%08x:%08x:%08x",
-                               &v1a, &v1b, &v1c, &v1d,
-                               &v2a, &v2b, &v2c, &v2d) != 8) {
+                    uint32_t vcc = 0;
+                    uint32_t gnd = 0;
+                    int      pos = 0;
+                    if ((sscanf(line,
+                                "%04x:%08x:%08x:%08x %04x:%08x:%08x:%08x%n",
+                                &v1a, &v1b, &v1c, &v1d,
+                                &v2a, &v2b, &v2c, &v2d, &pos) != 8) ||
+                        (has_power &&
+                         (sscanf(line + pos, "%x %x", &vcc, &gnd) != 2))) {
                         warnx("line %u invalid: %s\n", line_num, line);
                     } else {
                         uint32_t v1 = (bcdbinary(v1a) << 24) |
@@ -461,23 +1002,31 @@ read_cap_file(const char *filename)
                                       (bcdbinary(v2b) << 16) |
                                       (bcdbinary(v2c) << 8) |
                                       (bcdbinary(v2d));
-                        incoming_data(v1, v2);
+                        incoming_data(v1, v2, vcc | (gnd << 16));
                     }
                     break;
                 }
                 case CONTENT_ASCII_HEX: {
-                    uint32_t v1;
-                    uint32_t v2;
-                    if (sscanf(line, "%08x %08x", &v1, &v2) != 2) {
+                    pmask_t  v1;
+                    pmask_t  v2;
+                    uint32_t vcc = 0;
+                    uint32_t gnd = 0;
+                    if (strspn(line, "0123456789abcdefABCDEF") > PM_DIGITS) {
+                        errx(EXIT_FAILURE, "%s has records wider than %u "
+                             "bits%s", filename, PLD_BITS,
+                             (PLD_BITS < 64) ? "; use brutus64" : "");
+                    }
+                    if (sscanf(line, PM_SCAN " " PM_SCAN " %x %x",
+                               &v1, &v2, &vcc, &gnd) < (has_power ? 4 : 2)) {
                         warnx("line %u invalid: %s\n", line_num, line);
                     } else {
-                        incoming_data(v1, v2);
+                        incoming_data(v1, v2, vcc | (gnd << 16));
                     }
                     break;
                 }
             }
             line_num++;
-            if (data_line_num++ == total_lines)
+            if (data_line_num++ == lines)
                 break;
         }
     }
@@ -486,6 +1035,20 @@ read_cap_file(const char *filename)
         warnx("Read %u lines of data, but expected %u lines",
               read_lines, total_lines);
     }
+    if ((cap_perm != NULL) && (read_lines > start)) {
+        uint count = ((read_lines < total_lines) ? read_lines : total_lines) -
+                     start;
+        uint line;
+
+        /* A socket layout only describes the 32 signals of one board */
+        for (line = start; line < start + count; line++) {
+            if ((pld_in[line] | pld_out[line]) & ~(pmask_t) 0xffffffff)
+                errx(EXIT_FAILURE, "%s has signals above 32, which a "
+                     "socket layout (-s) cannot remap", filename);
+        }
+        bit_perm_array(cap_perm, pld_in + start, count);
+        bit_perm_array(cap_perm, pld_out + start, count);
+    }
 }
 
 /*
@@ -576,61 +1139,75 @@ pin_to_bit(uint pin)
 }
 
 /*
- * cfg_device_name
- * ---------------
- * Handle the specified device.
+ * device_layout
+ * -------------
+ * Look up the socket layout (bit to pin table) of the specified device
+ * type. Returns non-zero if the device type is not known.
  */
-static void
-cfg_device_name(char *devname, uint line)
+static int
+device_layout(const char *devname, const uint8_t **layout)
 {
-    char *ptr;
-    uint bit;
-
-    for (ptr = devname; *ptr != '\0'; ptr++) {
-        if (((*ptr < '0') || (*ptr > 'z')) ||
-            ((*ptr > '9') && (*ptr < 'A')) ||
-            ((*ptr > 'Z') && (*ptr < 'a'))) {
-            *ptr = '\0';
-            break;
-        }
-    }
-
     if (strncasecmp(devname, "PLCC20", 6) == 0)
-         bit_to_pin = bit_to_pin_plcc20;
+        *layout = bit_to_pin_plcc20;
     else if (strncasecmp(devname, "PLCC28", 6) == 0)
-         bit_to_pin = bit_to_pin_plcc28;
+        *layout = bit_to_pin_plcc28;
     else if ((strncasecmp(devname, "G22V10", 8) == 0) ||
              (strncasecmp(devname, "GAL22V10", 8) == 0))
-         bit_to_pin = bit_to_pin_g22v10;
+        *layout = bit_to_pin_g22v10;
 #if BOARD_REV >= 2
     else if (strcasecmp(devname, "DIP28") == 0)
-        bit_to_pin = bit_to_pin_dip28;
+        *layout = bit_to_pin_dip28;
     else if (strcasecmp(devname, "DIP26") == 0)
-        bit_to_pin = bit_to_pin_dip26;
+        *layout = bit_to_pin_dip26;
 #endif
     else if (strcasecmp(devname, "DIP24") == 0)
-        bit_to_pin = bit_to_pin_dip24;
+        *layout = bit_to_pin_dip24;
     else if (strcasecmp(devname, "DIP22") == 0)
-        bit_to_pin = bit_to_pin_dip22;
+        *layout = bit_to_pin_dip22;
     else if (strcasecmp(devname, "DIP20") == 0)
-        bit_to_pin = bit_to_pin_dip20;
+        *layout = bit_to_pin_dip20;
     else if (strcasecmp(devname, "DIP18") == 0)
-        bit_to_pin = bit_to_pin_dip18;
+        *layout = bit_to_pin_dip18;
     else if (strcasecmp(devname, "DIP16") == 0)
-        bit_to_pin = bit_to_pin_dip16;
+        *layout = bit_to_pin_dip16;
     else if (strcasecmp(devname, "DIP14") == 0)
-        bit_to_pin = bit_to_pin_dip14;
+        *layout = bit_to_pin_dip14;
     else if (strcasecmp(devname, "DIP12") == 0)
-        bit_to_pin = bit_to_pin_dip12;
+        *layout = bit_to_pin_dip12;
     else if (strcasecmp(devname, "DIP10") == 0)
-        bit_to_pin = bit_to_pin_dip10;
+        *layout = bit_to_pin_dip10;
     else if (strcasecmp(devname, "DIP8") == 0)
-        bit_to_pin = bit_to_pin_dip8;
+        *layout = bit_to_pin_dip8;
     else if (strcasecmp(devname, "DIP6") == 0)
-        bit_to_pin = bit_to_pin_dip6;
+        *layout = bit_to_pin_dip6;
     else if (strcasecmp(devname, "DIP4") == 0)
-        bit_to_pin = bit_to_pin_dip4;
+        *layout = bit_to_pin_dip4;
     else
+        return (-1);
+    return (0);
+}
+
+/*
+ * cfg_device_name
+ * ---------------
+ * Handle the specified device.
+ */
+static void
+cfg_device_name(char *devname, uint line)
+{
+    char *ptr;
+    uint bit;
+
+    for (ptr = devname; *ptr != '\0'; ptr++) {
+        if (((*ptr < '0') || (*ptr > 'z')) ||
+            ((*ptr > '9') && (*ptr < 'A')) ||
+            ((*ptr > 'Z') && (*ptr < 'a'))) {
+            *ptr = '\0';
+            break;
+        }
+    }
+
+    if (device_layout(devname, &bit_to_pin) != 0)
         fatal_cfg(line, line, "invalid device '%s'", devname);
 
     if (bit_to_pin != NULL) {
@@ -821,8 +1398,8 @@ print_cfg_file(void)
         uint pin = 1;
         uint bit;
 
-        for (bit = 0; bit < 32; bit++) {
-            if (ignore_mask & BIT(bit))
+        for (bit = 0; bit < PLD_BITS; bit++) {
+            if ((ignore_mask & ~hold_mask) & BIT(bit))
                 continue;
             printf("PIN %u = %s;\n", pinfo[bit].pi_num, pin_name(bit, 0));
             pin++;
@@ -834,15 +1411,18 @@ print_cfg_file(void)
 /*
  * print_binary
  * ------------
- * Displays a 28-bit value in human-readable binary.
+ * Displays the PLD_SIGNALS bits of a value in human-readable binary,
+ * in groups of eight.
  */
+#define BINARY_WIDTH (PLD_SIGNALS + (PLD_SIGNALS - 1) / 8)  // Characters
+
 static void
-print_binary(uint32_t value)
+print_binary(pmask_t value)
 {
     int bit;
-    for (bit = 27; bit >= 0; bit--) {
+    for (bit = PLD_SIGNALS - 1; bit >= 0; bit--) {
         printf("%d", !!(value & BIT(bit)));
-        if ((bit == 24) || (bit == 16) || (bit == 8))
+        if ((bit != 0) && ((bit & 7) == 0))
             printf(":");
     }
 }
@@ -858,8 +1438,8 @@ static void
 build_ignore_mask(void)
 {
     uint     line;
-    uint32_t saw_0 = 0x00000000;
-    uint32_t saw_1 = 0x00000000;
+    pmask_t  saw_0 = 0;
+    pmask_t  saw_1 = 0;
 
     for (line = 0; line < read_lines; line++) {
         saw_0 |= ~pld_in[line];
@@ -867,7 +1447,11 @@ build_ignore_mask(void)
     }
     ignore_mask = ~(saw_0 & saw_1);
     print_binary(ignore_mask);
-    printf(" ignore_mask = %08x\n", ignore_mask);
+    printf(" ignore_mask = %08" PM_X "\n", ignore_mask);
+    if (hold_mask != 0) {
+        print_binary(hold_value);
+        printf(" held of %07" PM_X "\n", hold_mask);
+    }
 }
 
 /*
@@ -890,7 +1474,7 @@ build_bit_flip_offsets(void)
 {
     uint bit;
     uint nbit = 0;
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         if (ignore_mask & BIT(bit))
             continue;
         bit_flip_pos[bit] = nbit;
@@ -913,29 +1497,31 @@ build_bit_flip_offsets(void)
  * confuse this logic.
  */
 static void
-walk_find_affected(uint32_t *pins_affected_by)
+walk_find_affected(pmask_t *pins_affected_by)
 {
     int      bit;
     uint     line;
     uint     oline;
     uint     count        = 0;
     uint     not_deep     = 0;
-    uint32_t cur_mask     = 0;
-    uint32_t last_write_mask;
-    uint32_t last_read_mask;
-    uint32_t rdiff_mask;
-    uint32_t wdiff_mask;
-    uint32_t write_mask;
-    uint32_t main_write_mask;
-    uint32_t read_mask;
+    pmask_t  cur_mask     = 0;
+    pmask_t  last_write_mask;
+    pmask_t  last_read_mask;
+    pmask_t  rdiff_mask;
+    pmask_t  wdiff_mask;
+    pmask_t  write_mask;
+    pmask_t  main_write_mask;
+    pmask_t  read_mask;
 
     cur_mask = 0;
     for (line = 0; line < total_lines; line++) {
-        for (bit = 0; bit < 28; bit++) {
+        for (bit = 0; bit < PLD_SIGNALS; bit++) {
             if (ignore_mask & BIT(bit))
                 continue;
 
             oline = line ^ BIT(bit_flip_pos[bit]);
+            if (LINE_LOST(line) || LINE_LOST(oline))
+                continue;
             /* Calculate pins that were affected by this pin */
             rdiff_mask = (pld_out[line] ^ pld_out[oline]);
             if (pins_always_input & BIT(bit))
@@ -968,7 +1554,7 @@ walk_find_affected(uint32_t *pins_affected_by)
  * run.
  */
 static uint
-bit_count(uint32_t mask)
+bit_count(pmask_t mask)
 {
     uint count = 0;
     while (mask != 0) {
@@ -979,6 +1565,94 @@ bit_count(uint32_t mask)
     return (count);
 }
 
+/*
+ * merge_extensions
+ * ----------------
+ * Reorder the records of a capture and its walk extensions into the
+ * binary counting order of the combined walk, as build_bit_flip_offsets()
+ * requires. This is also needed after a capture is remapped to device
+ * pin order, as the walked bits then count in a different order. The
+ * first record of the base capture is the walk's starting vector, so
+ * the position of each record is given by the walked pins which differ
+ * from it. Every vector must be present exactly once.
+ */
+static void
+merge_extensions(void)
+{
+    uint      line;
+    uint      bit;
+    uint      count;
+    pmask_t   saw_0 = 0;
+    pmask_t   saw_1 = 0;
+    pmask_t   walked;
+    pmask_t   ref = pld_in[0];
+    pmask_t  *in;
+    pmask_t  *out;
+    uint32_t *pwr = NULL;
+    uint8_t  *lost = NULL;
+    uint8_t  *seen;
+
+    if (read_lines > total_lines)
+        read_lines = total_lines;
+    for (line = 0; line < read_lines; line++) {
+        saw_0 |= ~pld_in[line];
+        saw_1 |= pld_in[line];
+    }
+    walked = saw_0 & saw_1;
+    count = 1 << bit_count(walked);
+
+    in   = malloc(count * sizeof (*in));
+    out  = malloc(count * sizeof (*out));
+    seen = calloc(count, 1);
+    if (pld_pwr != NULL)
+        pwr = malloc(count * 4);
+    if (pld_lost != NULL)
+        lost = malloc(count);
+    if ((in == NULL) || (out == NULL) || (seen == NULL) ||
+        ((pld_pwr != NULL) && (pwr == NULL)) ||
+        ((pld_lost != NULL) && (lost == NULL)))
+        err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+            count * sizeof (*in));
+
+    for (line = 0; line < read_lines; line++) {
+        pmask_t  diff = pld_in[line] ^ ref;
+        uint     pos = 0;
+        uint     index = 0;
+        for (bit = 0; bit < PLD_BITS; bit++) {
+            if ((walked & BIT(bit)) == 0)
+                continue;
+            if (diff & BIT(bit))
+                index |= BIT(pos);
+            pos++;
+        }
+        if (seen[index])
+            errx(EXIT_FAILURE, "Vector %07" PM_X " appears more than once "
+                 "in the merged captures", pld_in[line]);
+        seen[index] = 1;
+        in[index] = pld_in[line];
+        out[index] = pld_out[line];
+        if (pwr != NULL)
+            pwr[index] = pld_pwr[line];
+        if (lost != NULL)
+            lost[index] = pld_lost[line];
+    }
+    if (read_lines != count) {
+        errx(EXIT_FAILURE, "Merged captures have %u of the %u vectors of "
+             "walking %u pins", read_lines, count, bit_count(walked));
+    }
+    printf("Merged %u vectors walking %u pins\n", count, bit_count(walked));
+
+    free(pld_in);
+    free(pld_out);
+    free(pld_pwr);
+    free(pld_lost);
+    free(seen);
+    pld_in = in;
+    pld_out = out;
+    pld_pwr = pwr;
+    pld_lost = lost;
+}
+
 /*
  * print_ent
  * ---------
@@ -1005,7 +1679,7 @@ print_ents(void)
 {
     uint bit;
     uint cur;
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         for (cur = 0; cur < pinfo[bit].pi_count; cur++) {
             if (pinfo[bit].pi_ent[cur].pie_affecting_bits == 0)
                 continue;
@@ -1019,14 +1693,19 @@ print_ents(void)
  * print_ent_ops
  * -------------
  * Displays a single output pin and the logic required to generate that output.
+ * Input pins which were held at a fixed level during the walk are included
+ * as literals, since the term was only observed with them at that level.
  */
 static void
-print_ent_ops(uint32_t affecting_bits, uint32_t input_bits)
+print_ent_ops(pmask_t affecting_bits, pmask_t input_bits)
 {
-    uint bit;
-    uint printed = 0;
+    uint     bit;
+    uint     printed = 0;
+    pmask_t  held = hold_mask & ~pins_output;
 
-    for (bit = 0; bit < 32; bit++) {
+    affecting_bits |= held;
+    input_bits = (input_bits & ~held) | (hold_value & held);
+    for (bit = 0; bit < PLD_BITS; bit++) {
         if (affecting_bits & BIT(bit)) {
             if (printed)
                 printf(" & ");
@@ -1049,10 +1728,10 @@ print_ents_as_ops(uint result_bit)
 {
     uint        bit;
     uint        cur;
-    uint32_t    affecting_bits;
+    pmask_t     affecting_bits;
     const char *indent = (result_bit == 0) ? "   " : "";
 
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         uint        search_bit = result_bit ^ pinfo[bit].pi_invert;
         const char *pname = pin_name(bit, search_bit == 0);
         uint        pname_len = strlen(pname);
@@ -1102,7 +1781,7 @@ print_ents_as_ops(uint result_bit)
  * pin. It automatically filters out duplicates.
  */
 static void
-add_or_mask(uint bit, uint bit_state, uint32_t input_bits, uint line)
+add_or_mask(uint bit, uint bit_state, pmask_t input_bits, uint line)
 {
     uint cur;
 
@@ -1158,7 +1837,7 @@ show_counts(void)
 {
     uint bit;
     printf("Counts:");
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         if (pinfo[bit].pi_count > 0) {
             printf(" %s=%u", pin_name(bit, 0), pinfo[bit].pi_count);
         }
@@ -1166,6 +1845,30 @@ show_counts(void)
     printf("\n");
 }
 
+/*
+ * lost_line_stand_in
+ * ------------------
+ * Returns a line which was not lost in transfer and which differs from
+ * the specified lost line only in a pin which does not affect the
+ * specified output, or -1 if there is none. Its output stands in for
+ * the lost record, so that terms are collected in walk order.
+ */
+static int
+lost_line_stand_in(uint line, uint bit)
+{
+    uint pin;
+    uint oline;
+
+    for (pin = 0; pin < PLD_BITS; pin++) {
+        if ((ignore_mask | pins_affecting_pin[bit]) & BIT(pin))
+            continue;
+        oline = line ^ BIT(bit_flip_pos[pin]);
+        if ((oline < read_lines) && !LINE_LOST(oline))
+            return (oline);
+    }
+    return (-1);
+}
+
 /*
  * collect_or_masks
  * ----------------
@@ -1188,7 +1891,7 @@ collect_or_masks(void)
     uint bit;
 
     /* Allocate memory for or masks */
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         uint32_t bitcount;
         if (ignore_mask & BIT(bit))
             continue;
@@ -1204,9 +1907,10 @@ collect_or_masks(void)
     }
 
     for (line = 0; line < read_lines; line++) {
-        uint32_t write_mask = pld_in[line];
-        uint32_t read_mask  = pld_out[line];
-        for (bit = 0; bit < 32; bit++) {
+        pmask_t  write_mask = pld_in[line];
+        pmask_t  read_mask  = pld_out[line];
+        for (bit = 0; bit < PLD_BITS; bit++) {
+            uint oline = line;
             if (ignore_mask & BIT(bit))
                 continue;
             if ((pins_output & BIT(bit)) == 0)
@@ -1215,7 +1919,13 @@ collect_or_masks(void)
             if ((bit & LIMIT_BITS) == 0)
                 continue;
 #endif
-            add_or_mask(bit, !!(pld_out[line] & BIT(bit)),
+            if (LINE_LOST(line)) {
+                int stand_in = lost_line_stand_in(line, bit);
+                if (stand_in < 0)
+                    continue;
+                oline = stand_in;
+            }
+            add_or_mask(bit, !!(pld_out[oline] & BIT(bit)),
                         pld_in[line] & pins_affecting_pin[bit], line);
         }
     }
@@ -1233,7 +1943,7 @@ collapse_duplicates(void)
     uint bit;
 
     /* Collapse all duplicates */
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         uint pi_count = pinfo[bit].pi_count;
         uint cur;
         uint scur = 0;
@@ -1263,7 +1973,7 @@ merge_or_masks(void)
     uint bit;
     uint pin;
 
-    for (bit = 0; bit < 32; bit++) {
+    for (bit = 0; bit < PLD_BITS; bit++) {
         if (ignore_mask & BIT(bit))
             continue;
         if ((pins_output & BIT(bit)) == 0)
@@ -1280,10 +1990,10 @@ merge_or_masks(void)
          * in the affecting_bits mask. In the next stage, those duplicates
          * will be joined.
          */
-        for (pin = 0; pin < 32; pin++) {
-            uint scur;
-            uint cur;
-            uint pinmask = BIT(pin);
+        for (pin = 0; pin < PLD_BITS; pin++) {
+            uint    scur;
+            uint    cur;
+            pmask_t pinmask = BIT(pin);
             if (ignore_mask & BIT(bit))
                 continue;
             if ((pins_affecting_pin[bit] & BIT(pin)) == 0)
@@ -1350,7 +2060,7 @@ eliminate_common_terms(void)
      *    # P4             (because if P3, then true; otherwise it's !P3)
      *                     (because if P3, then P5 is irrelevant)
      */
-    for (pin = 0; pin < 32; pin++) {
+    for (pin = 0; pin < PLD_BITS; pin++) {
         if (ignore_mask & BIT(pin))
             continue;
         if ((pins_output & BIT(pin)) == 0)
@@ -1359,8 +2069,8 @@ eliminate_common_terms(void)
             continue;
         for (cur = 0; cur < pinfo[pin].pi_count; cur++) {
             uint32_t top_result = pinfo[pin].pi_ent[cur].pie_result_bit;
-            uint32_t top_aff    = pinfo[pin].pi_ent[cur].pie_affecting_bits;
-            uint32_t top_input  = (pinfo[pin].pi_ent[cur].pie_input_bits &
+            pmask_t  top_aff    = pinfo[pin].pi_ent[cur].pie_affecting_bits;
+            pmask_t  top_input  = (pinfo[pin].pi_ent[cur].pie_input_bits &
                                    top_aff);
 
             if (top_aff == 0)
@@ -1499,10 +2209,10 @@ is_contained_within(uint supbit, uint subbit, uint result_bit)
      *          SUPER = P1 & P3
      *                # P2;
      */
-    uint supcur;
-    uint subcur;
-    uint affecting = 0;
-    uint matched = 0;
+    uint    supcur;
+    uint    subcur;
+    pmask_t affecting = 0;
+    uint    matched = 0;
 
     for (subcur = 0; subcur < pinfo[subbit].pi_count; subcur++) {
         if (pinfo[subbit].pi_ent[subcur].pie_result_bit != result_bit)
@@ -1583,7 +2293,7 @@ merge_common_subexpression(uint supbit, uint subbit, uint result_bit)
      */
     uint supcur;
     uint subcur;
-    uint32_t sub_affecting;
+    pmask_t  sub_affecting;
 
     for (subcur = 0; subcur < pinfo[subbit].pi_count; subcur++) {
         if (pinfo[subbit].pi_ent[subcur].pie_result_bit != result_bit)
@@ -1674,14 +2384,14 @@ merge_common_subexpressions(void)
      * P26.OE = P25;
      */
 
-    for (supbit = 0; supbit < 32; supbit++) {
+    for (supbit = 0; supbit < PLD_BITS; supbit++) {
         if (ignore_mask & BIT(supbit))
             continue;
         if ((pins_output & BIT(supbit)) == 0)
             continue;
         if (pinfo[supbit].pi_count == 0)
             continue;
-        for (subbit = 0; subbit < 32; subbit++) {
+        for (subbit = 0; subbit < PLD_BITS; subbit++) {
             if (supbit == subbit)
                 continue;
             if (ignore_mask & BIT(subbit))
@@ -1721,13 +2431,13 @@ analyze(void)
     uint     bit;
     uint     pin;
     uint     printed = 0;
-    uint32_t pins_touched          = 0;
-    uint32_t pins_always_low       = 0xffffffff;
-    uint32_t pins_always_high      = 0xffffffff;
-    uint32_t pins_affected_by[32];
+    pmask_t  pins_touched          = 0;
+    pmask_t  pins_always_low       = PM_ALL;
+    pmask_t  pins_always_high      = PM_ALL;
+    pmask_t  pins_affected_by[PLD_BITS];
 
-    pins_only_output_high = 0xffffffff;
-    pins_only_output_low  = 0xffffffff;
+    pins_only_output_high = PM_ALL;
+    pins_only_output_low  = PM_ALL;
 
     build_ignore_mask();
     build_bit_flip_offsets();
@@ -1736,8 +2446,10 @@ analyze(void)
     memset(pins_affecting_pin, 0, sizeof (pins_affecting_pin));
 
     for (line = 0; line < read_lines; line++) {
-        uint32_t write_mask = pld_in[line];
-        uint32_t read_mask  = pld_out[line];
+        pmask_t  write_mask = pld_in[line];
+        pmask_t  read_mask  = pld_out[line];
+        if (LINE_LOST(line))
+            continue;
         pins_touched          |= write_mask;
         pins_always_low       &= ~read_mask;
         pins_always_high      &= read_mask;
@@ -1784,11 +2496,26 @@ analyze(void)
     printf(" open drain: only drives high\n");
 
     walk_find_affected(pins_affected_by);
-    for (bit = 0; bit < 28; bit++) {
-        uint32_t mask = BIT(bit);
-        uint32_t pins_affecting = 0;
 
-        for (pin = 0; pin < 28; pin++) {
+    /*
+     * Output pins which the classify pre-pass did not walk were never
+     * toggled, but still need equations. Only walked pins can affect
+     * them, so they are no longer ignored once the affected pins are
+     * known. As they were never driven both ways, they can not be shown
+     * to be open drain.
+     */
+    if (walk_outputs != 0) {
+        ignore_mask &= ~walk_outputs;
+        pins_only_output_low  &= ~walk_outputs;
+        pins_only_output_high &= ~walk_outputs;
+        print_binary(walk_outputs & pins_output);
+        printf(" output, not walked\n");
+    }
+    for (bit = 0; bit < PLD_SIGNALS; bit++) {
+        pmask_t  mask = BIT(bit);
+        pmask_t  pins_affecting = 0;
+
+        for (pin = 0; pin < PLD_SIGNALS; pin++) {
             if (pins_affected_by[pin] & mask)
                 pins_affecting |= BIT(pin);
         }
@@ -1802,7 +2529,7 @@ analyze(void)
                 print_binary(pins_affecting);
                 printf(" ->");
             } else {
-                printf("%34s", "");
+                printf("%*s", BINARY_WIDTH + 3, "");
             }
             printf(" Pin%-2u", bit + 1);
             if (pins_affected_by[bit] != 0) {
@@ -1814,6 +2541,645 @@ analyze(void)
     }
 }
 
+/*
+ * print_hazard_report
+ * -------------------
+ * Summarize a hazard capture. Each glitching output pin is listed with
+ * counts of static-0 (0 -> 1 -> 0), static-1 (1 -> 0 -> 1), and dynamic
+ * (multiple changes toward a new value) hazards, along with the input
+ * pins whose transitions caused them. Every individual hazard is then
+ * shown as a waveform of the pin across the settled reading before the
+ * transition, each post-transition sample, and the settled reading after.
+ */
+static void
+print_hazard_report(void)
+{
+    uint      bit;
+    uint      pos;
+    uint      cur;
+    uint      static0[32];
+    uint      static1[32];
+    uint      dynamic[32];
+    uint32_t  triggers[32];
+    hazard_t *hz;
+
+    memset(static0, 0, sizeof (static0));
+    memset(static1, 0, sizeof (static1));
+    memset(dynamic, 0, sizeof (dynamic));
+    memset(triggers, 0, sizeof (triggers));
+
+    printf("Hazard capture: %u transitions with glitches\n", hazard_count);
+    printf("Sample delays (ns): before");
+    for (pos = 0; pos < hazard_samples; pos++)
+        printf(" %u", hazard_delays[pos]);
+    printf(" after\n");
+    if (hazard_count == 0)
+        return;
+
+    for (cur = 0; cur < hazard_count; cur++) {
+        hz = &hazards[cur];
+        for (bit = 0; bit < 32; bit++) {
+            uint32_t before;
+            uint32_t after;
+            if ((hz->hz_mask & BIT(bit)) == 0)
+                continue;
+            before = hz->hz_read[0] & BIT(bit);
+            after  = hz->hz_read[hazard_samples + 1] & BIT(bit);
+            if (before != after)
+                dynamic[bit]++;
+            else if (before != 0)
+                static1[bit]++;
+            else
+                static0[bit]++;
+            triggers[bit] |= hz->hz_write_before ^ hz->hz_write_after;
+        }
+    }
+
+    printf("\n%-8s %8s %8s %8s  %s\n",
+           "Pin", "Static-0", "Static-1", "Dynamic", "Triggered by");
+    for (bit = 0; bit < 32; bit++) {
+        uint tbit;
+        if (static0[bit] + static1[bit] + dynamic[bit] == 0)
+            continue;
+        printf("%-8s %8u %8u %8u ", pin_name(bit, 0),
+               static0[bit], static1[bit], dynamic[bit]);
+        for (tbit = 0; tbit < 32; tbit++)
+            if (triggers[bit] & BIT(tbit))
+                printf(" %s", pin_name(tbit, 0));
+        printf("\n");
+    }
+
+    printf("\n");
+    for (cur = 0; cur < hazard_count; cur++) {
+        uint32_t tmask;
+        uint     tbit;
+        hz = &hazards[cur];
+        tmask = hz->hz_write_before ^ hz->hz_write_after;
+        for (tbit = 0; tbit < 32; tbit++)
+            if (tmask & BIT(tbit))
+                break;
+        for (bit = 0; bit < 32; bit++) {
+            if ((hz->hz_mask & BIT(bit)) == 0)
+                continue;
+            printf("%07x %s %s: %-8s ", hz->hz_write_before,
+                   pin_name(tbit, 0),
+                   (hz->hz_write_after & tmask) ? "rise" : "fall",
+                   pin_name(bit, 0));
+            for (pos = 0; pos < hazard_samples + 2; pos++)
+                printf("%c", (hz->hz_read[pos] & BIT(bit)) ? '1' : '0');
+            printf("\n");
+        }
+    }
+}
+
+#define POWER_REPORT_GROUPS 10   // Output states to show in power report
+
+static pmask_t  power_key_mask;  // Output pins which form a power group
+
+/*
+ * sample_lfsr_next
+ * ----------------
+ * Advance the sampled walk LFSR by 32 steps, as the firmware does for
+ * each vector of a sampled walk.
+ */
+static uint32_t
+sample_lfsr_next(uint32_t state)
+{
+    uint bit;
+
+    for (bit = 0; bit < 32; bit++)
+        state = (state >> 1) ^ (-(state & 1) & SAMPLE_LFSR_TAPS);
+    return (state);
+}
+
+/*
+ * check_sample_vectors
+ * --------------------
+ * Regenerate the input vectors of a sampled walk from the LFSR seed and
+ * record index, and report records which do not match. The walked pins
+ * are either all as generated, or all inverted (walk zero).
+ */
+static void
+check_sample_vectors(void)
+{
+    uint     line;
+    uint     mismatches = 0;
+    uint32_t state  = sample_seed;
+    pmask_t  walked = ~sample_ignore;
+    pmask_t  polarity = 0;
+
+    for (line = 0; line < read_lines; line++) {
+        pmask_t  diff;
+        pmask_t  vector;
+        state = sample_lfsr_next(state);
+        vector = (cap_perm != NULL) ? bit_perm_word(cap_perm, state) : state;
+        diff = (pld_in[line] ^ vector) & walked;
+        if (line == 0)
+            polarity = diff;
+        if ((diff != polarity) || ((diff != 0) && (diff != walked))) {
+            if (mismatches++ < 8) {
+                warnx("record %u input %08" PM_X " is not sample vector "
+                      "%08" PM_X,
+                      line, pld_in[line], (vector ^ polarity) & walked);
+            }
+        }
+    }
+    if (mismatches != 0)
+        warnx("%u of %u records do not match the sample sequence",
+              mismatches, read_lines);
+}
+
+typedef struct {
+    pmask_t  sr_support;     // Pins the output was found to depend upon
+    uint     sr_conflicts;   // Records not explained by the support
+    uint     sr_observed;    // Truth table entries observed
+    uint     sr_cubes;       // Number of product terms
+    uint16_t sr_care[256];   // Product term: support bits which matter
+    uint16_t sr_value[256];  // Product term: value of those bits
+} sample_result_t;
+
+/*
+ * sample_index
+ * ------------
+ * Compress the support pins of an input vector to a truth table index.
+ */
+static uint
+sample_index(pmask_t in, pmask_t support)
+{
+    uint bit;
+    uint pos = 0;
+    uint index = 0;
+
+    for (bit = 0; bit < PLD_BITS; bit++) {
+        if ((support & BIT(bit)) == 0)
+            continue;
+        if (in & BIT(bit))
+            index |= BIT(pos);
+        pos++;
+    }
+    return (index);
+}
+
+static int
+key_compare(const void *ap, const void *bp)
+{
+    pmask_t a = *(const pmask_t *) ap;
+    pmask_t b = *(const pmask_t *) bp;
+    return ((a < b) ? -1 : (a > b));
+}
+
+/*
+ * sample_split
+ * ------------
+ * Group the records (every step'th record from start) by their value on
+ * the support pins, and measure how well the groups determine the output
+ * pin. Returns the number of records which disagree with the majority of
+ * their group. The Gini impurity summed over the groups is stored in
+ * *impurity, and in *chance the impurity which splitting each group by
+ * one more irrelevant pin would be expected to remove.
+ */
+static uint
+sample_split(uint bit, pmask_t support, uint start, uint step,
+             pmask_t *keys, double *impurity, double *chance)
+{
+    uint line;
+    uint count = 0;
+    uint cur;
+    uint next;
+    uint conflicts = 0;
+
+    for (line = start; line < read_lines; line += step)
+        keys[count++] = ((pld_in[line] & support) << 1) |
+                        !!(pld_out[line] & BIT(bit));
+    qsort(keys, count, sizeof (*keys), key_compare);
+    *impurity = 0;
+    *chance = 0;
+    for (cur = 0; cur < count; cur = next) {
+        uint ones = 0;
+        uint zeros;
+        uint n;
+        for (next = cur; (next < count) &&
+                         ((keys[next] >> 1) == (keys[cur] >> 1)); next++)
+            ones += keys[next] & 1;
+        n = next - cur;
+        zeros = n - ones;
+        conflicts += (ones < zeros) ? ones : zeros;
+        *impurity += 2.0 * ones * zeros / n;
+        *chance += 2.0 * ones * zeros / ((double) n * n);
+    }
+    return (conflicts);
+}
+
+/*
+ * sample_cube_has_off
+ * -------------------
+ * Determine whether any truth table entry within a product term was
+ * observed low.
+ */
+static uint
+sample_cube_has_off(const uint8_t *table, uint value, uint care, uint all)
+{
+    uint span = all & ~care;
+    uint sub = 0;
+
+    do {
+        if (table[(value & care) | sub] == 1)
+            return (1);
+        sub = (sub - span) & span;
+    } while (sub != 0);
+    return (0);
+}
+
+/*
+ * sample_infer
+ * ------------
+ * Infer the logic of one output pin from the sampled records. The
+ * support is grown greedily by the input (or pair of inputs, for XOR
+ * terms) which best explains the output, until no conflicts remain.
+ * A candidate must remove several times the impurity which an irrelevant
+ * input would remove by chance, so that inputs are not taken only because
+ * the records happen to split well. The value driven to the pin itself
+ * is a candidate, as a tri-state output reads back that value when not
+ * enabled. The observed truth table over the support is then minimized,
+ * with the unobserved entries as don't-cares: each uncovered ON entry is
+ * expanded into the largest product term which contains no observed OFF
+ * entry.
+ */
+static void
+sample_infer(uint bit, pmask_t inputs, uint start, uint step,
+             pmask_t *keys, sample_result_t *res)
+{
+    pmask_t  support = 0;
+    uint     conflicts;
+    uint     nbits;
+    uint     entries;
+    uint     index;
+    uint     line;
+    uint8_t *table;
+    double   impurity;
+    double   chance;
+    double   imp;
+    double   unused;
+
+    conflicts = sample_split(bit, 0, start, step, keys, &impurity, &chance);
+    inputs |= BIT(bit);
+    while ((conflicts != 0) && (bit_count(support) < SAMPLE_MAX_SUPPORT)) {
+        pmask_t  best_add = 0;
+        double   best = impurity - SAMPLE_SIGNIFICANCE * chance;
+        uint     b1;
+        uint     b2;
+        for (b1 = 0; b1 < PLD_BITS; b1++) {
+            if ((inputs & ~support & BIT(b1)) == 0)
+                continue;
+            (void) sample_split(bit, support | BIT(b1), start, step, keys,
+                                &imp, &unused);
+            if (imp < best) {
+                best = imp;
+                best_add = BIT(b1);
+            }
+        }
+        if ((best_add == 0) &&
+            (bit_count(support) + 2 <= SAMPLE_MAX_SUPPORT)) {
+            /* A pair splits each group three ways more */
+            best = impurity - 3 * SAMPLE_SIGNIFICANCE * chance;
+            for (b1 = 0; b1 < PLD_BITS; b1++) {
+                if ((inputs & ~support & BIT(b1)) == 0)
+                    continue;
+                for (b2 = b1 + 1; b2 < PLD_BITS; b2++) {
+                    if ((inputs & ~support & BIT(b2)) == 0)
+                        continue;
+                    (void) sample_split(bit, support | BIT(b1) | BIT(b2),
+                                        start, step, keys, &imp, &unused);
+                    if (imp < best) {
+                        best = imp;
+                        best_add = BIT(b1) | BIT(b2);
+                    }
+                }
+            }
+        }
+        if (best_add == 0)
+            break;  // Not explained by the inputs (registered logic?)
+        support |= best_add;
+        conflicts = sample_split(bit, support, start, step, keys,
+                                 &impurity, &chance);
+    }
+
+    /* Truth table: 0 = unobserved, 1 = observed low, 2 = observed high */
+    nbits = bit_count(support);
+    entries = 1 << nbits;
+    table = calloc(entries, 1);
+    if (table == NULL)
+        err(EXIT_FAILURE, "Unable to allocate %u bytes", entries);
+    res->sr_observed = 0;
+    for (line = start; line < read_lines; line += step) {
+        index = sample_index(pld_in[line], support);
+        if (table[index] == 0)
+            res->sr_observed++;
+        table[index] = (pld_out[line] & BIT(bit)) ? 2 : 1;
+    }
+
+    res->sr_support = support;
+    res->sr_conflicts = conflicts;
+    res->sr_cubes = 0;
+    for (index = 0; index < entries; index++) {
+        uint care = entries - 1;
+        uint var;
+        uint span;
+        uint sub = 0;
+        if (table[index] != 2)
+            continue;
+        for (var = 0; var < nbits; var++) {
+            if (!sample_cube_has_off(table, index, care & ~BIT(var),
+                                     entries - 1))
+                care &= ~BIT(var);
+        }
+        if (res->sr_cubes == ARRAY_SIZE(res->sr_care)) {
+            warnx("%s: more than %u terms", pin_name(bit, 0), res->sr_cubes);
+            break;
+        }
+        res->sr_care[res->sr_cubes] = care;
+        res->sr_value[res->sr_cubes] = index & care;
+        res->sr_cubes++;
+
+        /* Entries covered by this term need no term of their own */
+        span = (entries - 1) & ~care;
+        do {
+            if (table[(index & care) | sub] == 2)
+                table[(index & care) | sub] = 3;
+            sub = (sub - span) & span;
+        } while (sub != 0);
+    }
+    free(table);
+}
+
+/*
+ * sample_predict
+ * --------------
+ * Evaluate the inferred product terms of an output for an input vector.
+ */
+static uint
+sample_predict(const sample_result_t *res, pmask_t in)
+{
+    uint index = sample_index(in, res->sr_support);
+    uint cube;
+
+    for (cube = 0; cube < res->sr_cubes; cube++)
+        if ((index & res->sr_care[cube]) == res->sr_value[cube])
+            return (1);
+    return (0);
+}
+
+/*
+ * analyze_sampled
+ * ---------------
+ * Infer equations from a sampled walk capture, which holds a random
+ * subset of the input vectors. For each output, the logic is first
+ * inferred from the even records and checked against the odd records,
+ * giving an estimate of how well the equation predicts vectors which
+ * were not observed. The equation is then inferred from all records.
+ */
+static void
+analyze_sampled(void)
+{
+    uint      line;
+    uint      bit;
+    pmask_t   inputs;
+    pmask_t   outputs = 0;
+    pmask_t  *keys;
+    static sample_result_t res;
+
+    check_sample_vectors();
+    for (line = 0; line < read_lines; line++)
+        outputs |= pld_in[line] ^ pld_out[line];
+    outputs &= 0x0fffffff;
+    inputs = ~sample_ignore & 0x0fffffff & ~outputs;
+    pins_output = outputs;
+
+    printf("Sampled capture: %u vectors, LFSR seed %08x\n",
+           read_lines, sample_seed);
+    print_binary(inputs);
+    printf(" input\n");
+    print_binary(outputs);
+    printf(" output\n");
+
+    keys = malloc(read_lines * sizeof (*keys));
+    if (keys == NULL)
+        err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+            read_lines * sizeof (*keys));
+
+    ignore_mask = ~(inputs | outputs);
+    print_cfg_file();
+    printf("\n");
+    for (bit = 0; bit < 28; bit++) {
+        char pname[40];
+        uint cube;
+        uint tested = 0;
+        uint agree = 0;
+        uint var;
+        uint pos;
+
+        if ((outputs & BIT(bit)) == 0)
+            continue;
+
+        /* Cross-check: infer from even records, test on odd records */
+        sample_infer(bit, inputs, 0, 2, keys, &res);
+        for (line = 1; line < read_lines; line += 2) {
+            tested++;
+            if (sample_predict(&res, pld_in[line]) ==
+                !!(pld_out[line] & BIT(bit)))
+                agree++;
+        }
+
+        sample_infer(bit, inputs, 0, 1, keys, &res);
+        snprintf(pname, sizeof (pname), "%s", pin_name(bit, 0));
+        printf("/* %s: %u inputs, %u of %u table entries observed",
+               pname, bit_count(res.sr_support), res.sr_observed,
+               1 << bit_count(res.sr_support));
+        if (tested != 0) {
+            printf(", %u.%u%% of %u held-out vectors predicted",
+                   agree * 100 / tested, agree * 1000 / tested % 10, tested);
+        }
+        if (res.sr_conflicts != 0)
+            printf(", %u records unexplained", res.sr_conflicts);
+        printf(" */\n");
+
+        if (res.sr_cubes == 0) {
+            printf("%s = 'b'0;\n", pname);
+            continue;
+        }
+        for (cube = 0; cube < res.sr_cubes; cube++) {
+            pmask_t  affecting = 0;
+            pmask_t  input = 0;
+            if (cube == 0)
+                printf("%s = ", pname);
+            else
+                printf("\n%*s # ", (int) strlen(pname), "");
+            for (var = 0, pos = 0; var < PLD_BITS; var++) {
+                if ((res.sr_support & BIT(var)) == 0)
+                    continue;
+                if (res.sr_care[cube] & BIT(pos)) {
+                    affecting |= BIT(var);
+                    if (res.sr_value[cube] & BIT(pos))
+                        input |= BIT(var);
+                }
+                pos++;
+            }
+            if ((affecting | (hold_mask & ~pins_output)) == 0)
+                printf("'b'1");
+            else
+                print_ent_ops(affecting, input);
+        }
+        printf(";\n");
+    }
+    free(keys);
+}
+
+/*
+ * power_line_compare
+ * ------------------
+ * qsort() comparison function which orders capture lines by the state
+ * of output pins, then by PLD VCC reading.
+ */
+static int
+power_line_compare(const void *ap, const void *bp)
+{
+    uint     a = *(const uint *) ap;
+    uint     b = *(const uint *) bp;
+    pmask_t  akey = pld_out[a] & power_key_mask;
+    pmask_t  bkey = pld_out[b] & power_key_mask;
+
+    if (akey != bkey)
+        return ((akey < bkey) ? -1 : 1);
+    if ((pld_pwr[a] & 0xffff) != (pld_pwr[b] & 0xffff))
+        return (((pld_pwr[a] & 0xffff) < (pld_pwr[b] & 0xffff)) ? -1 : 1);
+    return (0);
+}
+
+/*
+ * analyze_power
+ * -------------
+ * Report supply readings captured with the walk "power" option. Lines
+ * are grouped by the state of the output pins. Within a group, the
+ * pins are identical, so variation in PLD VCC or PLD GND readings beyond
+ * ADC noise suggests internal state (registered or buried nodes) which
+ * is not visible at the pins. For the groups with the largest variation,
+ * the input pins which best correlate with the readings are shown.
+ */
+static void
+analyze_power(void)
+{
+    uint    *order;
+    uint     line;
+    uint     start;
+    uint     end;
+    uint     cur;
+    uint     bit;
+    uint     lines = 0;
+    uint     groups = 0;
+    uint     shown;
+    struct {
+        uint start;
+        uint end;
+        uint spread;
+    } top[POWER_REPORT_GROUPS];
+
+    if ((pld_pwr == NULL) || (read_lines == 0))
+        return;
+
+    power_key_mask = pins_output;
+    order = malloc(read_lines * sizeof (*order));
+    if (order == NULL)
+        err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+            read_lines * sizeof (*order));
+    for (line = 0; line < read_lines; line++)
+        if (!LINE_LOST(line))
+            order[lines++] = line;
+    qsort(order, lines, sizeof (*order), power_line_compare);
+
+    memset(top, 0, sizeof (top));
+    for (start = 0; start < lines; start = end) {
+        pmask_t  key = pld_out[order[start]] & power_key_mask;
+        uint     spread;
+        for (end = start + 1; end < lines; end++)
+            if ((pld_out[order[end]] & power_key_mask) != key)
+                break;
+        groups++;
+
+        /* Sorted by VCC reading, so spread is last minus first */
+        spread = (pld_pwr[order[end - 1]] & 0xffff) -
+                 (pld_pwr[order[start]] & 0xffff);
+        for (cur = 0; cur < POWER_REPORT_GROUPS; cur++) {
+            if (spread > top[cur].spread) {
+                memmove(&top[cur + 1], &top[cur],
+                        (POWER_REPORT_GROUPS - cur - 1) * sizeof (top[0]));
+                top[cur].start  = start;
+                top[cur].end    = end;
+                top[cur].spread = spread;
+                break;
+            }
+        }
+    }
+
+    printf("\nSupply readings: %u lines in %u output states\n",
+           lines, groups);
+    for (shown = 0; shown < POWER_REPORT_GROUPS; shown++) {
+        uint64_t vcc_sum = 0;
+        uint64_t gnd_sum = 0;
+        uint     count;
+        uint     best_bit = 0;
+        int      best_diff = 0;
+
+        if (top[shown].spread == 0)
+            break;
+        if (shown == 0)
+            printf("  Outputs  Lines  VCC min/avg/max  GND avg  "
+                   "Best correlated input\n");
+        start = top[shown].start;
+        end   = top[shown].end;
+        count = end - start;
+        for (cur = start; cur < end; cur++) {
+            vcc_sum += pld_pwr[order[cur]] & 0xffff;
+            gnd_sum += pld_pwr[order[cur]] >> 16;
+        }
+
+        /* Find the input whose state best separates the VCC readings */
+        for (bit = 0; bit < PLD_SIGNALS; bit++) {
+            uint64_t sum1 = 0;
+            uint64_t sum0 = 0;
+            uint     cnt1 = 0;
+            int      diff;
+            if ((ignore_mask | pins_output) & BIT(bit))
+                continue;
+            for (cur = start; cur < end; cur++) {
+                if (pld_in[order[cur]] & BIT(bit)) {
+                    sum1 += pld_pwr[order[cur]] & 0xffff;
+                    cnt1++;
+                } else {
+                    sum0 += pld_pwr[order[cur]] & 0xffff;
+                }
+            }
+            if ((cnt1 == 0) || (cnt1 == count))
+                continue;
+            diff = (int) (sum1 / cnt1) - (int) (sum0 / (count - cnt1));
+            if (abs(diff) > abs(best_diff)) {
+                best_diff = diff;
+                best_bit  = bit;
+            }
+        }
+
+        printf("  %07" PM_X " %6u  %03x/%03x/%03x      %03x     ",
+               pld_out[order[start]] & power_key_mask, count,
+               pld_pwr[order[start]] & 0xffff,
+               (uint) (vcc_sum / count),
+               pld_pwr[order[end - 1]] & 0xffff,
+               (uint) (gnd_sum / count));
+        if (best_diff != 0)
+            printf("%s (%+d)", pin_name(best_bit, 0), best_diff);
+        printf("\n");
+    }
+    free(order);
+}
+
 /*
  * initialize_pinfo
  * ----------------
@@ -1825,15 +3191,19 @@ initialize_pinfo(void)
 {
     uint pin;
     memset(pinfo, 0, sizeof (pinfo));
-    for (pin = 0; pin < 32; pin++)
+    for (pin = 0; pin < PLD_BITS; pin++)
         pinfo[pin].pi_num = pin + 1;  // Pin number at input / output
 }
 
 static void
 usage(void)
 {
-    printf("Usage: cap_file [cfg_file] [-d <devtype>]\n"
-           "       <devtype> is one of dip4...dip28, g220v10");
+    printf("Usage: cap_file [cfg_file] [-d <devtype>] [-e <ext_cap_file>]...\n"
+           "       [-s <devtype>]\n"
+           "       <devtype> is one of dip4...dip28, g220v10\n"
+           "       <ext_cap_file> is a capture from walk extend=\n"
+           "       -s remaps captures from the <devtype> socket layout to "
+           "device pin order\n");
 }
 
 int
@@ -1848,12 +3218,25 @@ main(int argc, char *argv[])
     int count = 0;
     int content_type = CONTENT_UNKNOWN;
     char *cfg_device = NULL;
+    const char *ext_filenames[16];
+    uint ext_count = 0;
+    uint ext;
 
     for (arg = 1; arg < argc; arg++) {
         const char *ptr = argv[arg];
         if (strcmp(ptr, "-d") == 0) {
             arg++;
             cfg_device = strdup(argv[arg]);
+        } else if ((strcmp(ptr, "-s") == 0) && (arg + 1 < argc)) {
+            const uint8_t *layout = NULL;
+            if (device_layout(argv[++arg], &layout) != 0)
+                errx(EXIT_FAILURE, "Invalid device '%s'", argv[arg]);
+            bit_perm_build(&socket_perm, layout);
+            cap_perm = &socket_perm;
+        } else if ((strcmp(ptr, "-e") == 0) && (arg + 1 < argc)) {
+            if (ext_count >= ARRAY_SIZE(ext_filenames))
+                errx(EXIT_FAILURE, "Too many extension captures");
+            ext_filenames[ext_count++] = argv[++arg];
         } else if (cap_filename == NULL) {
             cap_filename = ptr;
         } else if (cfg_filename == NULL) {
@@ -1870,13 +3253,38 @@ main(int argc, char *argv[])
         errx(EXIT_FAILURE, "You must specify at least cap_filename");
     }
 
+    if ((cap_perm != NULL) && (cfg_device != NULL))
+        errx(EXIT_FAILURE, "-s and -d may not be used together");
+
     initialize_pinfo();
 
     read_cfg_file(cfg_filename);
-    read_cap_file(cap_filename);
+    if ((cap_perm != NULL) && (bit_to_pin != NULL))
+        errx(EXIT_FAILURE, "-s may not be used with a config file DEVICE");
+    read_cap_file(cap_filename, 0);
+    if (hazard_capture && (ext_count != 0))
+        errx(EXIT_FAILURE, "A hazard capture may not be extended");
+    for (ext = 0; ext < ext_count; ext++)
+        read_cap_file(ext_filenames[ext], 1);
+    if (ext_count != 0) {
+        if (sampled)
+            errx(EXIT_FAILURE, "A sampled capture may not be extended");
+        merge_extensions();
+    } else if ((cap_perm != NULL) && (sampled == 0)) {
+        merge_extensions();
+    }
     if (cfg_device != NULL)
         cfg_device_name(cfg_device, 0);
+    if (hazard_capture) {
+        print_hazard_report();
+        exit(EXIT_SUCCESS);
+    }
+    if (sampled) {
+        analyze_sampled();
+        exit(EXIT_SUCCESS);
+    }
     analyze();
+    analyze_power();
     collect_or_masks();
     merge_or_masks();
     show_counts();
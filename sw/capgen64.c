@@ -0,0 +1,79 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Generator of a 40-signal "pld walk values" capture with known logic,
+ * such as from two chained boards, for checking the brutus64 build.
+ *
+ * Signals 1-6, 33-38, and the outputs 39 and 40 are walked through all
+ * combinations as the firmware does, with the remaining signals held
+ * high. The outputs override the value driven on their pins:
+ *     P39 = P1 & P33 # P2 & !P34
+ *     P40 = !P3 & P37 & P38 # P35 & !P36
+ * The expected brutus64 equations are in capgen64.expect; "make check"
+ * compares them against the analysis of this capture.
+ *
+ * Compiling on Linux:
+ *     cc -O2 -o capgen64 capgen64.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CAP_SIGNALS 40
+
+typedef unsigned int uint;
+
+#define SIG(x) (1ULL << ((x) - 1))  // Bit for signal number x
+
+/* Walked signals, in order of the walk counter bits */
+static const uint8_t walk_sigs[] = { 1, 2, 3, 4, 5, 6,
+                                     33, 34, 35, 36, 37, 38, 39, 40 };
+
+#define ARRAY_SIZE(x) (sizeof (x) / sizeof ((x)[0]))
+
+/*
+ * cap_outputs
+ * -----------
+ * Compute the output signals for the specified input vector.
+ */
+static uint64_t
+cap_outputs(uint64_t in)
+{
+    uint64_t out = 0;
+
+#define IS(x) ((in & SIG(x)) != 0)
+    if ((IS(1) && IS(33)) || (IS(2) && !IS(34)))
+        out |= SIG(39);
+    if ((!IS(3) && IS(37) && IS(38)) || (IS(35) && !IS(36)))
+        out |= SIG(40);
+#undef IS
+    return (out);
+}
+
+int
+main(void)
+{
+    uint64_t all = (1ULL << CAP_SIGNALS) - 1;
+    uint64_t outs = SIG(39) | SIG(40);
+    uint     vectors = 1 << ARRAY_SIZE(walk_sigs);
+    uint     vec;
+    uint     bit;
+
+    printf("---- LINES=0x%x ----\n", vectors);
+    for (vec = 0; vec < vectors; vec++) {
+        uint64_t in = all;
+
+        for (bit = 0; bit < ARRAY_SIZE(walk_sigs); bit++)
+            if ((vec & (1U << bit)) == 0)
+                in &= ~SIG(walk_sigs[bit]);
+        printf("%010llx %010llx\n", (unsigned long long) in,
+               (unsigned long long) ((in & ~outs) | cap_outputs(in)));
+    }
+    printf("---- END ----\n");
+    return (0);
+}
@@ -0,0 +1,337 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Brutus "pld watch" capture decoder.
+ *
+ * The firmware sends the PLD1-PLD28 state at the trigger, followed by
+ * only the changes, each timestamped by the number of sample periods
+ * since the previous change. This program either prints that timeline,
+ * or reduces it to the distinct input / output vectors observed, in
+ * the format of a "pld walk values" capture which the brutus analyzer
+ * reads. A state is only reported once it has been stable for the
+ * settle time, so that outputs which have not yet followed a changed
+ * input are not mistaken for a different function.
+ *
+ * Compiling on Linux:
+ *     cc -O2 -o pldwatch pldwatch.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <err.h>
+
+#ifndef EXIT_USAGE
+#define EXIT_USAGE 2
+#endif
+
+#define DEFAULT_SETTLE_NS 100
+
+/** Program help text */
+static const char usage_text[] =
+"pldwatch <opts> <capture file>\n"
+"    -h            display usage\n"
+"    -o <pins>     PLD output pins, such as 12-19,22 (default none)\n"
+"    -s <ns>       time a state must be stable to be reported (default 100)\n"
+"    -t            print the timeline of changes instead of vectors\n"
+"\n"
+"Example:\n"
+"    echo pld watch time=2000 | term /dev/ttyACM0 > board.watch\n"
+"    pldwatch -o 12-19 board.watch > board.cap\n"
+"    brutus board.cap -d dip20\n"
+"";
+
+typedef unsigned int uint;
+
+typedef struct {
+    uint32_t wv_in;       // Pins which are not outputs
+    uint32_t wv_out;      // All pins
+    uint64_t wv_samples;  // Sample periods this vector was observed
+} watch_vec_t;
+
+static uint8_t     *cap_buf;
+static size_t       cap_len;
+static size_t       cap_pos;
+static watch_vec_t *vecs;
+static uint         vec_count;
+static uint         vec_alloc;
+
+static void
+usage(FILE *fp)
+{
+    (void) fputs(usage_text, fp);
+}
+
+/*
+ * parse_pins() converts a pin list such as "12-19,22" to a pin mask,
+ * where bit 0 is PLD pin 1.
+ */
+static uint32_t
+parse_pins(const char *str)
+{
+    uint32_t mask = 0;
+    const char *ptr = str;
+
+    while (*ptr != '\0') {
+        char *end;
+        uint  start = strtoul(ptr, &end, 10);
+        uint  last = start;
+
+        if (end == ptr)
+            break;
+        if (*end == '-') {
+            ptr = end + 1;
+            last = strtoul(ptr, &end, 10);
+            if (end == ptr)
+                break;
+        }
+        if (last < start) {
+            uint temp = last;
+            last = start;
+            start = temp;
+        }
+        if ((start < 1) || (last > 28))
+            break;
+        for (; start <= last; start++)
+            mask |= 1U << (start - 1);
+        ptr = end;
+        if (*ptr == ',')
+            ptr++;
+        else if (*ptr != '\0')
+            break;
+    }
+    if ((*ptr != '\0') || (mask == 0))
+        errx(EXIT_USAGE, "invalid pin list '%s'", str);
+    return (mask);
+}
+
+/*
+ * read_capture() reads the entire capture file into memory.
+ */
+static void
+read_capture(const char *filename)
+{
+    FILE  *fp = fopen(filename, "rb");
+    size_t alloc = 0;
+    size_t count;
+
+    if (fp == NULL)
+        err(EXIT_FAILURE, "Unable to open %s for read", filename);
+    do {
+        if (cap_len == alloc) {
+            alloc = (alloc == 0) ? 65536 : alloc * 2;
+            cap_buf = realloc(cap_buf, alloc);
+            if (cap_buf == NULL)
+                err(EXIT_FAILURE, "Unable to allocate %zu bytes", alloc);
+        }
+        count = fread(cap_buf + cap_len, 1, alloc - cap_len, fp);
+        cap_len += count;
+    } while (count != 0);
+    fclose(fp);
+}
+
+/*
+ * find_header() locates the watch header line, returning the sample
+ * rate and leaving cap_pos at the start of the binary stream.
+ */
+static uint
+find_header(const char *filename)
+{
+    static const char marker[] = "---- WATCH RATE=";
+    size_t pos;
+    uint   rate = 0;
+
+    for (pos = 0; pos + sizeof (marker) < cap_len; pos++) {
+        if (memcmp(cap_buf + pos, marker, sizeof (marker) - 1) != 0)
+            continue;
+        pos += sizeof (marker) - 1;
+        while ((pos < cap_len) && (cap_buf[pos] >= '0') &&
+               (cap_buf[pos] <= '9'))
+            rate = rate * 10 + cap_buf[pos++] - '0';
+        while ((pos < cap_len) && (cap_buf[pos] != '\n'))
+            pos++;
+        cap_pos = pos + 1;
+        if (rate == 0)
+            errx(EXIT_FAILURE, "Invalid sample rate in %s", filename);
+        return (rate);
+    }
+    errx(EXIT_FAILURE, "Could not find start marker in %s", filename);
+}
+
+/*
+ * get_leb128() decodes the next variable-length value of the stream.
+ */
+static uint32_t
+get_leb128(void)
+{
+    uint32_t value = 0;
+    uint     shift = 0;
+
+    while (cap_pos < cap_len) {
+        uint8_t byte = cap_buf[cap_pos++];
+        value |= (uint32_t) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return (value);
+        shift += 7;
+        if (shift > 28)
+            break;
+    }
+    errx(EXIT_FAILURE, "Capture is truncated or corrupt at offset %zu",
+         cap_pos);
+}
+
+/*
+ * add_vector() records a state which was stable for the specified number
+ * of sample periods.
+ */
+static void
+add_vector(uint32_t state, uint32_t outputs, uint64_t samples)
+{
+    if (vec_count == vec_alloc) {
+        vec_alloc = (vec_alloc == 0) ? 1024 : vec_alloc * 2;
+        vecs = realloc(vecs, vec_alloc * sizeof (*vecs));
+        if (vecs == NULL)
+            err(EXIT_FAILURE, "Unable to allocate %zu bytes",
+                vec_alloc * sizeof (*vecs));
+    }
+    vecs[vec_count].wv_in = state & ~outputs;
+    vecs[vec_count].wv_out = state;
+    vecs[vec_count].wv_samples = samples;
+    vec_count++;
+}
+
+static int
+vec_compare(const void *ptr1, const void *ptr2)
+{
+    const watch_vec_t *v1 = ptr1;
+    const watch_vec_t *v2 = ptr2;
+
+    if (v1->wv_in != v2->wv_in)
+        return ((v1->wv_in < v2->wv_in) ? -1 : 1);
+    if (v1->wv_out != v2->wv_out)
+        return ((v1->wv_out < v2->wv_out) ? -1 : 1);
+    return (0);
+}
+
+/*
+ * print_vectors() merges identical vectors and prints one line per
+ * distinct input vector. Where one input was seen with different
+ * outputs (registered logic, or an input which the -o list misses),
+ * the longest observed output is reported and the conflict counted.
+ */
+static void
+print_vectors(void)
+{
+    uint cur;
+    uint next;
+    uint out = 0;
+    uint conflicts = 0;
+
+    qsort(vecs, vec_count, sizeof (*vecs), vec_compare);
+    for (cur = 0; cur < vec_count; cur = next) {
+        watch_vec_t best = vecs[cur];
+        for (next = cur + 1; (next < vec_count) &&
+                             (vecs[next].wv_in == best.wv_in); next++) {
+            if (vecs[next].wv_out == vecs[next - 1].wv_out) {
+                if (vecs[next].wv_out == best.wv_out)
+                    best.wv_samples += vecs[next].wv_samples;
+                continue;
+            }
+            conflicts++;
+            if (vecs[next].wv_samples > best.wv_samples)
+                best = vecs[next];
+        }
+        vecs[out++] = best;
+    }
+
+    printf("---- LINES=0x%x WATCH ----\n", out);
+    for (cur = 0; cur < out; cur++)
+        printf("%08x %08x\n", vecs[cur].wv_in, vecs[cur].wv_out);
+    printf("---- END ----\n");
+    fprintf(stderr, "%u distinct input vectors", out);
+    if (conflicts != 0)
+        fprintf(stderr, ", %u with conflicting outputs", conflicts);
+    fprintf(stderr, "\n");
+}
+
+int
+main(int argc, char * const *argv)
+{
+    uint32_t outputs = 0;
+    uint32_t state;
+    uint32_t changed;
+    uint64_t settle_ns = DEFAULT_SETTLE_NS;
+    uint64_t settle;
+    uint64_t sample = 0;
+    uint64_t delta;
+    uint     timeline = 0;
+    uint     changes = 0;
+    uint     rate;
+    int      ch;
+
+    while ((ch = getopt(argc, argv, "ho:s:t")) != -1) {
+        switch (ch) {
+            case 'h':
+                usage(stdout);
+                exit(EXIT_SUCCESS);
+            case 'o':
+                outputs = parse_pins(optarg);
+                break;
+            case 's':
+                settle_ns = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                timeline = 1;
+                break;
+            default:
+                usage(stderr);
+                exit(EXIT_USAGE);
+        }
+    }
+    if (optind + 1 != argc) {
+        usage(stderr);
+        exit(EXIT_USAGE);
+    }
+
+    read_capture(argv[optind]);
+    rate = find_header(argv[optind]);
+    settle = (settle_ns * rate + 999999999) / 1000000000;
+    if (cap_pos + 4 > cap_len)
+        errx(EXIT_FAILURE, "Capture is truncated after header");
+    state = cap_buf[cap_pos] | (cap_buf[cap_pos + 1] << 8) |
+            (cap_buf[cap_pos + 2] << 16) |
+            ((uint32_t) cap_buf[cap_pos + 3] << 24);
+    cap_pos += 4;
+
+    if (timeline)
+        printf("%12s %07x\n", "0", state);
+    while (1) {
+        delta = get_leb128();
+        changed = get_leb128();
+        if ((timeline == 0) && (delta >= settle))
+            add_vector(state, outputs, delta);
+        sample += delta;
+        if (changed == 0)
+            break;
+        state ^= changed;
+        changes++;
+        if (timeline)
+            printf("%12llu %07x %07x\n",
+                   (unsigned long long) (sample * 1000000000 / rate),
+                   state, changed);
+    }
+
+    fprintf(stderr, "%u changes over %llu samples (%llu usec) at %u Hz\n",
+            changes, (unsigned long long) sample,
+            (unsigned long long) (sample * 1000000 / rate), rate);
+    if (timeline == 0)
+        print_vectors();
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,356 @@
+/*
+ * This is free and unencumbered software released into the public domain.
+ * See the LICENSE file for additional details.
+ *
+ * Designed by Chris Hooper in 2024.
+ *
+ * ---------------------------------------------------------------------
+ *
+ * Brutus console link throughput benchmark.
+ *
+ * Drives the firmware "usb bench" command over the USB ACM (or serial)
+ * console, receiving and verifying the streamed counter pattern as fast
+ * as the host can read it. With -r, the pattern is instead sent to the
+ * firmware, which verifies it and reports the rate at which it arrived.
+ *
+ * Compiling on Linux:
+ *     cc -O2 -o usbbench usbbench.c
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <err.h>
+
+#ifndef EXIT_USAGE
+#define EXIT_USAGE 2
+#endif
+
+#define DEFAULT_DEVICE  "/dev/ttyACM0"
+#define DEFAULT_BYTES   (1024 * 1024)
+#define POLL_MSEC       100
+
+/** Program help text */
+static const char usage_text[] =
+"usbbench <opts> [<dev>]\n"
+"    -b <bytes>    bytes to transfer, K and M suffixes allowed (default 1M)\n"
+"    -f            firmware sends by full packets (\"fast\")\n"
+"    -h            display usage\n"
+"    -r            send to the firmware instead of receiving from it\n"
+"    -t <sec>      give up after this many idle seconds (default 5)\n"
+"\n"
+"The device defaults to " DEFAULT_DEVICE "\n"
+"Example:\n"
+"    usbbench -b 4M -f\n"
+"    usbbench -r -b 64K /dev/ttyACM1\n"
+"";
+
+typedef unsigned int uint;
+
+static int      dev_fd = -1;
+static uint     idle_limit = 5000 / POLL_MSEC;  // Idle polls before failing
+static uint     poll_timeouts;                  // Polls which got no data
+static uint     read_calls;                     // Successful read() calls
+static uint8_t  rd_buf[65536];
+static uint     rd_pos;
+static uint     rd_len;
+
+static void
+usage(FILE *fp)
+{
+    (void) fputs(usage_text, fp);
+}
+
+/*
+ * time_usec() returns a monotonic timestamp in microseconds.
+ */
+static uint64_t
+time_usec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+/*
+ * parse_bytes() converts a byte count with an optional K or M suffix.
+ */
+static uint
+parse_bytes(const char *str)
+{
+    char *end;
+    unsigned long value = strtoul(str, &end, 0);
+
+    if ((*end == 'k') || (*end == 'K')) {
+        value *= 1024;
+        end++;
+    } else if ((*end == 'm') || (*end == 'M')) {
+        value *= 1024 * 1024;
+        end++;
+    }
+    if ((end == str) || (*end != '\0') || (value == 0) || (value > 0xfffffffc))
+        errx(EXIT_USAGE, "invalid byte count '%s'", str);
+    return ((uint) value & ~3);
+}
+
+/*
+ * dev_open() opens the Brutus console device in raw mode.
+ */
+static void
+dev_open(const char *name)
+{
+    struct termios tty;
+
+    dev_fd = open(name, O_RDWR | O_NOCTTY);
+    if (dev_fd < 0)
+        err(EXIT_FAILURE, "Failed to open %s", name);
+
+    if (tcgetattr(dev_fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        tty.c_cc[VMIN] = 1;
+        tty.c_cc[VTIME] = 0;
+        if (tcsetattr(dev_fd, TCSANOW, &tty) != 0)
+            warn("Failed to set raw mode on %s", name);
+    }
+    (void) tcflush(dev_fd, TCIOFLUSH);
+}
+
+/*
+ * dev_write() sends a buffer to the device, retrying partial writes.
+ */
+static void
+dev_write(const void *buf, size_t len)
+{
+    const uint8_t *ptr = buf;
+
+    while (len > 0) {
+        ssize_t count = write(dev_fd, ptr, len);
+        if (count <= 0)
+            err(EXIT_FAILURE, "Device write failed");
+        ptr += count;
+        len -= count;
+    }
+}
+
+/*
+ * rd_fill() refills the receive buffer from the device. It fails after
+ * idle_limit consecutive polls which return no data.
+ */
+static void
+rd_fill(void)
+{
+    struct pollfd pfd;
+    ssize_t       count;
+    uint          idle = 0;
+
+    pfd.fd = dev_fd;
+    pfd.events = POLLIN;
+    while (poll(&pfd, 1, POLL_MSEC) <= 0) {
+        poll_timeouts++;
+        if (++idle >= idle_limit)
+            errx(EXIT_FAILURE, "Timeout waiting for Brutus");
+    }
+    count = read(dev_fd, rd_buf, sizeof (rd_buf));
+    if (count <= 0)
+        errx(EXIT_FAILURE, "Device read failed");
+    read_calls++;
+    rd_pos = 0;
+    rd_len = count;
+}
+
+/*
+ * rd_line() reads the next line of text from the device, without the
+ * trailing CR and LF.
+ */
+static void
+rd_line(char *line, size_t size)
+{
+    size_t len = 0;
+
+    while (1) {
+        uint8_t ch;
+
+        if (rd_pos >= rd_len)
+            rd_fill();
+        ch = rd_buf[rd_pos++];
+        if (ch == '\n')
+            break;
+        if ((ch != '\r') && (len + 1 < size))
+            line[len++] = ch;
+    }
+    line[len] = '\0';
+}
+
+/*
+ * wait_line() discards lines from the device (such as the command echo)
+ * until one starting with the specified prefix arrives.
+ */
+static void
+wait_line(const char *prefix, char *line, size_t size)
+{
+    do {
+        rd_line(line, size);
+        if (strncmp(line, "Unknown", 7) == 0)
+            errx(EXIT_FAILURE, "Brutus: %s", line);
+    } while (strncmp(line, prefix, strlen(prefix)) != 0);
+}
+
+/*
+ * pattern_byte() returns the expected byte at the specified stream offset.
+ */
+static inline uint8_t
+pattern_byte(uint pos)
+{
+    return ((uint8_t) ((pos >> 2) >> ((pos & 3) * 8)));
+}
+
+static double
+rate_mbs(uint bytes, uint64_t usec)
+{
+    if (usec == 0)
+        usec = 1;
+    return ((double) bytes / usec);
+}
+
+/*
+ * bench_receive() has Brutus stream the pattern and verifies it here.
+ */
+static int
+bench_receive(uint bytes, int fast)
+{
+    char     line[256];
+    uint     pos = 0;
+    uint     errors = 0;
+    uint     first_error = 0;
+    uint64_t start;
+    uint64_t usec;
+
+    snprintf(line, sizeof (line), "usb bench send 0x%x%s\r",
+             bytes, fast ? " fast" : "");
+    dev_write(line, strlen(line));
+    wait_line("---- USBBENCH", line, sizeof (line));
+
+    start = time_usec();
+    read_calls = 0;
+    poll_timeouts = 0;
+    while (pos < bytes) {
+        uint count;
+
+        if (rd_pos >= rd_len)
+            rd_fill();
+        count = rd_len - rd_pos;
+        if (count > bytes - pos)
+            count = bytes - pos;
+        for (; count > 0; count--, pos++)
+            if (rd_buf[rd_pos++] != pattern_byte(pos))
+                if (errors++ == 0)
+                    first_error = pos;
+    }
+    usec = time_usec() - start;
+
+    printf("Host:   received %u bytes in %llu us = %.2f MB/s; "
+           "%u reads (avg %u bytes), %u poll timeouts, errors=%u",
+           pos, (unsigned long long) usec, rate_mbs(pos, usec),
+           read_calls, read_calls ? pos / read_calls : 0,
+           poll_timeouts, errors);
+    if (errors != 0)
+        printf(" first at 0x%x", first_error);
+    printf("\n");
+
+    wait_line("Sent ", line, sizeof (line));
+    printf("Brutus: %s\n", line);
+    return (errors != 0);
+}
+
+/*
+ * bench_send() sends the pattern to Brutus, which verifies it.
+ */
+static int
+bench_send(uint bytes)
+{
+    char     line[256];
+    uint8_t  buf[4096];
+    uint     pos = 0;
+    uint64_t start;
+    uint64_t usec;
+
+    snprintf(line, sizeof (line), "usb bench recv 0x%x\r", bytes);
+    dev_write(line, strlen(line));
+    wait_line("---- USBBENCH RECV", line, sizeof (line));
+
+    start = time_usec();
+    while (pos < bytes) {
+        uint count = bytes - pos;
+        uint cur;
+
+        if (count > sizeof (buf))
+            count = sizeof (buf);
+        for (cur = 0; cur < count; cur++)
+            buf[cur] = pattern_byte(pos + cur);
+        dev_write(buf, count);
+        pos += count;
+    }
+    usec = time_usec() - start;
+    printf("Host:   sent %u bytes in %llu us = %.2f MB/s\n",
+           pos, (unsigned long long) usec, rate_mbs(pos, usec));
+
+    wait_line("Received ", line, sizeof (line));
+    printf("Brutus: %s\n", line);
+    return (strstr(line, "errors=0") == NULL);
+}
+
+int
+main(int argc, char * const *argv)
+{
+    const char *device = DEFAULT_DEVICE;
+    uint        bytes = DEFAULT_BYTES;
+    int         fast = 0;
+    int         reverse = 0;
+    int         ch;
+
+    while ((ch = getopt(argc, argv, "b:fhrt:")) != -1) {
+        switch (ch) {
+            case 'b':
+                bytes = parse_bytes(optarg);
+                break;
+            case 'f':
+                fast = 1;
+                break;
+            case 'h':
+                usage(stdout);
+                exit(EXIT_SUCCESS);
+            case 'r':
+                reverse = 1;
+                break;
+            case 't':
+                idle_limit = atoi(optarg) * (1000 / POLL_MSEC);
+                if (idle_limit == 0)
+                    errx(EXIT_USAGE, "invalid timeout '%s'", optarg);
+                break;
+            default:
+                usage(stderr);
+                exit(EXIT_USAGE);
+        }
+    }
+    if (optind < argc)
+        device = argv[optind++];
+    if (optind < argc) {
+        warnx("Unexpected argument %s", argv[optind]);
+        usage(stderr);
+        exit(EXIT_USAGE);
+    }
+    if (reverse && fast)
+        errx(EXIT_USAGE, "-f applies only to receive");
+
+    dev_open(device);
+    if (reverse)
+        return (bench_send(bytes));
+    return (bench_receive(bytes, fast));
+}